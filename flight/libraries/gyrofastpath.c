@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ *
+ * @file       gyrofastpath.c
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @brief      Lock free single producer single consumer channel carrying the
+ *             gyro state from the sensor task to the inner rate loop.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stddef.h>
+#include "inc/gyrofastpath.h"
+
+// Each value is guarded by a sequence counter that is odd while it is
+// being written. Readers never wait for the writer, a writer preempted
+// halfway can not make progress while a higher priority reader spins.
+// They retry a few times and otherwise report no new data.
+#define READ_RETRIES 3
+
+// Consecutive reads without a new sample after which the consumer is fed by GyroState again
+#define MAX_EMPTY_READS 3
+
+typedef struct {
+    volatile uint32_t sequence;
+    float data[3];
+} gyrofastpath_slot;
+
+static gyrofastpath_slot sample;
+static gyrofastpath_slot correction;
+static volatile gyrofastpath_notify consumer;
+// set on connect, the consumer resets its own state on its next read
+static volatile bool consumer_resync;
+// written by the consumer only, whether a producer keeps it fed
+static volatile bool consumer_fed;
+
+// private to the producer and the consumer respectively
+static float producer_correction[3];
+static uint32_t consumer_sequence;
+static uint8_t consumer_empty_reads;
+
+static void slot_write(gyrofastpath_slot *slot, const float data[3])
+{
+    slot->sequence++;
+    __sync_synchronize();
+    slot->data[0] = data[0];
+    slot->data[1] = data[1];
+    slot->data[2] = data[2];
+    __sync_synchronize();
+    slot->sequence++;
+}
+
+static bool slot_read(const gyrofastpath_slot *slot, float data[3], uint32_t *sequence)
+{
+    for (uint32_t i = 0; i < READ_RETRIES; i++) {
+        const uint32_t start = slot->sequence;
+        __sync_synchronize();
+        if (start & 1) {
+            continue;
+        }
+        data[0] = slot->data[0];
+        data[1] = slot->data[1];
+        data[2] = slot->data[2];
+        __sync_synchronize();
+        if (slot->sequence == start) {
+            *sequence = start;
+            return true;
+        }
+    }
+    return false;
+}
+
+void gyrofastpath_connect(gyrofastpath_notify notify)
+{
+    // samples published before are not accounted to the new consumer,
+    // its sequence is reset by the consumer task itself
+    consumer_fed    = false;
+    consumer_resync = true;
+    __sync_synchronize();
+    consumer = notify;
+}
+
+bool gyrofastpath_connected()
+{
+    return consumer != NULL;
+}
+
+bool gyrofastpath_active()
+{
+    return consumer != NULL && consumer_fed;
+}
+
+void gyrofastpath_set_correction(const float delta[3])
+{
+    slot_write(&correction, delta);
+}
+
+void gyrofastpath_publish(const float gyro[3])
+{
+    uint32_t sequence;
+    float delta[3];
+
+    // keep the previous correction if the estimator is updating it right now
+    if (slot_read(&correction, delta, &sequence)) {
+        producer_correction[0] = delta[0];
+        producer_correction[1] = delta[1];
+        producer_correction[2] = delta[2];
+    }
+
+    const float corrected[3] = {
+        gyro[0] + producer_correction[0],
+        gyro[1] + producer_correction[1],
+        gyro[2] + producer_correction[2]
+    };
+    slot_write(&sample, corrected);
+
+    gyrofastpath_notify notify = consumer;
+    if (notify) {
+        notify();
+    }
+}
+
+uint32_t gyrofastpath_read(float gyro[3])
+{
+    uint32_t sequence;
+    uint32_t samples = 0;
+
+    if (consumer_resync) {
+        consumer_resync      = false;
+        consumer_sequence    = sample.sequence & ~1u;
+        consumer_empty_reads = 0;
+    } else if (slot_read(&sample, gyro, &sequence)) {
+        // every write advances the sequence by two
+        samples = (sequence - consumer_sequence) / 2;
+        consumer_sequence = sequence;
+    }
+
+    if (samples > 0) {
+        consumer_empty_reads = 0;
+        consumer_fed = true;
+    } else if (consumer_empty_reads < MAX_EMPTY_READS) {
+        consumer_empty_reads++;
+    } else {
+        // no producer, or it stopped publishing
+        consumer_fed = false;
+    }
+    return samples;
+}
@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ *
+ * @file       gyrofastpath.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @brief      Lock free single producer single consumer channel carrying the
+ *             gyro state from the sensor task to the inner rate loop.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef GYROFASTPATH_H_
+#define GYROFASTPATH_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+// While the fast path is active GyroState is only updated every Nth sample, for telemetry and logging
+#define GYROFASTPATH_UAVOBJECT_DIVIDER 10
+
+typedef void (*gyrofastpath_notify)(void);
+
+/**
+ * @brief Connect the consumer. Called by the producer after each new sample,
+ *        so it has to be short, usually a PIOS_CALLBACKSCHEDULER_Dispatch.
+ * @param[in] notify function to call, NULL disconnects the consumer
+ */
+void gyrofastpath_connect(gyrofastpath_notify notify);
+
+/**
+ * @brief Whether a consumer is connected
+ */
+bool gyrofastpath_connected();
+
+/**
+ * @brief Whether a consumer is connected and a producer keeps it fed. Until then,
+ *        and again once the producer stops, the consumer relies on GyroState
+ */
+bool gyrofastpath_active();
+
+/**
+ * @brief Set the correction the state estimation applies to the gyro sensor,
+ *        it is added to every published sample
+ * @param[in] delta correction in deg/s
+ */
+void gyrofastpath_set_correction(const float delta[3]);
+
+/**
+ * @brief Publish a new gyro sample, to be called from a single producer
+ * @param[in] gyro sample in deg/s
+ */
+void gyrofastpath_publish(const float gyro[3]);
+
+/**
+ * @brief Read the newest sample, to be called from a single consumer
+ * @param[out] gyro sample in deg/s, with correction applied
+ * @return number of samples published since the last call, 0 if there
+ *         is no new sample or the consumer has just been connected
+ */
+uint32_t gyrofastpath_read(float gyro[3]);
+
+#endif /* GYROFASTPATH_H_ */
@@ -39,12 +39,13 @@
 #define NUMW 9 // number of plant noise inputs, w is disturbance noise vector
 #define NUMV 10 // number of measurements, v is the measurement noise vector
 #define NUMU 6 // number of deterministic inputs, U is the input vector
+#define NUMP (NUMX * (NUMX + 1) / 2) // number of stored covariance terms, P is symmetric
 
 // Private functions
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
-                          float Q[NUMW], float dT, float P[NUMX][NUMX]);
+                          float Q[NUMW], float dT, float P[NUMP]);
 void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
-                  float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
+                  float Y[NUMV], float P[NUMP], float X[NUMX],
                   uint16_t SensorsUsed);
 void RungeKutta(float X[NUMX], float U[NUMU], float dT);
 void StateEq(float X[NUMX], float U[NUMU], float Xdot[NUMX]);
@@ -84,6 +85,29 @@ static const int8_t GrowMax[NUMX] = { -1, -1, -1, 5, 5, 5, 2, 2, 2, 2, 6, 7, 8 }
 static const int8_t HrowMin[NUMV] = { 0, 1, 2, 3, 4, 5, 6, 6, 6, 2 };
 static const int8_t HrowMax[NUMV] = { 0, 1, 2, 3, 4, 5, 9, 9, 9, 2 };
 
+// first column of (P/T + F*P) needed by CovariancePrediction(),
+// the lower of the row itself and the F bands of all following rows
+static const int8_t DrowMin[NUMX] = { 0, 1, 2, 3, 4, 5, 6, 6, 6, 6, 10, 11, 12 };
+
+// the covariance matrix is symmetric, only the upper triangle is stored,
+// packed row by row: P00 P01 .. P0c P11 P12 .. P1c P22 .. Pcc
+// Pidx[i][j] is the position of element (i,j) or (j,i) in the packed array
+static const uint8_t Pidx[NUMX][NUMX] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12 },
+    {  1, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24 },
+    {  2, 14, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35 },
+    {  3, 15, 26, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45 },
+    {  4, 16, 27, 37, 46, 47, 48, 49, 50, 51, 52, 53, 54 },
+    {  5, 17, 28, 38, 47, 55, 56, 57, 58, 59, 60, 61, 62 },
+    {  6, 18, 29, 39, 48, 56, 63, 64, 65, 66, 67, 68, 69 },
+    {  7, 19, 30, 40, 49, 57, 64, 70, 71, 72, 73, 74, 75 },
+    {  8, 20, 31, 41, 50, 58, 65, 71, 76, 77, 78, 79, 80 },
+    {  9, 21, 32, 42, 51, 59, 66, 72, 77, 81, 82, 83, 84 },
+    { 10, 22, 33, 43, 52, 60, 67, 73, 78, 82, 85, 86, 87 },
+    { 11, 23, 34, 44, 53, 61, 68, 74, 79, 83, 86, 88, 89 },
+    { 12, 24, 35, 45, 54, 62, 69, 75, 80, 84, 87, 89, 90 },
+};
+
 static struct EKFData {
     // linearized system matrices
     float F[NUMX][NUMX];
@@ -91,8 +115,8 @@ static struct EKFData {
     float H[NUMV][NUMX];
     // local magnetic unit vector in NED frame
     float Be[3];
-    // covariance matrix and state vector
-    float P[NUMX][NUMX];
+    // covariance matrix (packed upper triangle, see Pidx) and state vector
+    float P[NUMP];
     float X[NUMX];
     // input noise and measurement noise variances
     float Q[NUMW];
@@ -116,9 +140,11 @@ void INSGPSInit() // pretty much just a place holder for now
     ekf.Be[1] = 0.0f;
     ekf.Be[2] = 0.0f; // local magnetic unit vector
 
+    for (int i = 0; i < NUMP; i++) {
+        ekf.P[i] = 0.0f; // zero all terms
+    }
     for (int i = 0; i < NUMX; i++) {
         for (int j = 0; j < NUMX; j++) {
-            ekf.P[i][j] = 0.0f; // zero all terms
             ekf.F[i][j] = 0.0f;
         }
 
@@ -140,10 +166,10 @@ void INSGPSInit() // pretty much just a place holder for now
     }
 
 
-    ekf.P[0][0]   = ekf.P[1][1] = ekf.P[2][2] = 25.0f;            // initial position variance (m^2)
-    ekf.P[3][3]   = ekf.P[4][4] = ekf.P[5][5] = 5.0f;             // initial velocity variance (m/s)^2
-    ekf.P[6][6]   = ekf.P[7][7] = ekf.P[8][8] = ekf.P[9][9] = 1e-5f;  // initial quaternion variance
-    ekf.P[10][10] = ekf.P[11][11] = ekf.P[12][12] = 1e-9f; // initial gyro bias variance (rad/s)^2
+    ekf.P[Pidx[0][0]]   = ekf.P[Pidx[1][1]] = ekf.P[Pidx[2][2]] = 25.0f;            // initial position variance (m^2)
+    ekf.P[Pidx[3][3]]   = ekf.P[Pidx[4][4]] = ekf.P[Pidx[5][5]] = 5.0f;             // initial velocity variance (m/s)^2
+    ekf.P[Pidx[6][6]]   = ekf.P[Pidx[7][7]] = ekf.P[Pidx[8][8]] = ekf.P[Pidx[9][9]] = 1e-5f;  // initial quaternion variance
+    ekf.P[Pidx[10][10]] = ekf.P[Pidx[11][11]] = ekf.P[Pidx[12][12]] = 1e-9f; // initial gyro bias variance (rad/s)^2
 
     ekf.X[0]  = ekf.X[1] = ekf.X[2] = ekf.X[3] = ekf.X[4] = ekf.X[5] = 0.0f; // initial pos and vel (m)
     ekf.X[6]  = 1.0f;
@@ -170,9 +196,9 @@ void INSResetP(float PDiag[NUMX])
     for (i = 0; i < NUMX; i++) {
         if (PDiag != 0) {
             for (j = 0; j < NUMX; j++) {
-                ekf.P[i][j] = ekf.P[j][i] = 0.0f;
+                ekf.P[Pidx[i][j]] = 0.0f;
             }
-            ekf.P[i][i] = PDiag[i];
+            ekf.P[Pidx[i][i]] = PDiag[i];
         }
     }
 }
@@ -184,7 +210,7 @@ void INSGetP(float PDiag[NUMX])
     // retrieve diagonal elements (aka state variance)
     for (i = 0; i < NUMX; i++) {
         if (PDiag != 0) {
-            PDiag[i] = ekf.P[i][i];
+            PDiag[i] = ekf.P[Pidx[i][i]];
         }
     }
 }
@@ -211,13 +237,12 @@ void INSPosVelReset(float pos[3], float vel[3])
 {
     for (int i = 0; i < 6; i++) {
         for (int j = i; j < NUMX; j++) {
-            ekf.P[i][j] = 0; // zero the first 6 rows and columns
-            ekf.P[j][i] = 0;
+            ekf.P[Pidx[i][j]] = 0; // zero the first 6 rows and columns
         }
     }
 
-    ekf.P[0][0] = ekf.P[1][1] = ekf.P[2][2] = 25; // initial position variance (m^2)
-    ekf.P[3][3] = ekf.P[4][4] = ekf.P[5][5] = 5; // initial velocity variance (m/s)^2
+    ekf.P[Pidx[0][0]] = ekf.P[Pidx[1][1]] = ekf.P[Pidx[2][2]] = 25; // initial position variance (m^2)
+    ekf.P[Pidx[3][3]] = ekf.P[Pidx[4][4]] = ekf.P[Pidx[5][5]] = 5; // initial velocity variance (m/s)^2
 
     ekf.X[0]    = pos[0];
     ekf.X[1]    = pos[1];
@@ -432,11 +457,13 @@ void INSCorrection(float mag_data[3], float Pos[3], float Vel[3],
 // dimensions equal to the number of disturbance noise variables
 // The General Method is very inefficient,not taking advantage of the sparse F and G
 // The first Method is very specific to this implementation
+// P is the packed upper triangle, Pnew is written row by row over it once
+// all of Dummy has been computed
 // ************************************************
 
 __attribute__((optimize("O3")))
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
-                          float Q[NUMW], float dT, float P[NUMX][NUMX])
+                          float Q[NUMW], float dT, float P[NUMP])
 {
     // Pnew = (I+F*T)*P*(I+F*T)' + (T^2)*G*Q*G' = (T^2)[(P/T + F*P)*(I/T + F') + G*Q*G')]
 
@@ -444,27 +471,28 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
     float dTsq = dT * dT;
 
     float Dummy[NUMX][NUMX];
+    float *Pnew = P;
     int8_t i;
 
     for (i = 0; i < NUMX; i++) { // Calculate Dummy = (P/T +F*P)
         float *Firow   = F[i];
-        float *Pirow   = P[i];
+        const uint8_t *Pirow = Pidx[i];
         float *Dirow   = Dummy[i];
         int8_t Fistart = FrowMin[i];
         int8_t Fiend   = FrowMax[i];
         int8_t j;
-        for (j = 0; j < NUMX; j++) {
-            Dirow[j] = Pirow[j] * dT1; // Dummy = P / T ...
+        for (j = DrowMin[i]; j < NUMX; j++) { // lower columns are never used
+            float Dtmp = P[Pirow[j]] * dT1; // Dummy = P / T ...
             int8_t k;
             for (k = Fistart; k <= Fiend; k++) {
-                Dirow[j] += Firow[k] * P[k][j]; // [] + F * P
+                Dtmp += Firow[k] * P[Pidx[k][j]]; // [] + F * P
             }
+            Dirow[j] = Dtmp;
         }
     }
     for (i = 0; i < NUMX; i++) { // Calculate Pnew = (T^2) [Dummy/T + Dummy*F' + G*Qw*G']
         float *Dirow   = Dummy[i];
         float *Girow   = G[i];
-        float *Pirow   = P[i];
         int8_t Gistart = GrowMin[i];
         int8_t Giend   = GrowMax[i];
         int8_t j;
@@ -491,7 +519,7 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
                 }
             }
 
-            P[j][i] = Pirow[j] = Ptmp * dTsq; // [] * (T^2)
+            *Pnew++ = Ptmp * dTsq; // [] * (T^2)
         }
     }
 }
@@ -510,10 +538,13 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
 // - or see Simon, "Optimal State Estimation," 1st Ed, p.150
 // The SensorsUsed variable is a bitwise mask indicating which sensors
 // should be used in the update.
+// P is the packed upper triangle, so the rank one update of P walks it
+// linearly, one contiguous row segment per state
 // ************************************************
 
+__attribute__((optimize("O3")))
 void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
-                  float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
+                  float Y[NUMV], float P[NUMP], float X[NUMX],
                   uint16_t SensorsUsed)
 {
     float HP[NUMX], HPHR, Error;
@@ -523,23 +554,26 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
     for (m = 0; m < NUMV; m++) {
         if (SensorsUsed & (0x01 << m)) { // use this sensor for update
             for (j = 0; j < NUMX; j++) { // Find Hp = H*P
-                HP[j] = 0;
+                float HPtmp = 0.0f;
                 for (k = HrowMin[m]; k <= HrowMax[m]; k++) {
-                    HP[j] += H[m][k] * P[k][j];
+                    HPtmp += H[m][k] * P[Pidx[k][j]];
                 }
+                HP[j] = HPtmp;
             }
             HPHR = R[m]; // Find  HPHR = H*P*H' + R
             for (k = HrowMin[m]; k <= HrowMax[m]; k++) {
                 HPHR += HP[k] * H[m][k];
             }
 
+            float HPHR1 = 1.0f / HPHR; // multiplication is faster than division on fpu.
             for (k = 0; k < NUMX; k++) {
-                Km[k] = HP[k] / HPHR; // find K = HP/HPHR
+                Km[k] = HP[k] * HPHR1; // find K = HP/HPHR
             }
+            float *Prow = P;
             for (i = 0; i < NUMX; i++) { // Find P(m)= P(m-1) + K*HP
+                float Kmi = Km[i];
                 for (j = i; j < NUMX; j++) {
-                    P[i][j] = P[j][i] =
-                                  P[i][j] - Km[i] * HP[j];
+                    *Prow++ -= Kmi * HP[j];
                 }
             }
 
@@ -71,6 +71,7 @@
 #include <mathmisc.h>
 #include <pios_constants.h>
 #include <pios_instrumentation_helper.h>
+#include <gyrofastpath.h>
 
 PERF_DEFINE_COUNTER(counterUpd);
 PERF_DEFINE_COUNTER(counterAccelSamples);
@@ -118,6 +119,7 @@ static xQueueHandle gyro_queue;
 static int32_t updateSensors(AccelStateData *, GyroStateData *);
 static int32_t updateSensorsCC3D(AccelStateData *accelStateData, GyroStateData *gyrosData);
 static void updateAttitude(AccelStateData *, GyroStateData *);
+static void publishGyroState(GyroStateData *gyros);
 static void settingsUpdatedCb(UAVObjEvent *objEv);
 
 static float accelKi     = 0;
@@ -455,7 +457,7 @@ static int32_t updateSensors(AccelStateData *accelState, GyroStateData *gyros)
     gyro_correct_int[2] += -gyros->z * yawBiasRate;
     PERF_TIMED_SECTION_END(counterUpd);
 
-    GyroStateSet(gyros);
+    publishGyroState(gyros);
     AccelStateSet(accelState);
 
     return 0;
@@ -585,7 +587,7 @@ static int32_t updateSensorsCC3D(AccelStateData *accelStateData, GyroStateData *
     // and make it average zero (weakly)
     gyro_correct_int[2] += -gyrosData->z * yawBiasRate;
     PERF_TIMED_SECTION_END(counterUpd);
-    GyroStateSet(gyrosData);
+    publishGyroState(gyrosData);
     AccelStateSet(accelStateData);
 
     return 0;
@@ -604,6 +606,21 @@ static inline void apply_accel_filter(const float *raw, float *filtered)
     }
 }
 
+/**
+ * Hand the gyros to the inner loop, through the fast path if it is active
+ * in which case GyroState is only updated at a reduced rate
+ */
+static void publishGyroState(GyroStateData *gyros)
+{
+    static uint8_t divider = 0;
+
+    gyrofastpath_publish(&gyros->x);
+    if (!gyrofastpath_active() || ++divider >= GYROFASTPATH_UAVOBJECT_DIVIDER) {
+        GyroStateSet(gyros);
+        divider = 0;
+    }
+}
+
 __attribute__((optimize("O3"))) static void updateAttitude(AccelStateData *accelStateData, GyroStateData *gyrosData)
 {
     float dT      = PIOS_DELTATIME_GetAverageSeconds(&dtconfig);
@@ -37,18 +37,23 @@
 #include "debuglogentry.h"
 #include "flightstatus.h"
 
+// Maximum number of DebugLogEntry instances, i.e. entries pushed per stream request
+#define LOGGING_STREAM_WINDOW 8
+
 // private variables
 static DebugLogSettingsData settings;
 static DebugLogControlData control;
 static DebugLogStatusData status;
 static FlightStatusData flightstatus;
 static DebugLogEntryData *entry; // would be better on stack but event dispatcher stack might be insufficient
+static uint16_t streamWindow;
 
 // private functions
 static void SettingsUpdatedCb(UAVObjEvent *ev);
 static void ControlUpdatedCb(UAVObjEvent *ev);
 static void StatusUpdatedCb(UAVObjEvent *ev);
 static void FlightStatusUpdatedCb(UAVObjEvent *ev);
+static void StreamEntries(uint16_t flight, uint16_t firstEntry, uint16_t count);
 
 int32_t LoggingInitialize(void)
 {
@@ -62,6 +67,8 @@ int32_t LoggingInitialize(void)
     if (!entry) {
         return -1;
     }
+    // the other instances are only created once the GCS streams the log
+    streamWindow = UAVObjGetNumInstances(DebugLogEntryHandle());
 
     return 0;
 }
@@ -133,6 +140,8 @@ static void ControlUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
             entry->Type   = DEBUGLOGENTRY_TYPE_EMPTY;
         }
         DebugLogEntrySet(entry);
+    } else if (control.Operation == DEBUGLOGCONTROL_OPERATION_STREAM) {
+        StreamEntries(control.Flight, control.Entry, control.Count);
     } else if (control.Operation == DEBUGLOGCONTROL_OPERATION_FORMATFLASH) {
         uint8_t armed;
         FlightStatusArmedGet(&armed);
@@ -143,6 +152,43 @@ static void ControlUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
     StatusUpdatedCb(ev);
 }
 
+/**
+ * Push consecutive log entries to the GCS, one per DebugLogEntry instance,
+ * so that a whole window of entries costs a single request.
+ * \param[in] flight Flight to read from
+ * \param[in] firstEntry First entry to send
+ * \param[in] count Number of entries requested, limited to the number of instances
+ */
+static void StreamEntries(uint16_t flight, uint16_t firstEntry, uint16_t count)
+{
+    // One instance per entry in flight, a failed allocation only shrinks the window
+    while (streamWindow < count && streamWindow < LOGGING_STREAM_WINDOW) {
+        DebugLogEntryCreateInstance();
+        uint16_t instances = UAVObjGetNumInstances(DebugLogEntryHandle());
+        if (instances == streamWindow) {
+            break;
+        }
+        streamWindow = instances;
+    }
+
+    if (count > streamWindow) {
+        count = streamWindow;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        memset(entry, 0, sizeof(DebugLogEntryData));
+        if (PIOS_DEBUGLOG_Read(entry, flight, firstEntry + i) != 0) {
+            // end of the flight, mark as non existent and stop streaming
+            entry->Flight = flight;
+            entry->Entry  = firstEntry + i;
+            entry->Type   = DEBUGLOGENTRY_TYPE_EMPTY;
+            count = i + 1;
+        }
+        DebugLogEntryInstSet(i, entry);
+        DebugLogEntryInstUpdated(i);
+    }
+}
+
 
 /**
  * @}
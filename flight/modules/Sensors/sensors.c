@@ -61,6 +61,8 @@
 #include <revosettings.h>
 
 #include <mathmisc.h>
+#include <butterworth.h>
+#include <gyrofastpath.h>
 #include <taskinfo.h>
 #include <pios_math.h>
 #include <pios_constants.h>
@@ -100,6 +102,13 @@ static const float temp_alpha_gyro_accel = LPF_ALPHA(TEMP_DT_GYRO_ACCEL, TEMP_LP
 static const float temp_alpha_baro = TEMP_DT_BARO / (TEMP_DT_BARO + 1.0f / (2.0f * M_PI_F * TEMP_LPF_FC_BARO));
 
 
+// Decimation filter for sensors delivering sample blocks faster than PIOS_SENSOR_RATE
+#define BATCH_LPF_FC             (0.4f * PIOS_SENSOR_RATE)
+// Restart the decimation filter when no block arrived for this long
+#define BATCH_MAX_GAP_US         ((uint32_t)(10.0f * 1e6f / PIOS_SENSOR_RATE))
+// A block can be late by a cycle or two, the sensor is only reset after this many cycles without one
+#define BATCH_MAX_MISSED_CYCLES  10
+
 #define ZERO_ROT_ANGLE           0.00001f
 // Private types
 typedef struct {
@@ -109,6 +118,20 @@ typedef struct {
     uint32_t   count;
 } sensor_fetch_context;
 
+typedef struct {
+    // low pass run over every sample of the blocks, its last output is published
+    struct ButterWorthDF2Filter filter;
+    float    wn[MAX_SENSORS_PER_INSTANCE][3][2];
+    float    out[MAX_SENSORS_PER_INSTANCE][3];
+    int16_t  temperature;
+    uint16_t period; // input sample period the filter is set up for
+    uint32_t timestamp; // of the last block
+    uint32_t count; // samples filtered since the last publish
+    uint8_t  missed; // task cycles without a block
+} sensor_batch_context;
+
+#define MAX_BATCH_DATA_SIZE  (sizeof(PIOS_SENSORS_3Axis_SensorsBatch) + PIOS_SENSORS_MAX_BATCH_SAMPLES * MAX_SENSORS_PER_INSTANCE * sizeof(Vector3i16))
+
 #define MAX_SENSOR_DATA_SIZE (sizeof(PIOS_SENSORS_3Axis_SensorsWithTemp) + MAX_SENSORS_PER_INSTANCE * sizeof(Vector3i16))
 typedef union {
     PIOS_SENSORS_3Axis_SensorsWithTemp sensorSample3Axis;
@@ -132,6 +155,8 @@ static void settingsUpdatedCb(UAVObjEvent *objEv);
 static void accumulateSamples(sensor_fetch_context *sensor_context, sensor_data *sample);
 static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SENSORS_Instance *sensor);
 static void processSamples1d(PIOS_SENSORS_1Axis_SensorsWithTemp *sample, const PIOS_SENSORS_Instance *sensor);
+static void filterBatch(sensor_batch_context *batch_context, const PIOS_SENSORS_3Axis_SensorsBatch *batch);
+static void processBatch3d(sensor_batch_context *batch_context, const PIOS_SENSORS_Instance *sensor);
 
 static void clearContext(sensor_fetch_context *sensor_context);
 
@@ -146,6 +171,7 @@ static void updateBaroTempBias(float temperature);
 
 // Private variables
 static sensor_data *source_data;
+static PIOS_SENSORS_3Axis_SensorsBatch *batch_data;
 static xTaskHandle sensorsTaskHandle;
 RevoCalibrationData cal;
 AccelGyroSettingsData agcal;
@@ -188,6 +214,14 @@ static int8_t rotate = 0;
 int32_t SensorsInitialize(void)
 {
     source_data = (sensor_data *)pios_malloc(MAX_SENSOR_DATA_SIZE);
+
+    PIOS_SENSORS_Instance *sensor;
+    LL_FOREACH(PIOS_SENSORS_GetList(), sensor) {
+        if (sensor->driver->is_batched && !batch_data) {
+            batch_data = (PIOS_SENSORS_3Axis_SensorsBatch *)pios_malloc(MAX_BATCH_DATA_SIZE);
+            PIOS_Assert(batch_data);
+        }
+    }
     GyroSensorInitialize();
     AccelSensorInitialize();
     MagSensorInitialize();
@@ -239,6 +273,7 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
 {
     portTickType lastSysTime;
     sensor_fetch_context sensor_context;
+    static sensor_batch_context batch_context;
     bool error = false;
     const PIOS_SENSORS_Instance *sensors_list = PIOS_SENSORS_GetList();
     PIOS_SENSORS_Instance *sensor;
@@ -296,15 +331,29 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
 
             if (!sensor->driver->is_polled) {
                 const QueueHandle_t queue = PIOS_SENSORS_GetQueue(sensor);
-                while (xQueueReceive(queue,
-                                     (void *)source_data,
-                                     (is_primary && !sensor_context.count) ? sensor_period_ticks : 0) == pdTRUE) {
-                    accumulateSamples(&sensor_context, source_data);
+                if (sensor->driver->is_batched) {
+                    while (xQueueReceive(queue,
+                                         (void *)batch_data,
+                                         (is_primary && !batch_context.count) ? sensor_period_ticks : 0) == pdTRUE) {
+                        filterBatch(&batch_context, batch_data);
+                    }
+                } else {
+                    while (xQueueReceive(queue,
+                                         (void *)source_data,
+                                         (is_primary && !sensor_context.count) ? sensor_period_ticks : 0) == pdTRUE) {
+                        accumulateSamples(&sensor_context, source_data);
+                    }
                 }
                 if (sensor_context.count) {
                     processSamples3d(&sensor_context, sensor);
                     clearContext(&sensor_context);
+                } else if (batch_context.count) {
+                    processBatch3d(&batch_context, sensor);
+                    batch_context.missed = 0;
+                } else if (sensor->driver->is_batched && ++batch_context.missed < BATCH_MAX_MISSED_CYCLES) {
+                    // no new block yet, the last output stays published
                 } else if (is_primary) {
+                    batch_context.missed = 0;
                     PIOS_SENSOR_Reset(sensor);
                     reset_counter++;
                     PERF_TRACK_VALUE(counterSensorResets, reset_counter);
@@ -393,6 +442,76 @@ static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SE
     }
 }
 
+/**
+ * Run the decimation filter over all samples of a block
+ */
+static void filterBatch(sensor_batch_context *batch_context, const PIOS_SENSORS_3Axis_SensorsBatch *batch)
+{
+    const uint8_t count = MIN(batch->count, MAX_SENSORS_PER_INSTANCE);
+    const Vector3i16 *sample = batch->sample;
+
+    if (!batch->samples) {
+        return;
+    }
+
+    // after a gap or a rate change restart from the first sample instead of decaying from stale values
+    if (batch->period != batch_context->period ||
+        (batch->timestamp - batch_context->timestamp) > BATCH_MAX_GAP_US) {
+        const float ff = MIN(BATCH_LPF_FC * batch->period * 1e-6f, 0.45f);
+        InitButterWorthDF2Filter(ff, &batch_context->filter);
+        for (uint8_t i = 0; i < count; i++) {
+            InitButterWorthDF2Values(sample[i].x, &batch_context->filter, &batch_context->wn[i][0][0], &batch_context->wn[i][0][1]);
+            InitButterWorthDF2Values(sample[i].y, &batch_context->filter, &batch_context->wn[i][1][0], &batch_context->wn[i][1][1]);
+            InitButterWorthDF2Values(sample[i].z, &batch_context->filter, &batch_context->wn[i][2][0], &batch_context->wn[i][2][1]);
+        }
+        batch_context->period = batch->period;
+    }
+    batch_context->timestamp = batch->timestamp;
+
+    for (uint32_t n = 0; n < batch->samples; n++, sample += batch->count) {
+        for (uint8_t i = 0; i < count; i++) {
+            float(*wn)[2] = batch_context->wn[i];
+            batch_context->out[i][0] = FilterButterWorthDF2(sample[i].x, &batch_context->filter, &wn[0][0], &wn[0][1]);
+            batch_context->out[i][1] = FilterButterWorthDF2(sample[i].y, &batch_context->filter, &wn[1][0], &wn[1][1]);
+            batch_context->out[i][2] = FilterButterWorthDF2(sample[i].z, &batch_context->filter, &wn[2][0], &wn[2][1]);
+        }
+    }
+    batch_context->temperature = batch->temperature;
+    batch_context->count += batch->samples;
+}
+
+/**
+ * Publish the decimation filter output
+ */
+static void processBatch3d(sensor_batch_context *batch_context, const PIOS_SENSORS_Instance *sensor)
+{
+    float samples[3];
+    float scales[MAX_SENSORS_PER_INSTANCE];
+    const float temperature = (float)batch_context->temperature * 0.01f;
+
+    PIOS_SENSORS_GetScales(sensor, scales, MAX_SENSORS_PER_INSTANCE);
+    if (sensor->type & PIOS_SENSORS_TYPE_3AXIS_ACCEL) {
+        samples[0] = batch_context->out[0][0] * scales[0];
+        samples[1] = batch_context->out[0][1] * scales[0];
+        samples[2] = batch_context->out[0][2] * scales[0];
+        PERF_TRACK_VALUE(counterAccelSamples, batch_context->count);
+        PERF_MEASURE_PERIOD(counterAccelPeriod);
+        handleAccel(samples, temperature);
+    }
+
+    if (sensor->type & PIOS_SENSORS_TYPE_3AXIS_GYRO) {
+        uint8_t index = 0;
+        if (sensor->type == PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL) {
+            index = 1;
+        }
+        samples[0] = batch_context->out[index][0] * scales[index];
+        samples[1] = batch_context->out[index][1] * scales[index];
+        samples[2] = batch_context->out[index][2] * scales[index];
+        handleGyro(samples, temperature);
+    }
+    batch_context->count = 0;
+}
+
 static void processSamples1d(PIOS_SENSORS_1Axis_SensorsWithTemp *sample, const PIOS_SENSORS_Instance *sensor)
 {
     switch (sensor->type) {
@@ -438,6 +557,8 @@ static void handleGyro(float *samples, float temperature)
     gyroSensorData.y = samples[1];
     gyroSensorData.z = samples[2];
 
+    // the inner loop gets the sample first, StateEstimation through the UAVObject
+    gyrofastpath_publish(samples);
     GyroSensorSet(&gyroSensorData);
 }
 
@@ -49,6 +49,7 @@
 #include <stabilization.h>
 #include <virtualflybar.h>
 #include <cruisecontrol.h>
+#include <gyrofastpath.h>
 
 // Private constants
 
@@ -70,6 +71,8 @@ static float speedScaleFactor = 1.0f;
 // Private functions
 static void stabilizationInnerloopTask();
 static void GyroStateUpdatedCb(__attribute__((unused)) UAVObjEvent *ev);
+static void GyroFastPathCb();
+static void SettingsUpdatedCb(__attribute__((unused)) UAVObjEvent *ev);
 #ifdef REVOLUTION
 static void AirSpeedUpdatedCb(__attribute__((unused)) UAVObjEvent *ev);
 #endif
@@ -92,6 +95,8 @@ void stabilizationInnerloopInit()
 
     callbackHandle = PIOS_CALLBACKSCHEDULER_Create(&stabilizationInnerloopTask, CALLBACK_PRIORITY, CBTASK_PRIORITY, CALLBACKINFO_RUNNING_STABILIZATION1, STACK_SIZE_BYTES);
     GyroStateConnectCallback(GyroStateUpdatedCb);
+    StabilizationSettingsConnectCallback(SettingsUpdatedCb);
+    SettingsUpdatedCb(NULL);
 
     // schedule dead calls every FAILSAFE_TIMEOUT_MS to have the watchdog cleared
     PIOS_CALLBACKSCHEDULER_Schedule(callbackHandle, FAILSAFE_TIMEOUT_MS, CALLBACK_UPDATEMODE_LATER);
@@ -179,6 +184,17 @@ static pid_scaler create_pid_scaler(int axis)
  */
 static void stabilizationInnerloopTask()
 {
+    if (gyrofastpath_connected()) {
+        float gyro[3];
+        uint32_t samples = gyrofastpath_read(gyro);
+        if (samples) {
+            gyro_filtered[0] = gyro_filtered[0] * stabSettings.gyro_alpha + gyro[0] * (1 - stabSettings.gyro_alpha);
+            gyro_filtered[1] = gyro_filtered[1] * stabSettings.gyro_alpha + gyro[1] * (1 - stabSettings.gyro_alpha);
+            gyro_filtered[2] = gyro_filtered[2] * stabSettings.gyro_alpha + gyro[2] * (1 - stabSettings.gyro_alpha);
+            stabSettings.monitor.gyroupdates += samples;
+        }
+    }
+
     // watchdog and error handling
     {
 #ifdef PIOS_INCLUDE_WDG
@@ -354,6 +370,11 @@ static void GyroStateUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
     GyroStateData gyroState;
 
+    if (gyrofastpath_active()) {
+        // GyroState only updates at a reduced rate, the samples arrive via GyroFastPathCb
+        return;
+    }
+
     GyroStateGet(&gyroState);
 
     gyro_filtered[0] = gyro_filtered[0] * stabSettings.gyro_alpha + gyroState.x * (1 - stabSettings.gyro_alpha);
@@ -364,6 +385,20 @@ static void GyroStateUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
     stabSettings.monitor.gyroupdates++;
 }
 
+// called by the producer of the gyro samples, the sample is read by the inner loop itself
+static void GyroFastPathCb()
+{
+    PIOS_CALLBACKSCHEDULER_Dispatch(callbackHandle);
+}
+
+static void SettingsUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
+{
+    uint8_t fastPath;
+
+    StabilizationSettingsGyroFastPathGet(&fastPath);
+    gyrofastpath_connect(fastPath == STABILIZATIONSETTINGS_GYROFASTPATH_TRUE ? &GyroFastPathCb : NULL);
+}
+
 #ifdef REVOLUTION
 static void AirSpeedUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
@@ -141,6 +141,7 @@ static int32_t maininit(stateFilter *self)
 
     this->first_run     = 1;
     this->accelUpdated  = 0;
+    this->magUpdated    = 0;
     this->magCalibrated = true;
     AttitudeSettingsGet(&this->attitudeSettings);
     HomeLocationGet(&this->homeLocation);
@@ -268,7 +269,8 @@ static filterResult complementaryFilter(struct data *this, float gyro[3], float
         attitudeState.Pitch = RAD2DEG(attitudeState.Pitch);
         attitudeState.Yaw   = RAD2DEG(attitudeState.Yaw);
 
-        RPY2Quaternion(&attitudeState.Roll, attitude);
+        float rpy[3] = { attitudeState.Roll, attitudeState.Pitch, attitudeState.Yaw };
+        RPY2Quaternion(rpy, attitude);
 
         this->first_run = 0;
         this->accels_filtered[0] = 0.0f;
@@ -326,7 +328,10 @@ static filterResult complementaryFilter(struct data *this, float gyro[3], float
     AttitudeStateGet(&attitudeState);
 
     // Get the current attitude estimate
-    quat_copy(&attitudeState.q1, attitude);
+    attitude[0] = attitudeState.q1;
+    attitude[1] = attitudeState.q2;
+    attitude[2] = attitudeState.q3;
+    attitude[3] = attitudeState.q4;
 
     // Apply smoothing to accel values, to reduce vibration noise before main calculations.
     apply_accel_filter(this, accel, this->accels_filtered);
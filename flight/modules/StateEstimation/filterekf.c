@@ -290,7 +290,8 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
             attitudeState.Pitch = RAD2DEG(attitudeState.Pitch);
             attitudeState.Yaw   = RAD2DEG(attitudeState.Yaw);
 
-            RPY2Quaternion(&attitudeState.Roll, this->work.attitude);
+            float rpy[3] = { attitudeState.Roll, attitudeState.Pitch, attitudeState.Yaw };
+            RPY2Quaternion(rpy, this->work.attitude);
 
             INSSetState(this->work.pos, (float *)zeros, this->work.attitude, (float *)zeros, (float *)zeros);
 
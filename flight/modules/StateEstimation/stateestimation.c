@@ -55,6 +55,7 @@
 #include "flightstatus.h"
 
 #include "CoordinateConversions.h"
+#include <gyrofastpath.h>
 
 // Private constants
 #define STACK_SIZE_BYTES        256
@@ -477,6 +478,7 @@ static void StateEstimationCb(void)
             gyroDelta[0] = states.gyro[0] - gyroRaw[0];
             gyroDelta[1] = states.gyro[1] - gyroRaw[1];
             gyroDelta[2] = states.gyro[2] - gyroRaw[2];
+            gyrofastpath_set_correction(gyroDelta);
         }
         EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_3_DIMENSIONS(AccelState, accel, x, y, z);
         if (IS_SET(states.updated, SENSORUPDATES_mag)) {
@@ -582,15 +584,20 @@ static void sensorUpdatedCb(UAVObjEvent *ev)
     }
 
     if (ev->obj == GyroSensorHandle()) {
+        static uint8_t gyroStateDivider = 0;
         updatedSensors |= SENSORUPDATES_gyro;
-        // shortcut - update GyroState right away
-        GyroSensorData s;
-        GyroStateData t;
-        GyroSensorGet(&s);
-        t.x = s.x + gyroDelta[0];
-        t.y = s.y + gyroDelta[1];
-        t.z = s.z + gyroDelta[2];
-        GyroStateSet(&t);
+        // shortcut - update GyroState right away, or at a reduced rate
+        // if the inner loop gets the samples from a fast path producer
+        if (!gyrofastpath_active() || ++gyroStateDivider >= GYROFASTPATH_UAVOBJECT_DIVIDER) {
+            GyroSensorData s;
+            GyroStateData t;
+            GyroSensorGet(&s);
+            t.x = s.x + gyroDelta[0];
+            t.y = s.y + gyroDelta[1];
+            t.z = s.z + gyroDelta[2];
+            GyroStateSet(&t);
+            gyroStateDivider = 0;
+        }
     }
 
     if (ev->obj == AccelSensorHandle()) {
@@ -92,6 +92,9 @@
 
 #define TASK_PRIORITY           (tskIDLE_PRIORITY + 1)
 
+// Slots migrated per background garbage collection step, one step per system loop
+#define FLASHFS_GC_MAX_SLOTS    8
+
 // Private types
 
 // Private variables
@@ -113,6 +116,7 @@ static void callbackSchedulerForEachCallback(int16_t callback_id, const struct p
 static void updateStats();
 static void updateSystemAlarms();
 static void systemTask(void *parameters);
+static void collectFlashGarbage();
 #ifdef DIAG_I2C_WDG_STATS
 static void updateI2Cstats();
 static void updateWDGstats();
@@ -295,6 +299,8 @@ static void systemTask(__attribute__((unused)) void *parameters)
 
 #endif /* if defined(PIOS_INCLUDE_RFM22B) */
 
+        collectFlashGarbage();
+
         if (xQueueReceive(objectPersistenceQueue, &ev, delayTime) == pdTRUE) {
             // If object persistence is updated call the callback
             objectUpdatedCb(&ev);
@@ -445,9 +451,36 @@ static void callbackSchedulerForEachCallback(int16_t callback_id, const struct p
     ((uint8_t *)&callbackData->Running)[callback_id] = callback_info->is_running;
     ((uint32_t *)&callbackData->RunningTime)[callback_id]   = callback_info->running_time_count;
     ((int16_t *)&callbackData->StackRemaining)[callback_id] = callback_info->stack_remaining;
+    ((uint32_t *)&callbackData->LatencyBelow100us)[callback_id] = callback_info->dispatch_latency[0];
+    ((uint32_t *)&callbackData->LatencyBelow1ms)[callback_id]   = callback_info->dispatch_latency[1];
+    ((uint32_t *)&callbackData->LatencyBelow10ms)[callback_id]  = callback_info->dispatch_latency[2];
+    ((uint32_t *)&callbackData->LatencyAbove10ms)[callback_id]  = callback_info->dispatch_latency[3];
 }
 #endif /* ifdef DIAG_TASKS */
 
+/**
+ * Collect garbage on the flash filesystems a few slots at a time, so saving
+ * settings rarely has to wait for a complete garbage collection.
+ * Only done while disarmed, erasing a sector of the internal flash stalls
+ * the CPU for hundreds of ms.
+ */
+static void collectFlashGarbage()
+{
+    uint8_t armed;
+
+    FlightStatusArmedGet(&armed);
+    if (armed != FLIGHTSTATUS_ARMED_DISARMED) {
+        return;
+    }
+
+    if (pios_uavo_settings_fs_id) {
+        PIOS_FLASHFS_CollectGarbage(pios_uavo_settings_fs_id, FLASHFS_GC_MAX_SLOTS);
+    }
+    if (pios_user_fs_id) {
+        PIOS_FLASHFS_CollectGarbage(pios_user_fs_id, FLASHFS_GC_MAX_SLOTS);
+    }
+}
+
 /**
  * Called periodically to update the I2C statistics
  */
@@ -639,6 +672,10 @@ void vApplicationIdleHook(void)
 #ifdef PIOS_INCLUDE_WS2811
     LedNotificationExtLedsRun();
 #endif
+#if defined(ARCH_POSIX)
+    // in a lockstep simulation the next tick is due, do not spin on the host cpu
+    vPortLockstepIdle();
+#endif
 }
 /**
  * Called by the RTOS when a stack overflow is detected.
@@ -35,9 +35,14 @@
 #include "telemetry.h"
 
 #include "flighttelemetrystats.h"
+#include "flighttelemetrylinkstats.h"
 #include "gcstelemetrystats.h"
+#include "gcstelemetryfeatures.h"
 #include "hwsettings.h"
 #include "taskinfo.h"
+#if defined(PIOS_TELEM_SCHEDULER) && defined(PIOS_INCLUDE_RFM22B)
+#include "oplinksettings.h"
+#endif
 
 // Private constants
 #define MAX_QUEUE_SIZE            TELEM_QUEUE_SIZE
@@ -61,10 +66,42 @@
 #define TASK_PRIORITY_RADRX       (tskIDLE_PRIORITY + 2)
 #define REQ_TIMEOUT_MS            250
 #define MAX_RETRIES               2
+// acked updates and requests are retransmitted asynchronously, MAX_RETRIES sends each at most
+#define MAX_RETRANSMITS           (MAX_RETRIES - 1)
 #define STATS_UPDATE_PERIOD_MS    4000
 #define CONNECTION_TIMEOUT_MS     8000
+#define MAX_BATCH_OBJECTS         8
+
+#if defined(PIOS_TELEM_SCHEDULER)
+#if !defined(PIOS_TELEM_PRIORITY_QUEUE)
+#error PIOS_TELEM_SCHEDULER requires PIOS_TELEM_PRIORITY_QUEUE
+#endif
+// Periodic updates of regular objects get a byte budget from their update period,
+// scaled down so that all of them together fit in a share of the link throughput
+#define SCHED_MAX_PENDING         32
+#define SCHED_OVERHEAD_BYTES      12 // UAVTalk header, instance id and crc of each object
+#define SCHED_BURST_UPDATES       2 // depth of an object budget, in updates
+#define SCHED_PERIODIC_SHARE      75 // percent of the link throughput for periodic updates
+#define SCHED_LINK_BURST_MS       250 // depth of the link budget
+#define SCHED_MAX_REFILL_MS       10000
+#endif
 
 // Private types
+#if defined(PIOS_TELEM_SCHEDULER)
+/**
+ * Token bucket of a regular object sent periodically
+ */
+struct TelemetryBudgetStruct {
+    UAVObjHandle obj; /** The object */
+    uint16_t     periodMs; /** Telemetry update period in ms or 0 if not periodic */
+    uint16_t     cost; /** Bytes sent by one update of all instances */
+    uint32_t     rate; /** Budget in bytes/s or 0 if not limited */
+    int32_t      tokens; /** Available budget in 1/1000 bytes */
+    uint32_t     lastRefillMs; /** Time of the last refill */
+    struct TelemetryBudgetStruct *next; /** Needed by linked list library (utlist.h) */
+};
+typedef struct TelemetryBudgetStruct TelemetryBudget;
+#endif
 
 // Private variables
 static uint32_t telemetryPort;
@@ -91,6 +128,21 @@ static UAVTalkConnection uavTalkCon;
 #ifdef PIOS_INCLUDE_RFM22B
 static UAVTalkConnection radioUavTalkCon;
 #endif
+// Periodic updates waiting to be sent together
+static UAVObjHandle batchObjs[MAX_BATCH_OBJECTS];
+static uint16_t batchInstIds[MAX_BATCH_OBJECTS];
+static uint8_t batchCount;
+static uint32_t txCoalesced;
+#if defined(PIOS_TELEM_SCHEDULER)
+// Link throughput of the telemetry port in bytes/s, 0 if unknown
+static uint32_t linkRate;
+static int32_t linkTokens;
+static uint32_t linkLastRefillMs;
+static TelemetryBudget *budgets;
+// Events taken from the regular queue waiting for their budget
+static UAVObjEvent pendingEvents[SCHED_MAX_PENDING];
+static uint8_t pendingCount;
+#endif
 
 // Private functions
 static void telemetryTxTask(void *parameters);
@@ -105,10 +157,22 @@ static void updateObject(UAVObjHandle obj, int32_t eventType);
 static int32_t setUpdatePeriod(UAVObjHandle obj, int32_t updatePeriodMs);
 static int32_t setLoggingPeriod(UAVObjHandle obj, int32_t updatePeriodMs);
 static void processObjEvent(UAVObjEvent *ev);
+static void handleObjEvent(UAVObjEvent *ev);
+static bool batchObjEvent(UAVObjEvent *ev);
+static void flushBatch();
+static int32_t startTransaction(UAVObjHandle obj, uint16_t instId, bool request);
+static void processTransactions();
 static void updateTelemetryStats();
 static void gcsTelemetryStatsUpdated();
 static void updateSettings();
 static uint32_t getComPort(bool input);
+#if defined(PIOS_TELEM_SCHEDULER)
+static void setBudget(UAVObjHandle obj, uint16_t periodMs);
+static void updateBudgets();
+static bool takeBudget(UAVObjEvent *ev, uint32_t timeNow);
+static bool linkSaturated();
+static bool scheduleObjEvent(UAVObjEvent *ev);
+#endif
 
 /**
  * Initialise the telemetry module
@@ -145,10 +209,14 @@ int32_t TelemetryStart(void)
 int32_t TelemetryInitialize(void)
 {
     FlightTelemetryStatsInitialize();
+    FlightTelemetryLinkStatsInitialize();
     GCSTelemetryStatsInitialize();
+    GCSTelemetryFeaturesInitialize();
 
     // Initialize vars
     timeOfLastObjectUpdate = 0;
+    batchCount  = 0;
+    txCoalesced = 0;
 
     // Create object queues
     queue = xQueueCreate(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
@@ -227,12 +295,18 @@ static void updateObject(UAVObjHandle obj, int32_t eventType)
     case UPDATEMODE_PERIODIC:
         // Set update period
         setUpdatePeriod(obj, metadata.telemetryUpdatePeriod);
+#if defined(PIOS_TELEM_SCHEDULER)
+        setBudget(obj, metadata.telemetryUpdatePeriod);
+#endif
         // Connect queue
         eventMask |= EV_UPDATED_PERIODIC | EV_UPDATED_MANUAL | EV_UPDATE_REQ;
         break;
     case UPDATEMODE_ONCHANGE:
         // Set update period
         setUpdatePeriod(obj, 0);
+#if defined(PIOS_TELEM_SCHEDULER)
+        setBudget(obj, 0);
+#endif
         // Connect queue
         eventMask |= EV_UPDATED | EV_UPDATED_MANUAL | EV_UPDATE_REQ;
         break;
@@ -243,6 +317,10 @@ static void updateObject(UAVObjHandle obj, int32_t eventType)
             // Set update period on initialization and metadata change
             if (eventType == EV_NONE) {
                 setUpdatePeriod(obj, metadata.telemetryUpdatePeriod);
+#if defined(PIOS_TELEM_SCHEDULER)
+                // throttled periodic events only switch the event mask back, they are not sent
+                setBudget(obj, 0);
+#endif
             }
         } else {
             // Otherwise, we just received an object update, so switch to periodic for the timeout period to prevent more updates
@@ -252,6 +330,9 @@ static void updateObject(UAVObjHandle obj, int32_t eventType)
     case UPDATEMODE_MANUAL:
         // Set update period
         setUpdatePeriod(obj, 0);
+#if defined(PIOS_TELEM_SCHEDULER)
+        setBudget(obj, 0);
+#endif
         // Connect queue
         eventMask |= EV_UPDATED_MANUAL | EV_UPDATE_REQ;
         break;
@@ -322,31 +403,28 @@ static void processObjEvent(UAVObjEvent *ev)
         if ((ev->event == EV_UPDATED && (updateMode == UPDATEMODE_ONCHANGE || updateMode == UPDATEMODE_THROTTLED))
             || ev->event == EV_UPDATED_MANUAL
             || (ev->event == EV_UPDATED_PERIODIC && updateMode != UPDATEMODE_THROTTLED)) {
-            // Send update to GCS (with retries)
-            while (retries < MAX_RETRIES && success == -1) {
-                // call blocks until ack is received or timeout
-                success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS);
-                if (success == -1) {
-                    ++retries;
+            if (UAVObjGetTelemetryAcked(&metadata)) {
+                // Send update to GCS, the ack is handled asynchronously
+                if (startTransaction(ev->obj, ev->instId, false) == -1) {
+                    ++txErrors;
                 }
-            }
-            // Update stats
-            txRetries += retries;
-            if (success == -1) {
-                ++txErrors;
-            }
-        } else if (ev->event == EV_UPDATE_REQ) {
-            // Request object update from GCS (with retries)
-            while (retries < MAX_RETRIES && success == -1) {
-                // call blocks until update is received or timeout
-                success = UAVTalkSendObjectRequest(uavTalkCon, ev->obj, ev->instId, REQ_TIMEOUT_MS);
+            } else {
+                // Send update to GCS (with retries)
+                while (retries < MAX_RETRIES && success == -1) {
+                    success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, 0, REQ_TIMEOUT_MS);
+                    if (success == -1) {
+                        ++retries;
+                    }
+                }
+                // Update stats
+                txRetries += retries;
                 if (success == -1) {
-                    ++retries;
+                    ++txErrors;
                 }
             }
-            // Update stats
-            txRetries += retries;
-            if (success == -1) {
+        } else if (ev->event == EV_UPDATE_REQ) {
+            // Request object update from GCS, the update is handled asynchronously
+            if (startTransaction(ev->obj, ev->instId, true) == -1) {
                 ++txErrors;
             }
         }
@@ -383,6 +461,269 @@ static void processObjEvent(UAVObjEvent *ev)
     }
 }
 
+/**
+ * Queue event handler, periodic updates are collected into a batch that is sent
+ * in one go, any other event first flushes the batch to preserve ordering.
+ */
+static void handleObjEvent(UAVObjEvent *ev)
+{
+    if (!batchObjEvent(ev)) {
+        flushBatch();
+        processObjEvent(ev);
+    }
+}
+
+/**
+ * Add the event to the pending batch if it is a plain periodic update that
+ * needs no ack nor any further processing.
+ * \return true if the event was batched
+ */
+static bool batchObjEvent(UAVObjEvent *ev)
+{
+    UAVObjMetadata metadata;
+
+    if (ev->obj == 0 || ev->event != EV_UPDATED_PERIODIC || UAVObjIsMetaobject(ev->obj) || !UAVObjIsSingleInstance(ev->obj)) {
+        return false;
+    }
+    UAVObjGetMetadata(ev->obj, &metadata);
+    if (UAVObjGetTelemetryUpdateMode(&metadata) != UPDATEMODE_PERIODIC || UAVObjGetTelemetryAcked(&metadata)
+        || UAVObjGetLoggingUpdateMode(&metadata) == UPDATEMODE_THROTTLED) {
+        return false;
+    }
+
+    if (batchCount == MAX_BATCH_OBJECTS) {
+        flushBatch();
+    }
+    batchObjs[batchCount]    = ev->obj;
+    batchInstIds[batchCount] = 0;
+    ++batchCount;
+    return true;
+}
+
+/**
+ * Send the pending batch of periodic updates
+ */
+static void flushBatch()
+{
+    if (batchCount > 0) {
+        if (UAVTalkSendObjects(uavTalkCon, batchObjs, batchInstIds, batchCount) == -1) {
+            ++txErrors;
+        }
+        batchCount = 0;
+    }
+}
+
+/**
+ * Start an acked update or an update request, waiting for room in the window
+ * of transactions in flight if needed.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t startTransaction(UAVObjHandle obj, uint16_t instId, bool request)
+{
+    int32_t ret;
+
+    while ((ret = UAVTalkStartTransaction(uavTalkCon, obj, instId, request)) == -2) {
+        // window full, sleep until a response arrives or the oldest transaction timed out
+        UAVTalkWaitTransactionSlot(uavTalkCon);
+        processTransactions();
+    }
+    return ret;
+}
+
+/**
+ * Retransmit acked updates and requests that timed out
+ */
+static void processTransactions()
+{
+    uint32_t retries;
+
+    txErrors  += UAVTalkProcessTransactions(uavTalkCon, MAX_RETRANSMITS, &retries);
+    txRetries += retries;
+}
+
+#if defined(PIOS_TELEM_SCHEDULER)
+/**
+ * Set the budget of an object from its telemetry update period. Only regular
+ * objects are budgeted, priority objects go through the priority queue.
+ * \param[in] obj The object
+ * \param[in] periodMs The telemetry update period in ms, 0 if not sent periodically
+ */
+static void setBudget(UAVObjHandle obj, uint16_t periodMs)
+{
+    TelemetryBudget *budget;
+
+    LL_FOREACH(budgets, budget) {
+        if (budget->obj == obj) {
+            break;
+        }
+    }
+    if (budget == NULL) {
+        if (periodMs == 0 || UAVObjIsPriority(obj)) {
+            return;
+        }
+        budget = (TelemetryBudget *)pios_malloc(sizeof(TelemetryBudget));
+        if (budget == NULL) {
+            // the object is sent without limit
+            return;
+        }
+        memset(budget, 0, sizeof(TelemetryBudget));
+        budget->obj = obj;
+        LL_APPEND(budgets, budget);
+    }
+    budget->periodMs = periodMs;
+    updateBudgets();
+    // the first update goes out right away
+    budget->tokens   = (int32_t)budget->cost * 1000;
+    budget->lastRefillMs = xTaskGetTickCount() * portTICK_RATE_MS;
+}
+
+/**
+ * Share the periodic part of the link throughput among the periodic objects. As long as
+ * all of them fit they are not limited, otherwise each one gets a rate proportional to
+ * what it asks for, which stretches all update periods by the same factor.
+ */
+static void updateBudgets()
+{
+    TelemetryBudget *budget;
+    uint32_t demand = 0;
+    uint32_t share  = linkRate * SCHED_PERIODIC_SHARE / 100;
+
+    LL_FOREACH(budgets, budget) {
+        budget->cost = (UAVObjGetNumBytes(budget->obj) + SCHED_OVERHEAD_BYTES) * UAVObjGetNumInstances(budget->obj);
+        if (budget->periodMs > 0) {
+            demand += (uint32_t)budget->cost * 1000 / budget->periodMs;
+        }
+    }
+    LL_FOREACH(budgets, budget) {
+        if (budget->periodMs == 0 || share == 0 || demand <= share) {
+            budget->rate = 0;
+        } else {
+            budget->rate = (uint32_t)((uint64_t)budget->cost * 1000 / budget->periodMs * share / demand);
+            if (budget->rate == 0) {
+                budget->rate = 1;
+            }
+        }
+    }
+}
+
+/**
+ * Take the cost of a periodic update from the budget of its object
+ * \param[in] ev The event
+ * \param[in] timeNow The system time in ms
+ * \return true if the event can be sent now
+ * \return false if it has to wait for more budget
+ */
+static bool takeBudget(UAVObjEvent *ev, uint32_t timeNow)
+{
+    TelemetryBudget *budget;
+
+    if (ev->event != EV_UPDATED_PERIODIC) {
+        return true;
+    }
+    LL_FOREACH(budgets, budget) {
+        if (budget->obj == ev->obj) {
+            break;
+        }
+    }
+    if (budget == NULL || budget->rate == 0) {
+        return true;
+    }
+
+    // refill, ms times bytes/s gives 1/1000 bytes
+    uint32_t elapsedMs = timeNow - budget->lastRefillMs;
+    int32_t cost  = (int32_t)budget->cost * 1000;
+    int32_t depth = cost * SCHED_BURST_UPDATES;
+
+    if (elapsedMs > SCHED_MAX_REFILL_MS) {
+        elapsedMs = SCHED_MAX_REFILL_MS;
+    }
+    budget->tokens += (int32_t)(elapsedMs * budget->rate);
+    if (budget->tokens > depth) {
+        budget->tokens = depth;
+    }
+    budget->lastRefillMs = timeNow;
+
+    if (budget->tokens < cost) {
+        return false;
+    }
+    budget->tokens -= cost;
+    return true;
+}
+
+/**
+ * Check whether the bytes sent recently exceed the link throughput
+ * \return true if the link is saturated
+ */
+static bool linkSaturated()
+{
+    if (linkRate == 0 || getComPort(false) != telemetryPort) {
+        return false;
+    }
+
+    uint32_t timeNow   = xTaskGetTickCount() * portTICK_RATE_MS;
+    uint32_t elapsedMs = timeNow - linkLastRefillMs;
+    int32_t depth = (int32_t)(linkRate * SCHED_LINK_BURST_MS);
+
+    if (elapsedMs > SCHED_MAX_REFILL_MS) {
+        elapsedMs = SCHED_MAX_REFILL_MS;
+    }
+    linkTokens += (int32_t)(elapsedMs * linkRate);
+    if (linkTokens > depth) {
+        linkTokens = depth;
+    }
+    linkLastRefillMs = timeNow;
+
+    return linkTokens <= 0;
+}
+
+/**
+ * Move the events of the regular queue to the pending list and pick the oldest one
+ * that its budget allows to be sent. The object data are read when an event is sent,
+ * so an event equal to one already pending is redundant and dropped. A periodic update
+ * without budget stays pending and absorbs the next ones of the same object, its period
+ * gets longer instead of losing random events to a full queue.
+ * \param[out] ev The event to send
+ * \return true if an event was picked
+ */
+static bool scheduleObjEvent(UAVObjEvent *ev)
+{
+    uint32_t timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    bool limited     = linkRate > 0 && getComPort(false) == telemetryPort;
+    uint8_t i;
+
+    while (pendingCount < SCHED_MAX_PENDING && xQueueReceive(queue, ev, 0) == pdTRUE) {
+        for (i = 0; i < pendingCount; i++) {
+            if (pendingEvents[i].obj == ev->obj && pendingEvents[i].instId == ev->instId && pendingEvents[i].event == ev->event) {
+                break;
+            }
+        }
+        if (i < pendingCount) {
+            ++txCoalesced;
+        } else {
+            pendingEvents[pendingCount++] = *ev;
+        }
+    }
+
+    for (i = 0; i < pendingCount; i++) {
+        if (!limited || takeBudget(&pendingEvents[i], timeNow)) {
+            *ev = pendingEvents[i];
+            --pendingCount;
+            memmove(&pendingEvents[i], &pendingEvents[i + 1], (pendingCount - i) * sizeof(UAVObjEvent));
+            return true;
+        }
+    }
+
+    if (pendingCount == SCHED_MAX_PENDING) {
+        // every pending event waits for budget, skip the oldest one so the queue keeps moving
+        --pendingCount;
+        memmove(&pendingEvents[0], &pendingEvents[1], pendingCount * sizeof(UAVObjEvent));
+        ++txCoalesced;
+    }
+    return false;
+}
+#endif /* PIOS_TELEM_SCHEDULER */
+
 /**
  * Telemetry transmit task, regular priority
  */
@@ -392,29 +733,66 @@ static void telemetryTxTask(__attribute__((unused)) void *parameters)
 
     // Loop forever
     while (1) {
+        processTransactions();
+
         /**
          * Tries to empty the high priority queue before handling any standard priority item
          */
-#if defined(PIOS_TELEM_PRIORITY_QUEUE)
+#if defined(PIOS_TELEM_SCHEDULER)
+        // empty priority queue, non-blocking, one event per cycle while the link is saturated
+        // so the periodic updates keep their share during bursts of settings
+        while (xQueueReceive(priorityQueue, &ev, 0) == pdTRUE) {
+            // Process event
+            handleObjEvent(&ev);
+            if (linkSaturated()) {
+                break;
+            }
+        }
+        // pick a regular event within its budget - non-blocking
+        if (scheduleObjEvent(&ev)) {
+            // Process event
+            handleObjEvent(&ev);
+        } else {
+            // nothing to send right now, send what was batched so far
+            flushBatch();
+            // wait on priority queue for updates (1 tick) then repeat cycle
+            if (xQueueReceive(priorityQueue, &ev, 1) == pdTRUE) {
+                // Process event
+                handleObjEvent(&ev);
+            }
+        }
+#elif defined(PIOS_TELEM_PRIORITY_QUEUE)
         // empty priority queue, non-blocking
         while (xQueueReceive(priorityQueue, &ev, 0) == pdTRUE) {
             // Process event
-            processObjEvent(&ev);
+            handleObjEvent(&ev);
         }
         // check regular queue and process update - non-blocking
         if (xQueueReceive(queue, &ev, 0) == pdTRUE) {
             // Process event
-            processObjEvent(&ev);
-            // if both queues are empty, wait on priority queue for updates (1 tick) then repeat cycle
-        } else if (xQueueReceive(priorityQueue, &ev, 1) == pdTRUE) {
-            // Process event
-            processObjEvent(&ev);
+            handleObjEvent(&ev);
+        } else {
+            // both queues are empty, send what was batched so far
+            flushBatch();
+            // wait on priority queue for updates (1 tick) then repeat cycle
+            if (xQueueReceive(priorityQueue, &ev, 1) == pdTRUE) {
+                // Process event
+                handleObjEvent(&ev);
+            }
         }
 #else
-        // wait on queue for updates (1 tick) then repeat cycle
-        if (xQueueReceive(queue, &ev, 1) == pdTRUE) {
+        // check queue and process update - non-blocking
+        if (xQueueReceive(queue, &ev, 0) == pdTRUE) {
             // Process event
-            processObjEvent(&ev);
+            handleObjEvent(&ev);
+        } else {
+            // queue is empty, send what was batched so far
+            flushBatch();
+            // wait on queue for updates (1 tick) then repeat cycle
+            if (xQueueReceive(queue, &ev, 1) == pdTRUE) {
+                // Process event
+                handleObjEvent(&ev);
+            }
         }
 #endif /* if defined(PIOS_TELEM_PRIORITY_QUEUE) */
     }
@@ -500,6 +878,15 @@ static int32_t transmitData(uint8_t *data, int32_t length)
     uint32_t outputPort = getComPort(false);
 
     if (outputPort) {
+#if defined(PIOS_TELEM_SCHEDULER)
+        if (outputPort == telemetryPort) {
+            // estimate only, the receive task sends acks as well
+            linkTokens -= length * 1000;
+            if (linkTokens < -(int32_t)(linkRate * 1000)) {
+                linkTokens = -(int32_t)(linkRate * 1000);
+            }
+        }
+#endif
         return PIOS_COM_SendBuffer(outputPort, data, length);
     }
 
@@ -583,7 +970,9 @@ static void gcsTelemetryStatsUpdated()
 static void updateTelemetryStats()
 {
     UAVTalkStats utalkStats;
+    UAVTalkLinkStats linkStats;
     FlightTelemetryStatsData flightStats;
+    FlightTelemetryLinkStatsData flightLinkStats;
     GCSTelemetryStatsData gcsStats;
     uint8_t forceUpdate;
     uint8_t connectionTimeout;
@@ -594,9 +983,11 @@ static void updateTelemetryStats()
 #ifdef PIOS_INCLUDE_RFM22B
     UAVTalkAddStats(radioUavTalkCon, &utalkStats, true);
 #endif
+    UAVTalkGetLinkStats(uavTalkCon, &linkStats);
 
     // Get object data
     FlightTelemetryStatsGet(&flightStats);
+    FlightTelemetryLinkStatsGet(&flightLinkStats);
     GCSTelemetryStatsGet(&gcsStats);
 
     // Update stats object
@@ -611,6 +1002,12 @@ static void updateTelemetryStats()
         flightStats.RxFailures   += utalkStats.rxErrors;
         flightStats.RxSyncErrors += utalkStats.rxSyncErrors;
         flightStats.RxCrcErrors  += utalkStats.rxCrcErrors;
+
+        flightLinkStats.TxInFlight        = linkStats.inFlight;
+        flightLinkStats.TxMaxInFlight     = linkStats.maxInFlight;
+        flightLinkStats.RoundTripTime     = linkStats.rttMs;
+        flightLinkStats.RetransmitTimeout = linkStats.rtoMs;
+        flightLinkStats.TxCoalesced      += txCoalesced;
     } else {
         flightStats.TxDataRate   = 0;
         flightStats.TxBytes      = 0;
@@ -622,9 +1019,16 @@ static void updateTelemetryStats()
         flightStats.RxFailures   = 0;
         flightStats.RxSyncErrors = 0;
         flightStats.RxCrcErrors  = 0;
+
+        flightLinkStats.TxInFlight        = 0;
+        flightLinkStats.TxMaxInFlight     = 0;
+        flightLinkStats.RoundTripTime     = 0;
+        flightLinkStats.RetransmitTimeout = 0;
+        flightLinkStats.TxCoalesced       = 0;
     }
-    txErrors  = 0;
-    txRetries = 0;
+    txErrors    = 0;
+    txRetries   = 0;
+    txCoalesced = 0;
 
     // Check for connection timeout
     timeNow   = xTaskGetTickCount() * portTICK_RATE_MS;
@@ -654,6 +1058,9 @@ static void updateTelemetryStats()
     } else if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
         if (gcsStats.Status != GCSTELEMETRYSTATS_STATUS_CONNECTED || connectionTimeout) {
             flightStats.Status = FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED;
+            // the next GCS announces its own features, an older one none at all
+            uint8_t features = 0;
+            GCSTelemetryFeaturesFeaturesSet(&features);
         } else {
             forceUpdate = 0;
         }
@@ -667,8 +1074,18 @@ static void updateTelemetryStats()
         AlarmsClear(SYSTEMALARMS_ALARM_TELEMETRY);
     }
 
-    // Update object
+    // Enable the optional protocol features (UAVTALK_FEATURE_*) announced by the GCS while connected
+    if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
+        uint8_t features;
+        GCSTelemetryFeaturesFeaturesGet(&features);
+        UAVTalkSetFeatures(uavTalkCon, features);
+    } else {
+        UAVTalkSetFeatures(uavTalkCon, 0);
+    }
+
+    // Update objects
     FlightTelemetryStatsSet(&flightStats);
+    FlightTelemetryLinkStatsSet(&flightLinkStats);
 
     // Force telemetry update if not connected
     if (forceUpdate) {
@@ -688,32 +1105,70 @@ static void updateSettings()
     if (telemetryPort) {
         // Retrieve settings
         uint8_t speed;
+        uint32_t baud = 0;
         HwSettingsTelemetrySpeedGet(&speed);
 
         // Set port speed
         switch (speed) {
         case HWSETTINGS_TELEMETRYSPEED_2400:
-            PIOS_COM_ChangeBaud(telemetryPort, 2400);
+            baud = 2400;
             break;
         case HWSETTINGS_TELEMETRYSPEED_4800:
-            PIOS_COM_ChangeBaud(telemetryPort, 4800);
+            baud = 4800;
             break;
         case HWSETTINGS_TELEMETRYSPEED_9600:
-            PIOS_COM_ChangeBaud(telemetryPort, 9600);
+            baud = 9600;
             break;
         case HWSETTINGS_TELEMETRYSPEED_19200:
-            PIOS_COM_ChangeBaud(telemetryPort, 19200);
+            baud = 19200;
             break;
         case HWSETTINGS_TELEMETRYSPEED_38400:
-            PIOS_COM_ChangeBaud(telemetryPort, 38400);
+            baud = 38400;
             break;
         case HWSETTINGS_TELEMETRYSPEED_57600:
-            PIOS_COM_ChangeBaud(telemetryPort, 57600);
+            baud = 57600;
             break;
         case HWSETTINGS_TELEMETRYSPEED_115200:
-            PIOS_COM_ChangeBaud(telemetryPort, 115200);
+            baud = 115200;
             break;
         }
+        if (baud) {
+            PIOS_COM_ChangeBaud(telemetryPort, baud);
+        }
+
+#if defined(PIOS_TELEM_SCHEDULER)
+#ifdef PIOS_INCLUDE_RFM22B
+        if (telemetryPort == PIOS_COM_RF) {
+            // the throughput of the onboard radio is set by the OPLink com speed
+            uint8_t comSpeed;
+            OPLinkSettingsInitialize();
+            OPLinkSettingsComSpeedGet(&comSpeed);
+            switch (comSpeed) {
+            case OPLINKSETTINGS_COMSPEED_4800:
+                baud = 4800;
+                break;
+            case OPLINKSETTINGS_COMSPEED_9600:
+                baud = 9600;
+                break;
+            case OPLINKSETTINGS_COMSPEED_19200:
+                baud = 19200;
+                break;
+            case OPLINKSETTINGS_COMSPEED_38400:
+                baud = 38400;
+                break;
+            case OPLINKSETTINGS_COMSPEED_57600:
+                baud = 57600;
+                break;
+            case OPLINKSETTINGS_COMSPEED_115200:
+                baud = 115200;
+                break;
+            }
+        }
+#endif /* PIOS_INCLUDE_RFM22B */
+        // 10 bits per byte with start and stop bits
+        linkRate = baud / 10;
+        updateBudgets();
+#endif /* PIOS_TELEM_SCHEDULER */
     }
 }
 
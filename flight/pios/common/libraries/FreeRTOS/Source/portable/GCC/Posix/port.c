@@ -88,6 +88,16 @@ more accurate high frequency ticks than a timer signal handler.
 All public functions in this port are protected by a safeguard mutex which
 assures priority access on all data objects
 
+Optionally the supervisor runs in lockstep mode (vPortEnableLockstep) instead.
+The tick is then not bound to the wall clock but hit as soon as all tasks are
+blocked and the idle task runs, so simulated time advances as fast as the host
+allows and the order of events only depends on the tasks themselves. A task
+that keeps running without ever blocking still gets preempted by a tick after
+portLOCKSTEP_TIMEOUT_US of wall clock time. Such forced ticks depend on the
+host and are counted, a run without any is reproducible.
+When the requested simulated time has passed the supervisor stops ticking and
+the idle task calls the end hook, in task context, before the process exits.
+
 This approach is tested and works both on Linux and BSD style Unix (MAC OS X)
 
 */
@@ -160,6 +170,16 @@ static volatile portBASE_TYPE xPendYield = pdFALSE;
 static volatile portLONG lIndexOfLastAddedTask = 0;
 /*-----------------------------------------------------------*/
 
+/* Lockstep mode, simulated time in microseconds and the tick to end the run at */
+#define portLOCKSTEP_TIMEOUT_US		100000
+static portBASE_TYPE xLockstep = pdFALSE;
+static TickType_t xLockstepEndTick = 0;
+static void (*pxLockstepEndHook)( void ) = NULL;
+static volatile portBASE_TYPE xLockstepEnded = pdFALSE;
+static unsigned long ulLockstepForcedTicks = 0;
+static volatile unsigned long long ullSimulatedTimeUS = 0;
+/*-----------------------------------------------------------*/
+
 /*
  * Setup the timer to generate the tick interrupts.
  */
@@ -172,6 +192,7 @@ static xThreadState* prvGetThreadHandleByThread( pthread_t hThread );
 static portLONG prvGetFreeThreadState( void );
 static void prvDeleteThread( void *xThreadId );
 static void prvPortYield();
+static void prvRunLockstep( void );
 /*-----------------------------------------------------------*/
 
 /*
@@ -291,6 +312,11 @@ portBASE_TYPE xPortStartScheduler( void )
 	/* Start the first task. This gives up the RunningThreadMutex*/
 	vPortStartFirstTask();
 
+	if ( pdTRUE == xLockstep )
+	{
+		prvRunLockstep();
+	}
+
 	/**
 	 * Main scheduling loop. Call the tick handler every
 	 * portTICK_RATE_MICROSECONDS
@@ -346,6 +372,115 @@ portBASE_TYPE xPortStartScheduler( void )
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * lockstep variant of the scheduling loop, hit the tick whenever the system
+ * is idle and end the scheduler once the requested simulated time has passed
+ */
+static void prvRunLockstep( void )
+{
+	unsigned long long ullLastTimeUS = ullSimulatedTimeUS;
+	portLONG busyTimeUS = 0;
+	struct timespec wait = { 0, 1000 };
+	struct timeval lastTime,currentTime;
+	gettimeofday( &lastTime, NULL );
+
+	while ( pdTRUE != xSchedulerEnd )
+	{
+		if ( xTaskGetCurrentTaskHandle() == xTaskGetIdleTaskHandle() )
+		{
+			/* all tasks are blocked, the idle task ends the run from here on */
+			if ( xLockstepEndTick != 0 && ullSimulatedTimeUS >= (unsigned long long)xLockstepEndTick * portTICK_RATE_MICROSECONDS )
+			{
+				xLockstepEnded = pdTRUE;
+			}
+			if ( pdTRUE != xLockstepEnded )
+			{
+				vPortSystemTickHandler();
+			}
+		}
+		else if ( busyTimeUS >= portLOCKSTEP_TIMEOUT_US )
+		{
+			ulLockstepForcedTicks++;
+			vPortSystemTickHandler();
+		}
+
+		if ( ullSimulatedTimeUS != ullLastTimeUS )
+		{
+			ullLastTimeUS = ullSimulatedTimeUS;
+			gettimeofday( &lastTime, NULL );
+			busyTimeUS = 0;
+		}
+		else
+		{
+			/**
+			 * either some task is still running or the tick handler backed off
+			 * because the task was switching or in a critical section, give up
+			 * the cpu to let it get on
+			 */
+			nanosleep( &wait, NULL );
+			gettimeofday( &currentTime, NULL );
+			busyTimeUS = 1000000 * ( currentTime.tv_sec - lastTime.tv_sec ) + ( currentTime.tv_usec - lastTime.tv_usec );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * switch the supervisor to lockstep mode, must be called before the scheduler
+ * is started. A non zero xRunTicks ends the process after that many ticks,
+ * pxEndHook is then called from the idle task first unless it is NULL.
+ */
+void vPortEnableLockstep( TickType_t xRunTicks, void (*pxEndHook)( void ) )
+{
+	PORT_ASSERT( pdFALSE == xSchedulerStarted );
+
+	xLockstep = pdTRUE;
+	xLockstepEndTick = xRunTicks;
+	pxLockstepEndHook = pxEndHook;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortIsLockstep( void )
+{
+	return xLockstep;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * called from the idle task, in lockstep mode the idle task gives up the host
+ * cpu so the supervisor can hit the next tick right away. Once the run is over
+ * no other task gets to run again, the end hook is called and the process ends.
+ */
+void vPortLockstepIdle( void )
+{
+	struct timespec wait = { 0, 1000 };
+
+	if ( pdTRUE == xLockstep )
+	{
+		if ( pdTRUE == xLockstepEnded )
+		{
+			if ( NULL != pxLockstepEndHook )
+			{
+				pxLockstepEndHook();
+			}
+			/* tearing down the task threads is not reliable, just leave */
+			PORT_PRINT( "Lockstep simulation finished after %u ticks, %lu forced ticks.\n", (unsigned int)xLockstepEndTick, ulLockstepForcedTicks );
+			exit( 0 );
+		}
+		nanosleep( &wait, NULL );
+	}
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * time since the scheduler start as counted by the tick handler
+ */
+unsigned long long ullPortGetSimulatedTimeUS( void )
+{
+	return ullSimulatedTimeUS;
+}
+/*-----------------------------------------------------------*/
+
 /**
  * quickly clean up all running threads, without asking them first
  */
@@ -647,6 +782,7 @@ void vPortSystemTickHandler()
 	 * call tick handler
 	 */
 	xTaskIncrementTick();
+	ullSimulatedTimeUS += portTICK_RATE_MICROSECONDS;
 
 	
 #if ( configUSE_PREEMPTION == 1 )
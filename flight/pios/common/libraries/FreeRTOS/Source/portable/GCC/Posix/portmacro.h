@@ -158,6 +158,12 @@ extern void vPortForciblyEndThread( void *pxTaskToDelete );
 extern void vPortAddTaskHandle( void *pxTaskHandle );
 #define traceTASK_CREATE( pxNewTCB )			vPortAddTaskHandle( pxNewTCB )
 
+/* Lockstep simulation, the tick advances whenever all tasks are blocked. */
+extern void vPortEnableLockstep( TickType_t xRunTicks, void (*pxEndHook)( void ) );
+extern portBASE_TYPE xPortIsLockstep( void );
+extern void vPortLockstepIdle( void );
+extern unsigned long long ullPortGetSimulatedTimeUS( void );
+
 /* Posix Signal definitions that can be changed or read as appropriate. */
 #define SIG_SUSPEND					SIGUSR1
 
@@ -40,10 +40,18 @@
 // Private types
 /**
  * task information
+ * Callbacks that have been dispatched wait in a FIFO ready queue per priority,
+ * scheduled callbacks wait in a delayed queue sorted by schedule time.
+ * The ready queues are also fed from interrupts and are protected by disabling
+ * interrupts, the delayed queue is protected by the scheduler mutex.
  */
 struct DelayedCallbackTaskStruct {
     DelayedCallbackInfo *callbackQueue[CALLBACK_PRIORITY_LOW + 1];
-    DelayedCallbackInfo *queueCursor[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *readyHead[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *readyTail[CALLBACK_PRIORITY_LOW + 1];
+    uint16_t callbackCount[CALLBACK_PRIORITY_LOW + 1];
+    uint16_t turns[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *delayedQueue;
     xTaskHandle callbackSchedulerTaskHandle;
     char name[3];
     uint32_t    stackSize;
@@ -58,8 +66,11 @@ struct DelayedCallbackTaskStruct {
 struct DelayedCallbackInfoStruct {
     DelayedCallback   cb;
     int16_t callbackID;
+    DelayedCallbackPriority priority;
     bool volatile     waiting;
     uint32_t volatile scheduletime;
+    uint32_t readyTime;
+    uint32_t latencyCount[PIOS_CALLBACKSCHEDULER_LATENCY_BUCKETS];
     uint32_t stackSize;
     int32_t  stackFree;
     int32_t  stackNotFree;
@@ -68,6 +79,8 @@ struct DelayedCallbackInfoStruct {
     uint32_t runCount;
     struct DelayedCallbackTaskStruct *task;
     struct DelayedCallbackInfoStruct *next;
+    struct DelayedCallbackInfoStruct *readyNext;
+    struct DelayedCallbackInfoStruct *delayedNext;
 };
 
 
@@ -76,9 +89,16 @@ static struct DelayedCallbackTaskStruct *schedulerTasks;
 static xSemaphoreHandle mutex;
 static bool schedulerStarted;
 
+// upper bounds in us of the dispatch latency histogram buckets, the last bucket is open
+static const uint32_t latencyBounds[PIOS_CALLBACKSCHEDULER_LATENCY_BUCKETS - 1] = { 100, 1000, 10000 };
+
 // Private functions
 static void CallbackSchedulerTask(void *task);
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task);
+static DelayedCallbackInfo *nextReadyCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static void enqueueReady(DelayedCallbackInfo *cbinfo);
+static void insertDelayed(DelayedCallbackInfo *cbinfo);
+static void removeDelayed(DelayedCallbackInfo *cbinfo);
 
 /**
  * Initialize the scheduler
@@ -185,8 +205,10 @@ int32_t PIOS_CALLBACKSCHEDULER_Schedule(
             result = 1;
         } else {
             result = 2;
+            removeDelayed(cbinfo);
         }
         cbinfo->scheduletime = new;
+        insertDelayed(cbinfo);
 
         // scheduler needs to be notified to adapt sleep times
         xSemaphoreGive(cbinfo->task->signal);
@@ -207,8 +229,10 @@ int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo)
 {
     PIOS_Assert(cbinfo);
 
-    // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    // no semaphore needed for the callback, the ready queue is shared with interrupts
+    PIOS_IRQ_Disable();
+    enqueueReady(cbinfo);
+    PIOS_IRQ_Enable();
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGive(cbinfo->task->signal);
 }
@@ -231,8 +255,10 @@ int32_t PIOS_CALLBACKSCHEDULER_DispatchFromISR(DelayedCallbackInfo *cbinfo, long
 {
     PIOS_Assert(cbinfo);
 
-    // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    // no semaphore needed for the callback, the ready queue is shared with other interrupts
+    PIOS_IRQ_Disable();
+    enqueueReady(cbinfo);
+    PIOS_IRQ_Enable();
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGiveFromISR(cbinfo->task->signal, pxHigherPriorityTaskWoken);
 }
@@ -282,8 +308,12 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
         // initialize structure
         for (DelayedCallbackPriority p = 0; p <= CALLBACK_PRIORITY_LOW; p++) {
             task->callbackQueue[p] = NULL;
-            task->queueCursor[p]   = NULL;
+            task->readyHead[p]     = NULL;
+            task->readyTail[p]     = NULL;
+            task->callbackCount[p] = 0;
+            task->turns[p]         = 0;
         }
+        task->delayedQueue = NULL;
         task->name[0]      = 'C';
         task->name[1]      = 'a' + t;
         task->name[2]      = 0;
@@ -335,8 +365,13 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
         return NULL; // error - not enough memory
     }
     info->next               = NULL;
+    info->readyNext          = NULL;
+    info->delayedNext        = NULL;
+    info->priority           = priority;
     info->waiting            = false;
     info->scheduletime       = 0;
+    info->readyTime          = 0;
+    memset(info->latencyCount, 0, sizeof(info->latencyCount));
     info->task               = task;
     info->cb = cb;
     info->callbackID         = callbackID;
@@ -347,8 +382,9 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
     info->stackSafetyCount   = STACK_SAFETYCOUNT;
     info->currentSafetyCount = 0;
 
-    // add to scheduling queue
+    // add to list of callbacks
     LL_APPEND(task->callbackQueue[priority], info);
+    task->callbackCount[priority]++;
 
     xSemaphoreGiveRecursive(mutex);
 
@@ -380,6 +416,7 @@ void PIOS_CALLBACKSCHEDULER_ForEachCallback(CallbackSchedulerCallbackInfoCallbac
                 info.is_running = true;
                 info.stack_remaining    = cbinfo->stackNotFree;
                 info.running_time_count = cbinfo->runCount;
+                memcpy(info.dispatch_latency, cbinfo->latencyCount, sizeof(info.dispatch_latency));
                 xSemaphoreGiveRecursive(mutex);
                 callback(cbinfo->callbackID, &info, context);
             }
@@ -457,76 +494,168 @@ static void checkStack(DelayedCallbackInfo *current)
     }
 }
 
+/**
+ * Append a callback to the ready queue of its priority, unless it is already waiting there.
+ * Must be called with interrupts disabled.
+ * \param[in] cbinfo the callback handle
+ */
+static void enqueueReady(DelayedCallbackInfo *cbinfo)
+{
+    struct DelayedCallbackTaskStruct *task = cbinfo->task;
+
+    if (cbinfo->waiting) {
+        return;
+    }
+    cbinfo->waiting   = true;
+    cbinfo->readyNext = NULL;
+    cbinfo->readyTime = PIOS_DELAY_GetRaw();
+    if (task->readyTail[cbinfo->priority]) {
+        task->readyTail[cbinfo->priority]->readyNext = cbinfo;
+    } else {
+        task->readyHead[cbinfo->priority] = cbinfo;
+    }
+    task->readyTail[cbinfo->priority] = cbinfo;
+}
+
+/**
+ * Take the next callback to run off the ready queues. Higher priorities go first, but
+ * after as many runs as there are callbacks of a priority a ready callback of lower
+ * priority gets a turn, so a busy callback cannot starve the lower priorities.
+ * Must be called with interrupts disabled.
+ * \param[in] task The scheduler task in question
+ * \param[in] priority The highest scheduling priority to search
+ * \return the callback, NULL if none is ready
+ */
+static DelayedCallbackInfo *nextReadyCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+{
+    DelayedCallbackInfo *cbinfo;
+
+    // no such queue
+    if (priority > CALLBACK_PRIORITY_LOW) {
+        return NULL;
+    }
+
+    if (task->turns[priority] >= task->callbackCount[priority]) {
+        task->turns[priority] = 0;
+        cbinfo = nextReadyCallback(task, priority + 1);
+        if (cbinfo) {
+            return cbinfo;
+        }
+    }
+
+    cbinfo = task->readyHead[priority];
+    if (cbinfo == NULL) {
+        // queue is empty, search a lower priority queue
+        return nextReadyCallback(task, priority + 1);
+    }
+    task->readyHead[priority] = cbinfo->readyNext;
+    if (task->readyHead[priority] == NULL) {
+        task->readyTail[priority] = NULL;
+    }
+    task->turns[priority]++;
+    return cbinfo;
+}
+
+/**
+ * Insert a callback into the delayed queue, sorted by schedule time.
+ * Must be called with the scheduler mutex taken.
+ * \param[in] cbinfo the callback handle
+ */
+static void insertDelayed(DelayedCallbackInfo *cbinfo)
+{
+    DelayedCallbackInfo **cursor = &cbinfo->task->delayedQueue;
+
+    while (*cursor && (int32_t)((*cursor)->scheduletime - cbinfo->scheduletime) <= 0) {
+        cursor = &(*cursor)->delayedNext;
+    }
+    cbinfo->delayedNext = *cursor;
+    *cursor = cbinfo;
+}
+
+/**
+ * Remove a callback from the delayed queue.
+ * Must be called with the scheduler mutex taken.
+ * \param[in] cbinfo the callback handle
+ */
+static void removeDelayed(DelayedCallbackInfo *cbinfo)
+{
+    DelayedCallbackInfo **cursor = &cbinfo->task->delayedQueue;
+
+    while (*cursor && *cursor != cbinfo) {
+        cursor = &(*cursor)->delayedNext;
+    }
+    if (*cursor) {
+        *cursor = cbinfo->delayedNext;
+    }
+    cbinfo->delayedNext = NULL;
+}
+
 /**
  * Scheduler subtask
  * \param[in] task The scheduler task in question
- * \param[in] priority The scheduling priority of the callback to search for
  * \return wait time until next scheduled callback is due - 0 if a callback has just been executed
  */
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task)
 {
     int32_t result = MAX_SLEEP;
-    int32_t diff   = 0;
+    DelayedCallbackInfo *current;
 
-    // no such queue
-    if (priority > CALLBACK_PRIORITY_LOW) {
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
+
+    // callbacks whose schedule time has come are ready to run
+    uint32_t now = xTaskGetTickCount();
+    while (task->delayedQueue) {
+        int32_t diff = task->delayedQueue->scheduletime - now;
+        if (diff > 0) {
+            result = (diff < result) ? diff : result; // adjust sleep time
+            break;
+        }
+        current = task->delayedQueue;
+        task->delayedQueue    = current->delayedNext;
+        current->delayedNext  = NULL;
+        current->scheduletime = 0;
+        PIOS_IRQ_Disable();
+        enqueueReady(current);
+        PIOS_IRQ_Enable();
+    }
+
+    PIOS_IRQ_Disable();
+    current = nextReadyCallback(task, CALLBACK_PRIORITY_CRITICAL);
+    if (current) {
+        current->waiting = false; // the flag is reset just before execution.
+    }
+    PIOS_IRQ_Enable();
+
+    if (current == NULL) {
+        // nothing to do
+        xSemaphoreGiveRecursive(mutex);
         return result;
     }
 
-    // queue is empty, search a lower priority queue
-    if (task->callbackQueue[priority] == NULL) {
-        return runNextCallback(task, priority + 1);
+    if (current->scheduletime) {
+        removeDelayed(current);
+        current->scheduletime = 0; // any schedules are reset
     }
+    xSemaphoreGiveRecursive(mutex);
 
-    DelayedCallbackInfo *current = task->queueCursor[priority];
-    DelayedCallbackInfo *next;
-    do {
-        if (current == NULL) {
-            next = task->callbackQueue[priority]; // loop around the end of the list
-            // also attempt to run a callback that has lower priority
-            // every time the queue is completely traversed
-            diff = runNextCallback(task, priority + 1);
-            if (!diff) {
-                task->queueCursor[priority] = next; // the recursive call has executed a callback
-                return 0;
-            }
-            if (diff < result) {
-                result = diff; // adjust sleep time
-            }
-        } else {
-            next = current->next;
-            xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
-            if (current->scheduletime) {
-                diff = current->scheduletime - xTaskGetTickCount();
-                if (diff <= 0) {
-                    current->waiting = true;
-                } else if (diff < result) {
-                    result = diff; // adjust sleep time
-                }
-            }
-            if (current->waiting) {
-                task->queueCursor[priority] = next;
-                current->scheduletime = 0; // any schedules are reset
-                current->waiting = false; // the flag is reset just before execution.
-                xSemaphoreGiveRecursive(mutex);
+    // account the dispatch latency
+    uint32_t latency = PIOS_DELAY_DiffuS(current->readyTime);
+    uint8_t bucket   = 0;
+    while (bucket < PIOS_CALLBACKSCHEDULER_LATENCY_BUCKETS - 1 && latency >= latencyBounds[bucket]) {
+        bucket++;
+    }
+    current->latencyCount[bucket]++;
 
-                /* callback gets invoked here - check stack sizes */
-                markStack(current);
+    /* callback gets invoked here - check stack sizes */
+    markStack(current);
 
-                current->cb(); // call the callback
+    current->cb(); // call the callback
 
-                checkStack(current);
+    checkStack(current);
 
-                current->runCount++;
+    current->runCount++;
 
-                return 0;
-            }
-            xSemaphoreGiveRecursive(mutex);
-        }
-        current = next;
-    } while (current != task->queueCursor[priority]);
-    // once the list has been traversed entirely without finding any to be executed task, abort (nothing to do)
-    return result;
+    return 0;
 }
 
 /**
@@ -538,7 +667,7 @@ static void CallbackSchedulerTask(void *task)
     uint32_t delay = 0;
 
     while (1) {
-        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task, CALLBACK_PRIORITY_CRITICAL);
+        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task);
         if (delay) {
             // nothing to do but sleep
             xSemaphoreTake(((struct DelayedCallbackTaskStruct *)task)->signal, delay);
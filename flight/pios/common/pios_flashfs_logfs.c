@@ -30,6 +30,7 @@
 #ifdef PIOS_INCLUDE_FLASH
 
 #include <stdbool.h>
+#include <string.h>
 #include <openpilot.h>
 #include <pios_math.h>
 #include <pios_wdg.h>
@@ -43,6 +44,12 @@ enum pios_flashfs_logfs_dev_magic {
     PIOS_FLASHFS_LOGFS_DEV_MAGIC = 0x94938201,
 };
 
+enum logfs_gc_state {
+    LOGFS_GC_IDLE,    /* no garbage collection in progress */
+    LOGFS_GC_ERASING, /* erasing the destination arena sector by sector */
+    LOGFS_GC_COPYING, /* migrating active slots to the destination arena */
+};
+
 struct logfs_state {
     enum pios_flashfs_logfs_dev_magic magic;
     const struct flashfs_logfs_cfg    *cfg;
@@ -56,6 +63,18 @@ struct logfs_state {
     uint16_t num_free_slots; /* slots in free state */
     uint16_t num_active_slots; /* slots in active state */
 
+    /* One key per slot of the active arena, see logfs_index_key().
+     * Lets object lookups skip the slots that can't match without
+     * reading their headers from flash. NULL if not available. */
+    uint8_t *slot_index;
+
+    /* Incremental garbage collection, see logfs_gc_step() */
+    enum logfs_gc_state gc_state;
+    uint8_t  gc_arena_id; /* destination arena */
+    uint8_t  gc_sector_id; /* next sector of the destination arena to erase */
+    uint16_t gc_src_slot_id; /* next slot of the active arena to migrate */
+    uint16_t gc_dst_slot_id; /* next free slot of the destination arena */
+
     /* Underlying flash driver glue */
     const struct pios_flash_driver *driver;
     uintptr_t flash_id;
@@ -97,6 +116,12 @@ enum arena_state {
     ARENA_STATE_ERASED   = 0xFFFFFFFF,
     ARENA_STATE_RESERVED = 0xE6E6FFFF,
     ARENA_STATE_ACTIVE   = 0xE6E66666,
+    /*
+     * Still active, but all of its contents have been migrated to
+     * another arena by the garbage collection. Only mounted if the
+     * destination never got activated due to a power loss.
+     */
+    ARENA_STATE_MIGRATED = 0xE6E60000,
     ARENA_STATE_OBSOLETE = 0x00000000,
 };
 
@@ -111,22 +136,24 @@ struct arena_header {
 ****************************************/
 
 /**
- * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @brief Erases one sector of the given arena, sets arena to erased state after the last one.
  * @return 0 if success, < 0 on failure
+ * @note Sectors must be erased in ascending order. The arena header lives in the
+ *       first one, so a partially erased arena never looks like a valid arena.
  * @note Must be called while holding the flash transaction lock
  */
-static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+static int32_t logfs_erase_arena_sector(const struct logfs_state *logfs, uint8_t arena_id, uint8_t sector_id)
 {
     uintptr_t arena_addr = logfs_get_addr(logfs, arena_id, 0);
 
-    /* Erase all of the sectors in the arena */
-    for (uint8_t sector_id = 0;
-         sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size);
-         sector_id++) {
-        if (logfs->driver->erase_sector(logfs->flash_id,
-                                        arena_addr + (sector_id * logfs->cfg->sector_size))) {
-            return -1;
-        }
+    if (logfs->driver->erase_sector(logfs->flash_id,
+                                    arena_addr + (sector_id * logfs->cfg->sector_size))) {
+        return -1;
+    }
+
+    if (sector_id + 1 < (logfs->cfg->arena_size / logfs->cfg->sector_size)) {
+        /* More sectors left to erase */
+        return 0;
     }
 
     /* Mark this arena as fully erased */
@@ -146,6 +173,26 @@ static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_
     return 0;
 }
 
+/**
+ * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+{
+    /* Erase all of the sectors in the arena */
+    for (uint8_t sector_id = 0;
+         sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size);
+         sector_id++) {
+        if (logfs_erase_arena_sector(logfs, arena_id, sector_id) != 0) {
+            return -1;
+        }
+    }
+
+    /* Arena is ready to be activated */
+    return 0;
+}
+
 /**
  * @brief Marks the given arena as reserved so it can be filled.
  * @return 0 if success, < 0 on failure
@@ -248,10 +295,54 @@ static int32_t logfs_activate_arena(const struct logfs_state *logfs, uint8_t are
     return 0;
 }
 
+/**
+ * @brief Marks the given arena as migrated once its contents have been copied elsewhere.
+ * @return 0 if success, < 0 on failure
+ * @note Arena must have been previously active or migrated before calling this
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_migrate_arena(const struct logfs_state *logfs, uint8_t arena_id)
+{
+    uintptr_t arena_addr = logfs_get_addr(logfs, arena_id, 0);
+
+    /* Make sure this arena is active */
+    struct arena_header arena_hdr;
+
+    if (logfs->driver->read_data(logfs->flash_id,
+                                 arena_addr,
+                                 (uint8_t *)&arena_hdr,
+                                 sizeof(arena_hdr)) != 0) {
+        /* Failed to read arena header */
+        return -1;
+    }
+
+    if (arena_hdr.state == ARENA_STATE_MIGRATED) {
+        /* Mounted after an earlier migration was interrupted */
+        return 0;
+    }
+
+    if (arena_hdr.state != ARENA_STATE_ACTIVE) {
+        /* Arena was not active, can't migrate it */
+        return -2;
+    }
+
+    /* Mark this arena as migrated */
+    arena_hdr.state = ARENA_STATE_MIGRATED;
+    if (logfs->driver->write_data(logfs->flash_id,
+                                  arena_addr,
+                                  (uint8_t *)&arena_hdr,
+                                  sizeof(arena_hdr)) != 0) {
+        return -3;
+    }
+
+    /* Arena may now be superseded by the destination arena */
+    return 0;
+}
+
 /**
  * @brief Marks the given arena as obsolete.
  * @return 0 if success, < 0 on failure
- * @note Arena must have been previously active before calling this
+ * @note Arena must have been previously active or migrated before calling this
  * @note Must be called while holding the flash transaction lock
  */
 static int32_t logfs_obsolete_arena(const struct logfs_state *logfs, uint8_t arena_id)
@@ -271,7 +362,8 @@ static int32_t logfs_obsolete_arena(const struct logfs_state *logfs, uint8_t are
         return -1;
     }
 
-    if (arena_hdr.state != ARENA_STATE_ACTIVE) {
+    if ((arena_hdr.state != ARENA_STATE_ACTIVE) &&
+        (arena_hdr.state != ARENA_STATE_MIGRATED)) {
         /* Arena was not previously active, can't obsolete it */
         return -2;
     }
@@ -291,13 +383,15 @@ static int32_t logfs_obsolete_arena(const struct logfs_state *logfs, uint8_t are
 
 /**
  * @brief Find the first active arena in flash
- * @return arena_id (>=0) of first active arena
+ * @return arena_id (>=0) of first active arena, or of the first migrated arena if none is active
  * @return -1 if no active arena is found
  * @return -2 if failed to read arena header
  * @note Must be called while holding the flash transaction lock
  */
 static int32_t logfs_find_active_arena(const struct logfs_state *logfs)
 {
+    int32_t migrated_arena_id = -1;
+
     /* Search for the lowest numbered active arena */
     for (uint8_t arena_id = 0;
          arena_id < logfs->cfg->total_fs_size / logfs->cfg->arena_size;
@@ -316,13 +410,19 @@ static int32_t logfs_find_active_arena(const struct logfs_state *logfs)
             /* This is the first active arena */
             return arena_id;
         }
+        if ((arena_hdr.state == ARENA_STATE_MIGRATED) &&
+            (arena_hdr.magic == logfs->cfg->fs_magic) &&
+            (migrated_arena_id < 0)) {
+            /* Power was lost before the copy of this arena was activated */
+            migrated_arena_id = arena_id;
+        }
 #ifdef PIOS_INCLUDE_WDG
         PIOS_WDG_Clear();
 #endif
     }
 
-    /* Didn't find an active arena */
-    return -1;
+    /* Didn't find an active arena, fall back to a migrated one if any */
+    return migrated_arena_id;
 }
 
 /*
@@ -353,6 +453,28 @@ struct slot_header {
     uint16_t obj_size;
 } __attribute__((packed));
 
+/* Index key of slots that are not active */
+#define LOGFS_INDEX_NONE 0xFF
+
+/**
+ * @brief Fold an object id and instance into the one byte key kept in the slot index.
+ * Different objects may share a key, a match must be confirmed with the slot header.
+ */
+static uint8_t logfs_index_key(uint32_t obj_id, uint16_t obj_inst_id)
+{
+    uint16_t key = (obj_id >> 16) ^ obj_id ^ obj_inst_id;
+    uint8_t folded = (key >> 8) ^ key;
+
+    return (folded == LOGFS_INDEX_NONE) ? (LOGFS_INDEX_NONE - 1) : folded;
+}
+
+static void logfs_index_set(const struct logfs_state *logfs, uint16_t slot_id, uint8_t key)
+{
+    if (logfs->slot_index) {
+        logfs->slot_index[slot_id] = key;
+    }
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 static int32_t logfs_raw_copy_bytes(const struct logfs_state *logfs, uintptr_t src_addr, uint16_t src_size, uintptr_t dst_addr)
 {
@@ -416,6 +538,19 @@ static bool logfs_log_is_full(const struct logfs_state *logfs)
     return logfs->num_free_slots == 0;
 }
 
+/*
+ * Is it worth starting a garbage collection in the background?
+ * true = less than a quarter of the log is free and collecting would free at least another quarter
+ * false = the log has enough room left or too few obsolete slots to be worth an erase cycle
+ */
+static bool logfs_gc_is_due(const struct logfs_state *logfs)
+{
+    uint16_t num_slots    = (logfs->cfg->arena_size / logfs->cfg->slot_size) - 1;
+    uint16_t num_obsolete = num_slots - logfs->num_free_slots - logfs->num_active_slots;
+
+    return logfs->num_free_slots < num_slots / 4 && num_obsolete >= num_slots / 4;
+}
+
 static int32_t logfs_unmount_log(struct logfs_state *logfs)
 {
     PIOS_Assert(logfs->mounted);
@@ -455,12 +590,14 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
         PIOS_Assert(slot_hdr.state == SLOT_STATE_EMPTY ||
                     logfs->num_free_slots == 0);
 
+        logfs_index_set(logfs, slot_id, LOGFS_INDEX_NONE);
         switch (slot_hdr.state) {
         case SLOT_STATE_EMPTY:
             logfs->num_free_slots++;
             break;
         case SLOT_STATE_ACTIVE:
             logfs->num_active_slots++;
+            logfs_index_set(logfs, slot_id, logfs_index_key(slot_hdr.obj_id, slot_hdr.obj_inst_id));
             break;
         case SLOT_STATE_RESERVED:
         case SLOT_STATE_OBSOLETE:
@@ -497,8 +634,16 @@ static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
 {
     /* Invalidate the magic */
     logfs->magic = ~PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    if (logfs->slot_index) {
+        vPortFree(logfs->slot_index);
+    }
     vPortFree(logfs);
 }
+static uint8_t *PIOS_FLASHFS_Logfs_alloc_index(const struct flashfs_logfs_cfg *cfg)
+{
+    /* A missing index only makes lookups slower */
+    return (uint8_t *)pios_malloc(cfg->arena_size / cfg->slot_size);
+}
 #else
 static struct logfs_state pios_flashfs_logfs_devs[PIOS_FLASHFS_LOGFS_MAX_DEVS];
 static uint8_t pios_flashfs_logfs_num_devs;
@@ -522,6 +667,11 @@ static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
 
     /* Can't free the resources with this simple allocator */
 }
+static uint8_t *PIOS_FLASHFS_Logfs_alloc_index(__attribute__((unused)) const struct flashfs_logfs_cfg *cfg)
+{
+    /* Without an allocator lookups scan the slot headers in flash */
+    return NULL;
+}
 #endif /* if defined(PIOS_INCLUDE_FREERTOS) */
 
 /**
@@ -559,6 +709,8 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
     logfs->driver   = driver; /* lower-level flash driver */
     logfs->flash_id = flash_id; /* lower-level flash device id */
     logfs->mounted  = false;
+    logfs->slot_index = PIOS_FLASHFS_Logfs_alloc_index(cfg);
+    logfs->gc_state = LOGFS_GC_IDLE;
 
     if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
         rc = -1;
@@ -629,75 +781,191 @@ out_exit:
 }
 
 /* NOTE: Must be called while holding the flash transaction lock */
-static int32_t logfs_garbage_collect(struct logfs_state *logfs)
+static void logfs_gc_start(struct logfs_state *logfs)
+{
+    PIOS_Assert(logfs->gc_state == LOGFS_GC_IDLE);
+
+    /* Destination arena is the one following the active arena */
+    logfs->gc_arena_id    = (logfs->active_arena_id + 1) % (logfs->cfg->total_fs_size / logfs->cfg->arena_size);
+    logfs->gc_sector_id   = 0;
+    logfs->gc_src_slot_id = 1;
+    logfs->gc_dst_slot_id = 1;
+    logfs->gc_state = LOGFS_GC_ERASING;
+}
+
+/**
+ * @brief Runs one bounded step of the garbage collection in progress
+ * @param[in] max_slots Maximum number of slots of the active arena to migrate in this step
+ * @return 1 if more steps are needed, 0 once the collection is complete, < 0 on failure
+ * @note A step erases at most one sector of the destination arena. The destination stays
+ *       reserved until all active slots are copied, so it is never mounted half filled.
+ *       Slots appended to the active arena meanwhile are migrated in later steps.
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_step(struct logfs_state *logfs, uint16_t max_slots)
 {
     PIOS_Assert(logfs->mounted);
 
-    /* Source arena is the active arena */
-    uint8_t src_arena_id = logfs->active_arena_id;
+    int32_t rc;
 
-    /* Compute destination arena */
-    uint8_t dst_arena_id = (logfs->active_arena_id + 1) % (logfs->cfg->total_fs_size / logfs->cfg->arena_size);
+    switch (logfs->gc_state) {
+    case LOGFS_GC_IDLE:
+        return 0;
 
-    /* Erase destination arena */
-    if (logfs_erase_arena(logfs, dst_arena_id) != 0) {
-        return -1;
-    }
+    case LOGFS_GC_ERASING:
+        if (logfs_erase_arena_sector(logfs, logfs->gc_arena_id, logfs->gc_sector_id) != 0) {
+            rc = -1;
+            goto out_abort;
+        }
+        logfs->gc_sector_id++;
+        if (logfs->gc_sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size)) {
+            return 1;
+        }
 
-    /* Reserve the destination arena so we can start filling it */
-    if (logfs_reserve_arena(logfs, dst_arena_id) != 0) {
-        /* Unable to reserve the arena */
-        return -2;
+        /* Reserve the destination arena so we can start filling it */
+        if (logfs_reserve_arena(logfs, logfs->gc_arena_id) != 0) {
+            /* Unable to reserve the arena */
+            rc = -2;
+            goto out_abort;
+        }
+        logfs->gc_state = LOGFS_GC_COPYING;
+        return 1;
+
+    case LOGFS_GC_COPYING:
+        break;
     }
 
     /* Copy active slots from active arena to destination arena */
-    uint16_t dst_slot_id = 1;
-    for (uint16_t src_slot_id = 1;
-         src_slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
-         src_slot_id++) {
+    uint16_t end_slot = (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->num_free_slots;
+    for (uint16_t n = 0;
+         n < max_slots && logfs->gc_src_slot_id < end_slot;
+         n++, logfs->gc_src_slot_id++) {
         struct slot_header slot_hdr;
-        uintptr_t src_addr = logfs_get_addr(logfs, src_arena_id, src_slot_id);
+        uintptr_t src_addr = logfs_get_addr(logfs, logfs->active_arena_id, logfs->gc_src_slot_id);
         if (logfs->driver->read_data(logfs->flash_id,
                                      src_addr,
                                      (uint8_t *)&slot_hdr,
                                      sizeof(slot_hdr)) != 0) {
-            return -3;
+            rc = -3;
+            goto out_abort;
         }
 
         if (slot_hdr.state == SLOT_STATE_ACTIVE) {
-            uintptr_t dst_addr = logfs_get_addr(logfs, dst_arena_id, dst_slot_id);
+            uintptr_t dst_addr = logfs_get_addr(logfs, logfs->gc_arena_id, logfs->gc_dst_slot_id);
             if (logfs_raw_copy_bytes(logfs,
                                      src_addr,
                                      sizeof(slot_hdr) + slot_hdr.obj_size,
                                      dst_addr) != 0) {
                 /* Failed to copy all bytes */
-                return -4;
+                rc = -4;
+                goto out_abort;
             }
-            dst_slot_id++;
+            logfs->gc_dst_slot_id++;
         }
 #ifdef PIOS_INCLUDE_WDG
         PIOS_WDG_Clear();
 #endif
     }
 
+    if (logfs->gc_src_slot_id < end_slot) {
+        return 1;
+    }
+
+    uint8_t src_arena_id = logfs->active_arena_id;
+    uint8_t dst_arena_id = logfs->gc_arena_id;
+    logfs->gc_state = LOGFS_GC_IDLE;
+
+    /* Record that the source arena is fully migrated before activating the destination */
+    if (logfs_migrate_arena(logfs, src_arena_id) != 0) {
+        return -5;
+    }
+
     /* Activate the destination arena */
     if (logfs_activate_arena(logfs, dst_arena_id) != 0) {
-        return -5;
+        return -6;
     }
 
     /* Unmount the source arena */
     if (logfs_unmount_log(logfs) != 0) {
-        return -6;
+        return -7;
     }
 
     /* Obsolete the source arena */
     if (logfs_obsolete_arena(logfs, src_arena_id) != 0) {
-        return -7;
+        return -8;
     }
 
     /* Mount the new arena */
     if (logfs_mount_log(logfs, dst_arena_id) != 0) {
-        return -8;
+        return -9;
+    }
+
+    return 0;
+
+out_abort:
+    /* The destination arena is erased again by the next collection */
+    logfs->gc_state = LOGFS_GC_IDLE;
+    return rc;
+}
+
+/**
+ * @brief Obsoletes the copy of an object already migrated by the garbage collection in progress
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_drop_copy(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+    for (uint16_t slot_id = 1; slot_id < logfs->gc_dst_slot_id; slot_id++) {
+        struct slot_header slot_hdr;
+        uintptr_t slot_addr = logfs_get_addr(logfs, logfs->gc_arena_id, slot_id);
+        if (logfs->driver->read_data(logfs->flash_id,
+                                     slot_addr,
+                                     (uint8_t *)&slot_hdr,
+                                     sizeof(slot_hdr)) != 0) {
+            return -1;
+        }
+
+        if (slot_hdr.state == SLOT_STATE_ACTIVE &&
+            slot_hdr.obj_id == obj_id &&
+            slot_hdr.obj_inst_id == obj_inst_id) {
+            slot_hdr.state = SLOT_STATE_OBSOLETE;
+            if (logfs->driver->write_data(logfs->flash_id,
+                                          slot_addr,
+                                          (uint8_t *)&slot_hdr,
+                                          sizeof(slot_hdr)) != 0) {
+                return -2;
+            }
+            return 0;
+        }
+#ifdef PIOS_INCLUDE_WDG
+        PIOS_WDG_Clear();
+#endif
+    }
+
+    return 0;
+}
+
+/* NOTE: Must be called while holding the flash transaction lock */
+static int32_t logfs_garbage_collect(struct logfs_state *logfs)
+{
+    /*
+     * Finish a collection in progress first. It may carry over slots
+     * obsoleted while it was running in the background, in which case
+     * a second complete collection is needed to free them.
+     */
+    for (uint8_t pass = 0; pass < 2 && logfs_log_is_full(logfs); pass++) {
+        if (logfs->gc_state == LOGFS_GC_IDLE) {
+            logfs_gc_start(logfs);
+        }
+
+        int32_t rc;
+        do {
+            rc = logfs_gc_step(logfs, UINT16_MAX);
+        } while (rc > 0);
+
+        if (rc != 0) {
+            return rc;
+        }
     }
 
     return 0;
@@ -714,9 +982,22 @@ static int16_t logfs_object_find_next(const struct logfs_state *logfs, struct sl
         *curr_slot = 1;
     }
 
+    const uint8_t key = logfs_index_key(obj_id, obj_inst_id);
+    /* Slots past the end of the log are all empty */
+    const uint16_t end_slot = (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->num_free_slots;
+
     for (uint16_t slot_id = *curr_slot;
          slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
          slot_id++) {
+        if (logfs->slot_index) {
+            /* Only headers of slots holding a matching key need to be read */
+            while (slot_id < end_slot && logfs->slot_index[slot_id] != key) {
+                slot_id++;
+            }
+            if (slot_id >= end_slot) {
+                break;
+            }
+        }
         uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, slot_id);
 
         if (logfs->driver->read_data(logfs->flash_id,
@@ -771,6 +1052,15 @@ static int8_t logfs_delete_object(struct logfs_state *logfs, uint32_t obj_id, ui
             }
             /* Object has been successfully obsoleted and is no longer active */
             logfs->num_active_slots--;
+            logfs_index_set(logfs, curr_slot_id, LOGFS_INDEX_NONE);
+
+            /* The garbage collection in progress may have migrated it already */
+            if (logfs->gc_state == LOGFS_GC_COPYING &&
+                curr_slot_id < logfs->gc_src_slot_id &&
+                logfs_gc_drop_copy(logfs, obj_id, obj_inst_id) != 0) {
+                /* Start over with a fresh destination arena later */
+                logfs->gc_state = LOGFS_GC_IDLE;
+            }
             break;
         case -1:
             /* Search completed, object not found */
@@ -891,9 +1181,96 @@ static int8_t logfs_append_to_log(struct logfs_state *logfs, uint32_t obj_id, ui
 
     /* Object has been successfully written to the slot */
     logfs->num_active_slots++;
+    logfs_index_set(logfs, free_slot_id, logfs_index_key(obj_id, obj_inst_id));
+    return 0;
+}
+
+
+/* NOTE: Must be called while holding the flash transaction lock */
+static int8_t logfs_save_object(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+    if (logfs_delete_object(logfs, obj_id, obj_inst_id) != 0) {
+        return -3;
+    }
+
+    /*
+     * All old versions of this object + instance have been invalidated.
+     * Write the new object.
+     */
+
+    /* Check if the arena is entirely full. */
+    if (logfs_fs_is_full(logfs)) {
+        /* Note: Filesystem Full means we're full of *active* records so gc won't help at all. */
+        return -4;
+    }
+
+    /* Is garbage collection required? */
+    if (logfs_log_is_full(logfs)) {
+        /* Note: Log Full means the log is full but may contain obsolete slots so gc may free some space */
+        if (logfs_garbage_collect(logfs) != 0) {
+            return -5;
+        }
+        /* Check one more time just to be sure we actually free'd some space */
+        if (logfs_log_is_full(logfs)) {
+            /*
+             * Log is still full even after gc!
+             * NOTE: This should not happen since the filesystem wasn't full
+             *       when we checked above so gc should have helped.
+             */
+            PIOS_DEBUG_Assert(0);
+            return -6;
+        }
+    }
+
+    /* We have room for our new object.  Append it to the log. */
+    if (logfs_append_to_log(logfs, obj_id, obj_inst_id, obj_data, obj_size) != 0) {
+        /* Error during append */
+        return -7;
+    }
+
+    /* Object successfully written to the log */
     return 0;
 }
 
+/*
+ * Is the saved version of the object identical to the given data?
+ * NOTE: Must be called while holding the flash transaction lock
+ */
+static bool logfs_object_is_unchanged(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, const uint8_t *obj_data, uint16_t obj_size)
+{
+#define COMPARE_BLOCK_SIZE 16
+    uint8_t data_block[COMPARE_BLOCK_SIZE];
+
+    uint16_t slot_id = 0;
+    struct slot_header slot_hdr;
+
+    if (logfs_object_find_next(logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
+        /* Object has never been saved */
+        return false;
+    }
+
+    if (slot_hdr.obj_size != obj_size) {
+        return false;
+    }
+
+    uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, slot_id) + sizeof(slot_hdr);
+    for (uint16_t offset = 0; offset < obj_size; offset += COMPARE_BLOCK_SIZE) {
+        uint16_t blk_size = MIN(COMPARE_BLOCK_SIZE, obj_size - offset);
+        if (logfs->driver->read_data(logfs->flash_id,
+                                     slot_addr + offset,
+                                     data_block,
+                                     blk_size) != 0) {
+            /* Can't tell, save it again */
+            return false;
+        }
+        if (memcmp(data_block, obj_data + offset, blk_size) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 
 /**********************************
  *
@@ -936,54 +1313,56 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
         goto out_exit;
     }
 
-    if (logfs_delete_object(logfs, obj_id, obj_inst_id) != 0) {
-        rc = -3;
-        goto out_end_trans;
-    }
+    rc = logfs_save_object(logfs, obj_id, obj_inst_id, obj_data, obj_size);
 
-    /*
-     * All old versions of this object + instance have been invalidated.
-     * Write the new object.
-     */
+    logfs->driver->end_transaction(logfs->flash_id);
 
-    /* Check if the arena is entirely full. */
-    if (logfs_fs_is_full(logfs)) {
-        /* Note: Filesystem Full means we're full of *active* records so gc won't help at all. */
-        rc = -4;
-        goto out_end_trans;
-    }
+out_exit:
+    return rc;
+}
 
-    /* Is garbage collection required? */
-    if (logfs_log_is_full(logfs)) {
-        /* Note: Log Full means the log is full but may contain obsolete slots so gc may free some space */
-        if (logfs_garbage_collect(logfs) != 0) {
-            rc = -5;
-            goto out_end_trans;
-        }
-        /* Check one more time just to be sure we actually free'd some space */
-        if (logfs_log_is_full(logfs)) {
-            /*
-             * Log is still full even after gc!
-             * NOTE: This should not happen since the filesystem wasn't full
-             *       when we checked above so gc should have helped.
-             */
-            PIOS_DEBUG_Assert(0);
-            rc = -6;
-            goto out_end_trans;
-        }
+/**
+ * @brief Saves a batch of objects to the filesystem in a single transaction
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] next Iterator handing out the objects to save
+ * @param[in] context Context passed to the iterator
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 to -7 as for PIOS_FLASHFS_ObjSave, the remaining objects are not saved
+ * @note Objects identical to their saved version are skipped unless flagged as changed
+ */
+int32_t PIOS_FLASHFS_ObjSaveBatch(uintptr_t fs_id, PIOS_FLASHFS_ObjIterator next, void *context)
+{
+    int8_t rc;
+
+    struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+    if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+        rc = -1;
+        goto out_exit;
     }
 
-    /* We have room for our new object.  Append it to the log. */
-    if (logfs_append_to_log(logfs, obj_id, obj_inst_id, obj_data, obj_size) != 0) {
-        /* Error during append */
-        rc = -7;
-        goto out_end_trans;
+    if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+        rc = -2;
+        goto out_exit;
     }
 
-    /* Object successfully written to the log */
     rc = 0;
 
-out_end_trans:
+    struct PIOS_FLASHFS_Obj obj;
+    while (rc == 0 && next(context, &obj)) {
+        PIOS_Assert(obj.obj_size <= (logfs->cfg->slot_size - sizeof(struct slot_header)));
+
+        if (!obj.changed &&
+            logfs_object_is_unchanged(logfs, obj.obj_id, obj.obj_inst_id, obj.obj_data, obj.obj_size)) {
+            /* Saved version is still up to date */
+            continue;
+        }
+
+        rc = logfs_save_object(logfs, obj.obj_id, obj.obj_inst_id, obj.obj_data, obj.obj_size);
+    }
+
     logfs->driver->end_transaction(logfs->flash_id);
 
 out_exit:
@@ -1126,6 +1505,7 @@ int32_t PIOS_FLASHFS_Format(uintptr_t fs_id)
     if (logfs->mounted) {
         logfs_unmount_log(logfs);
     }
+    logfs->gc_state = LOGFS_GC_IDLE;
 
     if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
         rc = -2;
@@ -1158,6 +1538,49 @@ out_end_trans:
 out_exit:
     return rc;
 }
+/**
+ * @brief Runs a bounded step of garbage collection on the filesystem
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] max_slots Maximum number of slots to migrate in this call
+ * @return 0 if no garbage collection is pending, 1 if more steps are needed, or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if the garbage collection step failed
+ * @note Meant to be called periodically from a low priority context. A collection
+ *       is started once the log runs low on free slots, so that ObjSave rarely
+ *       has to collect garbage itself while holding the flash transaction lock.
+ */
+int32_t PIOS_FLASHFS_CollectGarbage(uintptr_t fs_id, uint16_t max_slots)
+{
+    int32_t rc;
+
+    struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+    if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+        rc = -1;
+        goto out_exit;
+    }
+
+    if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+        rc = -2;
+        goto out_exit;
+    }
+
+    if (logfs->gc_state == LOGFS_GC_IDLE && logfs_gc_is_due(logfs)) {
+        logfs_gc_start(logfs);
+    }
+
+    rc = logfs_gc_step(logfs, max_slots);
+    if (rc < 0) {
+        rc = -3;
+    }
+
+    logfs->driver->end_transaction(logfs->flash_id);
+
+out_exit:
+    return rc;
+}
+
 /**
  * @brief Returs stats for the filesystems
  * @param[in] fs_id The filesystem to use for this action
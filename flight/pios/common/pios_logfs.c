@@ -157,6 +157,30 @@ int32_t PIOS_FLASHFS_ObjSave(
     return 0;
 }
 
+/**
+ * @brief Saves a batch of objects to the filesystem
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] next Iterator handing out the objects to save
+ * @param[in] context Context passed to the iterator
+ * @return 0 if success or error code as for PIOS_FLASHFS_ObjSave
+ */
+int32_t PIOS_FLASHFS_ObjSaveBatch(
+    uintptr_t fs_id,
+    PIOS_FLASHFS_ObjIterator next,
+    void *context)
+{
+    // every object is saved as usual
+    struct PIOS_FLASHFS_Obj obj;
+
+    while (next(context, &obj)) {
+        int32_t rc = PIOS_FLASHFS_ObjSave(fs_id, obj.obj_id, obj.obj_inst_id, obj.obj_data, obj.obj_size);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
 /**
  * @brief Load one object instance from the filesystem
  * @param[in] fs_id The filesystem to use for this action
@@ -294,6 +318,20 @@ int32_t PIOS_FLASHFS_GetStats(
     return 0;
 }
 
+/**
+ * @brief Runs a bounded step of garbage collection on the filesystem
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] max_slots Maximum number of slots to migrate in this call
+ * @return 0 if no garbage collection is pending
+ */
+int32_t PIOS_FLASHFS_CollectGarbage(
+    __attribute__((unused)) uintptr_t fs_id,
+    __attribute__((unused)) uint16_t max_slots)
+{
+    // yaffs collects its garbage on its own
+    return 0;
+}
+
 
 /**
  * @}
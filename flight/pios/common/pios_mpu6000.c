@@ -45,6 +45,7 @@ enum pios_mpu6000_dev_magic {
 // sensor driver interface
 bool PIOS_MPU6000_driver_Test(uintptr_t context);
 void PIOS_MPU6000_driver_Reset(uintptr_t context);
+void PIOS_MPU6000_driver_ResetFifo(uintptr_t context);
 void PIOS_MPU6000_driver_get_scale(float *scales, uint8_t size, uintptr_t context);
 QueueHandle_t PIOS_MPU6000_driver_get_queue(uintptr_t context);
 
@@ -57,6 +58,18 @@ const PIOS_SENSORS_Driver PIOS_MPU6000_Driver = {
     .get_scale = PIOS_MPU6000_driver_get_scale,
     .is_polled = false,
 };
+
+// used instead of PIOS_MPU6000_Driver when the cfg enables fifo_batch
+static const PIOS_SENSORS_Driver PIOS_MPU6000_FifoDriver = {
+    .test       = PIOS_MPU6000_driver_Test,
+    .poll       = NULL,
+    .fetch      = NULL,
+    .reset      = PIOS_MPU6000_driver_ResetFifo,
+    .get_queue  = PIOS_MPU6000_driver_get_queue,
+    .get_scale  = PIOS_MPU6000_driver_get_scale,
+    .is_polled  = false,
+    .is_batched = true,
+};
 //
 
 
@@ -68,40 +81,58 @@ struct mpu6000_dev {
     enum pios_mpu6000_range gyro_range;
     enum pios_mpu6000_accel_range accel_range;
     enum pios_mpu6000_filter filter;
+    uint16_t sample_period; // in microseconds
+    uint8_t  fifo_batch; // samples per FIFO read, at most cfg->fifo_batch
     enum pios_mpu6000_dev_magic   magic;
 };
 
 #define PIOS_MPU6000_SAMPLES_BYTES    14
 #define PIOS_MPU6000_SENSOR_FIRST_REG PIOS_MPU6000_ACCEL_X_OUT_MSB
 
+// Layout of the sensor registers, the FIFO stores the samples in the same order
+typedef struct {
+    uint8_t Accel_X_h;
+    uint8_t Accel_X_l;
+    uint8_t Accel_Y_h;
+    uint8_t Accel_Y_l;
+    uint8_t Accel_Z_h;
+    uint8_t Accel_Z_l;
+    uint8_t Temperature_h;
+    uint8_t Temperature_l;
+    uint8_t Gyro_X_h;
+    uint8_t Gyro_X_l;
+    uint8_t Gyro_Y_h;
+    uint8_t Gyro_Y_l;
+    uint8_t Gyro_Z_h;
+    uint8_t Gyro_Z_l;
+} mpu6000_sample_t;
+
 typedef union {
     uint8_t buffer[1 + PIOS_MPU6000_SAMPLES_BYTES];
     struct {
         uint8_t dummy;
-        uint8_t Accel_X_h;
-        uint8_t Accel_X_l;
-        uint8_t Accel_Y_h;
-        uint8_t Accel_Y_l;
-        uint8_t Accel_Z_h;
-        uint8_t Accel_Z_l;
-        uint8_t Temperature_h;
-        uint8_t Temperature_l;
-        uint8_t Gyro_X_h;
-        uint8_t Gyro_X_l;
-        uint8_t Gyro_Y_h;
-        uint8_t Gyro_Y_l;
-        uint8_t Gyro_Z_h;
-        uint8_t Gyro_Z_l;
+        mpu6000_sample_t sample;
     } data;
 } mpu6000_data_t;
 
-#define GET_SENSOR_DATA(mpudataptr, sensor) (mpudataptr.data.sensor##_h << 8 | mpudataptr.data.sensor##_l)
+#define GET_SENSOR_DATA(sampleptr, sensor) ((sampleptr)->sensor##_h << 8 | (sampleptr)->sensor##_l)
+
+#define FIFO_STORE_ALL \
+    (PIOS_MPU6000_ACCEL_OUT | PIOS_MPU6000_FIFO_TEMP_OUT | \
+     PIOS_MPU6000_FIFO_GYRO_X_OUT | PIOS_MPU6000_FIFO_GYRO_Y_OUT | PIOS_MPU6000_FIFO_GYRO_Z_OUT)
+// room for reads that lag behind
+#define FIFO_MAX_SAMPLES(cfg) MIN(2 * (cfg)->fifo_batch, PIOS_SENSORS_MAX_BATCH_SAMPLES)
+#define BATCH_DATA_SIZE(cfg) \
+    (sizeof(PIOS_SENSORS_3Axis_SensorsBatch) + sizeof(Vector3i16) * SENSOR_COUNT * FIFO_MAX_SAMPLES(cfg))
 
 // ! Global structure for this device device
 static struct mpu6000_dev *dev;
 volatile bool mpu6000_configured = false;
 static mpu6000_data_t mpu6000_data;
 static PIOS_SENSORS_3Axis_SensorsWithTemp *queue_data = 0;
+static PIOS_SENSORS_3Axis_SensorsBatch *batch_data    = 0;
+static mpu6000_sample_t *fifo_data = 0;
+static uint8_t fifo_pending = 0;
 #define SENSOR_COUNT     2
 #define SENSOR_DATA_SIZE (sizeof(PIOS_SENSORS_3Axis_SensorsWithTemp) + sizeof(Vector3i16) * SENSOR_COUNT)
 // ! Private functions
@@ -113,12 +144,19 @@ static int32_t PIOS_MPU6000_GetReg(uint8_t address);
 static void PIOS_MPU6000_SetSpeed(const bool fast);
 static bool PIOS_MPU6000_HandleData();
 static bool PIOS_MPU6000_ReadSensor(bool *woken);
+static bool PIOS_MPU6000_HandleFifo(uint8_t samples, uint32_t timestamp);
+static int32_t PIOS_MPU6000_ReadFifo(bool *woken);
+static void PIOS_MPU6000_RotateSample(const mpu6000_sample_t *data, Vector3i16 *accel, Vector3i16 *gyro);
 
 static int32_t PIOS_MPU6000_Test(void);
 
 void PIOS_MPU6000_Register()
 {
-    PIOS_SENSORS_Register(&PIOS_MPU6000_Driver, PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL, 0);
+    if (dev && dev->cfg->fifo_batch) {
+        PIOS_SENSORS_Register(&PIOS_MPU6000_FifoDriver, PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL, 0);
+    } else {
+        PIOS_SENSORS_Register(&PIOS_MPU6000_Driver, PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL, 0);
+    }
 }
 /**
  * @brief Allocate a new device
@@ -131,6 +169,21 @@ static struct mpu6000_dev *PIOS_MPU6000_alloc(const struct pios_mpu6000_cfg *cfg
     PIOS_Assert(mpu6000_dev);
 
     mpu6000_dev->magic = PIOS_MPU6000_DEV_MAGIC;
+    mpu6000_dev->fifo_batch = cfg->fifo_batch;
+
+    if (cfg->fifo_batch) {
+        // one block being processed and one being read
+        mpu6000_dev->queue = xQueueCreate(2, BATCH_DATA_SIZE(cfg));
+        PIOS_Assert(mpu6000_dev->queue);
+
+        batch_data = (PIOS_SENSORS_3Axis_SensorsBatch *)pios_malloc(BATCH_DATA_SIZE(cfg));
+        PIOS_Assert(batch_data);
+        batch_data->count = SENSOR_COUNT;
+
+        fifo_data = (mpu6000_sample_t *)pios_malloc(sizeof(mpu6000_sample_t) * FIFO_MAX_SAMPLES(cfg));
+        PIOS_Assert(fifo_data);
+        return mpu6000_dev;
+    }
 
     mpu6000_dev->queue = xQueueCreate(cfg->max_downsample + 1, SENSOR_DATA_SIZE);
     PIOS_Assert(mpu6000_dev->queue);
@@ -230,12 +283,13 @@ static void PIOS_MPU6000_Config(struct pios_mpu6000_cfg const *cfg)
     }
 
     // FIFO storage
-    while (PIOS_MPU6000_SetReg(PIOS_MPU6000_FIFO_EN_REG, cfg->Fifo_store) != 0) {
+    while (PIOS_MPU6000_SetReg(PIOS_MPU6000_FIFO_EN_REG, cfg->fifo_batch ? FIFO_STORE_ALL : cfg->Fifo_store) != 0) {
         ;
     }
     PIOS_MPU6000_ConfigureRanges(cfg->gyro_range, cfg->accel_range, cfg->filter);
     // Interrupt configuration
-    while (PIOS_MPU6000_SetReg(PIOS_MPU6000_USER_CTRL_REG, cfg->User_ctl) != 0) {
+    while (PIOS_MPU6000_SetReg(PIOS_MPU6000_USER_CTRL_REG,
+                               cfg->fifo_batch ? (cfg->User_ctl | PIOS_MPU6000_USERCTL_FIFO_EN) : cfg->User_ctl) != 0) {
         ;
     }
 
@@ -278,13 +332,24 @@ int32_t PIOS_MPU6000_ConfigureRanges(
     }
 
     // Sample rate divider, chosen upon digital filtering settings
-    while (PIOS_MPU6000_SetReg(PIOS_MPU6000_SMPLRT_DIV_REG,
-                               filterSetting == PIOS_MPU6000_LOWPASS_256_HZ ?
-                               dev->cfg->Smpl_rate_div_no_dlp : dev->cfg->Smpl_rate_div_dlp) != 0) {
+    const bool no_dlp = (filterSetting == PIOS_MPU6000_LOWPASS_256_HZ);
+    const uint8_t divider = no_dlp ? dev->cfg->Smpl_rate_div_no_dlp : dev->cfg->Smpl_rate_div_dlp;
+    while (PIOS_MPU6000_SetReg(PIOS_MPU6000_SMPLRT_DIV_REG, divider) != 0) {
         ;
     }
 
     dev->filter = filterSetting;
+    // gyro output rate is 8kHz without dlp and 1kHz with it
+    dev->sample_period = (no_dlp ? 125 : 1000) * (1 + divider);
+
+    if (dev->cfg->fifo_batch) {
+#ifdef PIOS_SENSOR_RATE
+        // read one block per sensor task cycle, whatever rate the filter setting gives
+        const uint32_t batch = (uint32_t)(1e6f / PIOS_SENSOR_RATE) / dev->sample_period;
+        dev->fifo_batch = MAX(1u, MIN(batch, dev->cfg->fifo_batch));
+#endif
+        fifo_pending    = 0;
+    }
 
     // Gyro range
     while (PIOS_MPU6000_SetReg(PIOS_MPU6000_GYRO_CFG_REG, gyroRange) != 0) {
@@ -546,6 +611,22 @@ bool PIOS_MPU6000_IRQHandler(void)
         return false;
     }
 
+    if (dev->cfg->fifo_batch) {
+        // The MPU6000 has no FIFO watermark interrupt, data ready only counts the
+        // samples and the FIFO is read once a whole block is waiting.
+        if (++fifo_pending < dev->fifo_batch) {
+            return false;
+        }
+        fifo_pending = 0;
+
+        int32_t samples = PIOS_MPU6000_ReadFifo(&woken);
+        if (samples > 0) {
+            bool woken2 = PIOS_MPU6000_HandleFifo(samples, PIOS_DELAY_GetuS());
+            woken |= woken2;
+        }
+        return woken;
+    }
+
     bool read_ok = false;
     read_ok = PIOS_MPU6000_ReadSensor(&woken);
 
@@ -557,12 +638,8 @@ bool PIOS_MPU6000_IRQHandler(void)
     return woken;
 }
 
-static bool PIOS_MPU6000_HandleData()
+static void PIOS_MPU6000_RotateSample(const mpu6000_sample_t *data, Vector3i16 *accel, Vector3i16 *gyro)
 {
-    if (!queue_data) {
-        return false;
-    }
-
     // Rotate the sensor to OP convention.  The datasheet defines X as towards the right
     // and Y as forward.  OP convention transposes this.  Also the Z is defined negatively
     // to our convention
@@ -570,41 +647,115 @@ static bool PIOS_MPU6000_HandleData()
     // Currently we only support rotations on top so switch X/Y accordingly
     switch (dev->cfg->orientation) {
     case PIOS_MPU6000_TOP_0DEG:
-        queue_data->sample[0].y = GET_SENSOR_DATA(mpu6000_data, Accel_X); // chip X
-        queue_data->sample[0].x = GET_SENSOR_DATA(mpu6000_data, Accel_Y); // chip Y
-        queue_data->sample[1].y = GET_SENSOR_DATA(mpu6000_data, Gyro_X); // chip X
-        queue_data->sample[1].x = GET_SENSOR_DATA(mpu6000_data, Gyro_Y); // chip Y
+        accel->y = GET_SENSOR_DATA(data, Accel_X); // chip X
+        accel->x = GET_SENSOR_DATA(data, Accel_Y); // chip Y
+        gyro->y  = GET_SENSOR_DATA(data, Gyro_X); // chip X
+        gyro->x  = GET_SENSOR_DATA(data, Gyro_Y); // chip Y
         break;
     case PIOS_MPU6000_TOP_90DEG:
         // -1 to bring it back to -32768 +32767 range
-        queue_data->sample[0].y = -1 - (GET_SENSOR_DATA(mpu6000_data, Accel_Y)); // chip Y
-        queue_data->sample[0].x = GET_SENSOR_DATA(mpu6000_data, Accel_X); // chip X
-        queue_data->sample[1].y = -1 - (GET_SENSOR_DATA(mpu6000_data, Gyro_Y)); // chip Y
-        queue_data->sample[1].x = GET_SENSOR_DATA(mpu6000_data, Gyro_X); // chip X
+        accel->y = -1 - (GET_SENSOR_DATA(data, Accel_Y)); // chip Y
+        accel->x = GET_SENSOR_DATA(data, Accel_X); // chip X
+        gyro->y  = -1 - (GET_SENSOR_DATA(data, Gyro_Y)); // chip Y
+        gyro->x  = GET_SENSOR_DATA(data, Gyro_X); // chip X
         break;
     case PIOS_MPU6000_TOP_180DEG:
-        queue_data->sample[0].y = -1 - (GET_SENSOR_DATA(mpu6000_data, Accel_X)); // chip X
-        queue_data->sample[0].x = -1 - (GET_SENSOR_DATA(mpu6000_data, Accel_Y)); // chip Y
-        queue_data->sample[1].y = -1 - (GET_SENSOR_DATA(mpu6000_data, Gyro_X)); // chip X
-        queue_data->sample[1].x = -1 - (GET_SENSOR_DATA(mpu6000_data, Gyro_Y)); // chip Y
+        accel->y = -1 - (GET_SENSOR_DATA(data, Accel_X)); // chip X
+        accel->x = -1 - (GET_SENSOR_DATA(data, Accel_Y)); // chip Y
+        gyro->y  = -1 - (GET_SENSOR_DATA(data, Gyro_X)); // chip X
+        gyro->x  = -1 - (GET_SENSOR_DATA(data, Gyro_Y)); // chip Y
         break;
     case PIOS_MPU6000_TOP_270DEG:
-        queue_data->sample[0].y = GET_SENSOR_DATA(mpu6000_data, Accel_Y); // chip Y
-        queue_data->sample[0].x = -1 - (GET_SENSOR_DATA(mpu6000_data, Accel_X)); // chip X
-        queue_data->sample[1].y = GET_SENSOR_DATA(mpu6000_data, Gyro_Y); // chip Y
-        queue_data->sample[1].x = -1 - (GET_SENSOR_DATA(mpu6000_data, Gyro_X)); // chip X
+        accel->y = GET_SENSOR_DATA(data, Accel_Y); // chip Y
+        accel->x = -1 - (GET_SENSOR_DATA(data, Accel_X)); // chip X
+        gyro->y  = GET_SENSOR_DATA(data, Gyro_Y); // chip Y
+        gyro->x  = -1 - (GET_SENSOR_DATA(data, Gyro_X)); // chip X
         break;
     }
-    queue_data->sample[0].z = -1 - (GET_SENSOR_DATA(mpu6000_data, Accel_Z));
-    queue_data->sample[1].z = -1 - (GET_SENSOR_DATA(mpu6000_data, Gyro_Z));
-    const int16_t temp = GET_SENSOR_DATA(mpu6000_data, Temperature);
-    queue_data->temperature = 3500 + ((float)(temp + 512)) * (1.0f / 3.4f);
+    accel->z = -1 - (GET_SENSOR_DATA(data, Accel_Z));
+    gyro->z  = -1 - (GET_SENSOR_DATA(data, Gyro_Z));
+}
+
+static int16_t PIOS_MPU6000_ConvertTemperature(const mpu6000_sample_t *data)
+{
+    const int16_t temp = GET_SENSOR_DATA(data, Temperature);
+
+    return 3500 + ((float)(temp + 512)) * (1.0f / 3.4f);
+}
+
+static bool PIOS_MPU6000_HandleData()
+{
+    if (!queue_data) {
+        return false;
+    }
+
+    PIOS_MPU6000_RotateSample(&mpu6000_data.data.sample, &queue_data->sample[0], &queue_data->sample[1]);
+    queue_data->temperature = PIOS_MPU6000_ConvertTemperature(&mpu6000_data.data.sample);
 
     BaseType_t higherPriorityTaskWoken;
     xQueueSendToBackFromISR(dev->queue, (void *)queue_data, &higherPriorityTaskWoken);
     return higherPriorityTaskWoken == pdTRUE;
 }
 
+static bool PIOS_MPU6000_HandleFifo(uint8_t samples, uint32_t timestamp)
+{
+    if (!batch_data) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < samples; i++) {
+        PIOS_MPU6000_RotateSample(&fifo_data[i], &batch_data->sample[2 * i], &batch_data->sample[2 * i + 1]);
+    }
+    batch_data->temperature = PIOS_MPU6000_ConvertTemperature(&fifo_data[samples - 1]);
+    batch_data->samples     = samples;
+    batch_data->period      = dev->sample_period;
+    batch_data->timestamp   = timestamp;
+
+    BaseType_t higherPriorityTaskWoken;
+    xQueueSendToBackFromISR(dev->queue, (void *)batch_data, &higherPriorityTaskWoken);
+    return higherPriorityTaskWoken == pdTRUE;
+}
+
+/**
+ * @brief Read all the complete samples waiting in the FIFO, up to FIFO_MAX_SAMPLES
+ * @return number of samples read into fifo_data, 0 if none or the FIFO had to be reset,
+ *         negative if the bus could not be claimed
+ * @param woken[in,out] If non-NULL, will be set to true if woken was false and a higher priority
+ *                      task has is now eligible to run, else unchanged
+ */
+static int32_t PIOS_MPU6000_ReadFifo(bool *woken)
+{
+    if (PIOS_MPU6000_ClaimBusISR(woken, true) != 0) {
+        return -1;
+    }
+
+    PIOS_SPI_TransferByte(dev->spi_id, PIOS_MPU6000_FIFO_CNT_MSB | 0x80);
+    uint16_t bytes = PIOS_SPI_TransferByte(dev->spi_id, 0) << 8;
+    bytes |= PIOS_SPI_TransferByte(dev->spi_id, 0);
+
+    // end the transaction, the next one starts at another register
+    PIOS_SPI_RC_PinSet(dev->spi_id, dev->slave_num, 1);
+    PIOS_SPI_RC_PinSet(dev->spi_id, dev->slave_num, 0);
+
+    if (bytes >= PIOS_MPU6000_FIFO_SIZE || (bytes % PIOS_MPU6000_SAMPLES_BYTES) != 0) {
+        // overflowed or out of sync, samples cannot be told apart anymore. Start over.
+        PIOS_SPI_TransferByte(dev->spi_id, PIOS_MPU6000_USER_CTRL_REG);
+        PIOS_SPI_TransferByte(dev->spi_id, dev->cfg->User_ctl | PIOS_MPU6000_USERCTL_FIFO_EN | PIOS_MPU6000_USERCTL_FIFO_RST);
+        PIOS_MPU6000_ReleaseBusISR(woken);
+        return 0;
+    }
+
+    uint8_t samples = MIN(bytes / PIOS_MPU6000_SAMPLES_BYTES, FIFO_MAX_SAMPLES(dev->cfg));
+    if (samples) {
+        PIOS_SPI_TransferByte(dev->spi_id, PIOS_MPU6000_FIFO_REG | 0x80);
+        if (PIOS_SPI_TransferBlock(dev->spi_id, NULL, (uint8_t *)fifo_data, samples * PIOS_MPU6000_SAMPLES_BYTES, NULL) < 0) {
+            samples = 0;
+        }
+    }
+    PIOS_MPU6000_ReleaseBusISR(woken);
+    return samples;
+}
+
 static bool PIOS_MPU6000_ReadSensor(bool *woken)
 {
     const uint8_t mpu6000_send_buf[1 + PIOS_MPU6000_SAMPLES_BYTES] = { PIOS_MPU6000_SENSOR_FIRST_REG | 0x80 };
@@ -631,6 +782,16 @@ void PIOS_MPU6000_driver_Reset(__attribute__((unused)) uintptr_t context)
     PIOS_MPU6000_DummyReadGyros();
 }
 
+void PIOS_MPU6000_driver_ResetFifo(__attribute__((unused)) uintptr_t context)
+{
+    if (PIOS_MPU6000_Validate(dev) != 0) {
+        return;
+    }
+    fifo_pending = 0;
+    PIOS_MPU6000_SetReg(PIOS_MPU6000_USER_CTRL_REG,
+                        dev->cfg->User_ctl | PIOS_MPU6000_USERCTL_FIFO_EN | PIOS_MPU6000_USERCTL_FIFO_RST);
+}
+
 void PIOS_MPU6000_driver_get_scale(float *scales, uint8_t size, __attribute__((unused)) uintptr_t contet)
 {
     PIOS_Assert(size >= 2);
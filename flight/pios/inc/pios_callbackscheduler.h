@@ -186,6 +186,11 @@ int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo);
  */
 int32_t PIOS_CALLBACKSCHEDULER_DispatchFromISR(DelayedCallbackInfo *cbinfo, long *pxHigherPriorityTaskWoken);
 
+/**
+ * Number of dispatch latency histogram buckets: below 100us, below 1ms, below 10ms and above
+ */
+#define PIOS_CALLBACKSCHEDULER_LATENCY_BUCKETS 4
+
 /**
  * Information about a running callback that has been registered
  * via a call to PIOS_CALLBACKSCHEDULER_Create().
@@ -197,6 +202,8 @@ struct pios_callback_info {
     bool     is_running;
     /** Count of executions of the callback since system start */
     uint32_t running_time_count;
+    /** Histogram of the delay between a callback becoming ready and it being run */
+    uint32_t dispatch_latency[PIOS_CALLBACKSCHEDULER_LATENCY_BUCKETS];
 };
 
 /**
@@ -28,18 +28,32 @@
 #define PIOS_FLASHFS_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 struct PIOS_FLASHFS_Stats {
     uint16_t num_free_slots; /* slots in free state */
     uint16_t num_active_slots; /* slots in active state */
 };
 
+struct PIOS_FLASHFS_Obj {
+    uint32_t obj_id;
+    uint16_t obj_inst_id;
+    uint16_t obj_size;
+    uint8_t  *obj_data;
+    bool     changed; /* known to differ from the saved version, no need to compare */
+};
+
+/* Hands out the next object of a batch, returns false once there are no more objects */
+typedef bool (*PIOS_FLASHFS_ObjIterator)(void *context, struct PIOS_FLASHFS_Obj *obj);
+
 // define logfs subdirectory of a yaffs flash device
 #define PIOS_LOGFS_DIR "logfs"
 
 int32_t PIOS_FLASHFS_Format(uintptr_t fs_id);
 int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size);
+int32_t PIOS_FLASHFS_ObjSaveBatch(uintptr_t fs_id, PIOS_FLASHFS_ObjIterator next, void *context);
 int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size);
 int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id);
 int32_t PIOS_FLASHFS_GetStats(uintptr_t fs_id, struct PIOS_FLASHFS_Stats *stats);
+int32_t PIOS_FLASHFS_CollectGarbage(uintptr_t fs_id, uint16_t max_slots);
 #endif /* PIOS_FLASHFS_H */
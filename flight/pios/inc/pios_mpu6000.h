@@ -70,6 +70,8 @@
 #define PIOS_MPU6000_FIFO_GYRO_Z_OUT          0x10
 #define PIOS_MPU6000_ACCEL_OUT                0x08
 
+#define PIOS_MPU6000_FIFO_SIZE                1024
+
 /* Interrupt Configuration */
 #define PIOS_MPU6000_INT_ACTL                 0x80
 #define PIOS_MPU6000_INT_OPEN                 0x40
@@ -151,6 +153,11 @@ struct pios_mpu6000_cfg {
     SPIPrescalerTypeDef fast_prescaler;
     SPIPrescalerTypeDef std_prescaler;
     uint8_t max_downsample;
+    /* If non zero the FIFO stores accel, temperature and gyro and it is read in blocks
+     * instead of reading every sample on data ready. A block holds the samples of one
+     * PIOS_SENSOR_RATE period, at most fifo_batch of them.
+     * Fifo_store and the FIFO enable bit of User_ctl are then set by the driver */
+    uint8_t fifo_batch;
 };
 
 /* Public Functions */
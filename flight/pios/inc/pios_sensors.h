@@ -51,6 +51,7 @@ typedef struct PIOS_SENSORS_Driver {
     PIOS_SENSORS_get_queue_function get_queue; // get the queue reference
     PIOS_SENSORS_get_scale_function get_scale; // return scales for the sensors
     bool is_polled;
+    bool is_batched; // queue items are PIOS_SENSORS_3Axis_SensorsBatch
 } PIOS_SENSORS_Driver;
 
 typedef enum PIOS_SENSORS_TYPE {
@@ -80,6 +81,23 @@ typedef struct PIOS_SENSORS_3Axis_SensorsWithTemp {
     Vector3i16 sample[];
 } PIOS_SENSORS_3Axis_SensorsWithTemp;
 
+/**
+ * A block of 3d samples read at once from a sensor FIFO.
+ * sample[] holds samples * count entries, oldest sample first and
+ * the sensor instances of each sample next to each other.
+ */
+typedef struct PIOS_SENSORS_3Axis_SensorsBatch {
+    uint32_t   timestamp; // PIOS_DELAY_GetuS() when the newest sample was read
+    uint16_t   period; // sample period in microseconds
+    uint8_t    count; // number of sensor instances
+    uint8_t    samples; // number of samples in the block
+    int16_t    temperature; // Degrees Celsius * 100, newest sample
+    Vector3i16 sample[];
+} PIOS_SENSORS_3Axis_SensorsBatch;
+
+// upper bound for PIOS_SENSORS_3Axis_SensorsBatch.samples
+#define PIOS_SENSORS_MAX_BATCH_SAMPLES 32
+
 typedef struct PIOS_SENSORS_1Axis_SensorsWithTemp {
     float temperature; // Degrees Celsius
     float sample; // sample
@@ -41,6 +41,25 @@
  */
 #include <time.h>
 
+/*
+ * In lockstep simulation the clock follows the simulated time of the
+ * scheduler. Waits from a task block for the ticks covering the delay so
+ * the simulated time moves on as it would on the board, before the
+ * scheduler runs they return at once.
+ */
+#if defined(PIOS_INCLUDE_FREERTOS)
+#define LOCKSTEP() (xPortIsLockstep() == pdTRUE)
+static void lockstepWaituS(uint32_t uS)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        vTaskDelay((uS + portTICK_RATE_MICROSECONDS - 1) / portTICK_RATE_MICROSECONDS);
+    }
+}
+#else
+#define LOCKSTEP() false
+#define lockstepWaituS(uS)
+#endif
+
 int32_t PIOS_DELAY_Init(void)
 {
     // stub
@@ -63,6 +82,11 @@ int32_t PIOS_DELAY_WaituS(uint32_t uS)
 {
     static struct timespec wait, rest;
 
+    if (LOCKSTEP()) {
+        lockstepWaituS(uS);
+        return 0;
+    }
+
     wait.tv_sec  = 0;
     wait.tv_nsec = 1000 * uS;
     while (nanosleep(&wait, &rest) != 0) {
@@ -90,6 +114,11 @@ int32_t PIOS_DELAY_WaitmS(uint32_t mS)
     // PIOS_DELAY_WaituS(1000);
     static struct timespec wait, rest;
 
+    if (LOCKSTEP()) {
+        lockstepWaituS(mS * 1000);
+        return 0;
+    }
+
     wait.tv_sec  = mS / 1000;
     wait.tv_nsec = (mS % 1000) * 1000000;
     while (nanosleep(&wait, &rest) != 0) {
@@ -109,6 +138,11 @@ uint32_t PIOS_DELAY_GetuS()
 {
     static struct timespec current;
 
+#if defined(PIOS_INCLUDE_FREERTOS)
+    if (LOCKSTEP()) {
+        return (uint32_t)ullPortGetSimulatedTimeUS();
+    }
+#endif
     clock_gettime(CLOCK_REALTIME, &current);
     return (current.tv_sec * 1000000) + (current.tv_nsec / 1000);
 }
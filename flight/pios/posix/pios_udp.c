@@ -87,11 +87,19 @@ void *PIOS_UDP_RxThread(void *udp_dev_n)
          * receive
          */
         int received;
+        int flags = 0;
+#if defined(PIOS_INCLUDE_FREERTOS)
+        /* in a lockstep simulation a task blocked in the host would stall the
+         * simulated time, poll the socket once per tick instead */
+        if (xPortIsLockstep() == pdTRUE) {
+            flags = MSG_DONTWAIT;
+        }
+#endif
         udp_dev->clientLength = sizeof(udp_dev->client);
         if ((received = recvfrom(udp_dev->socket,
                                  &udp_dev->rx_buffer,
                                  PIOS_UDP_RX_BUFFER_SIZE,
-                                 0,
+                                 flags,
                                  (struct sockaddr *)&udp_dev->client,
                                  (socklen_t *)&udp_dev->clientLength)) >= 0) {
             /* copy received data to buffer if possible */
@@ -108,6 +116,11 @@ void *PIOS_UDP_RxThread(void *udp_dev_n)
             }
 #endif /* PIOS_INCLUDE_FREERTOS */
         }
+#if defined(PIOS_INCLUDE_FREERTOS)
+        else if (flags == MSG_DONTWAIT) {
+            vTaskDelay(1);
+        }
+#endif
     }
 }
 
@@ -207,6 +207,8 @@ static const struct pios_mpu6000_cfg pios_mpu6000_cfg = {
     .fast_prescaler = PIOS_SPI_PRESCALER_4,
     .std_prescaler  = PIOS_SPI_PRESCALER_64,
     .max_downsample = 20,
+    // read the samples in one block per sensor task cycle, 16 of them at 8kHz
+    .fifo_batch     = 16,
 };
 #endif /* PIOS_INCLUDE_MPU6000 */
 
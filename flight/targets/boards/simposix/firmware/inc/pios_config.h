@@ -39,6 +39,9 @@
 #define PIOS_INCLUDE_CALLBACKSCHEDULER
 #define PIOS_INCLUDE_BL_HELPER
 
+#define PIOS_INCLUDE_INSTRUMENTATION
+#define PIOS_INSTRUMENTATION_MAX_COUNTERS 10
+
 /* Enable/Disable PiOS Modules */
 // #define PIOS_INCLUDE_ADC
 #define PIOS_INCLUDE_DELAY
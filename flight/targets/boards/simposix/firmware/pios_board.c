@@ -34,6 +34,10 @@
 #include <manualcontrolsettings.h>
 #include <taskinfo.h>
 
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+#include <pios_instrumentation.h>
+#endif
+
 
 /*
  * Pull in the board-specific static HW definitions.
@@ -138,6 +142,10 @@ void PIOS_Board_Init(void)
     /* Initialize the delayed callback library */
     PIOS_CALLBACKSCHEDULER_Initialize();
 
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+    PIOS_Instrumentation_Init(PIOS_INSTRUMENTATION_MAX_COUNTERS);
+#endif
+
     /* Initialize UAVObject libraries */
     EventDispatcherInitialize();
     UAVObjInitialize();
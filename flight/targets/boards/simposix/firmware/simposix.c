@@ -34,6 +34,14 @@
 #include "inc/openpilot.h"
 #include <systemmod.h>
 #include <uavobjectsinit.h>
+#include <unistd.h>
+#include <attitudestate.h>
+#include <positionstate.h>
+#include <velocitystate.h>
+#include <gyrosensor.h>
+#include <accelsensor.h>
+#include <barosensor.h>
+#include <attitudesimulated.h>
 
 /* Task Priorities */
 #define PRIORITY_TASK_HOOKS (tskIDLE_PRIORITY + 3)
@@ -71,6 +79,8 @@ static xTaskHandle initTaskHandle;
 
 /* Function Prototypes */
 static void initTask(void *parameters);
+static void usage(const char *name);
+static void lockstepEnd(void);
 
 /* Prototype of generated InitModules() function */
 extern void InitModules(void);
@@ -83,10 +93,38 @@ extern void InitModules(void);
  * Start FreeRTOS Scheduler (vTaskStartScheduler)<BR>
  * If something goes wrong, blink LED1 and LED2 every 100ms
  *
+ * Options:
+ *   -l          run in lockstep, simulated time advances as fast as the host allows
+ *   -t seconds  end a lockstep run after that much simulated time
+ *   -s seed     seed of the simulated sensor noise
  */
-int main()
+int main(int argc, char *argv[])
 {
     int result;
+    int opt;
+    bool lockstep = false;
+    uint32_t runSeconds = 0;
+
+    while ((opt = getopt(argc, argv, "lt:s:")) != -1) {
+        switch (opt) {
+        case 'l':
+            lockstep = true;
+            break;
+        case 't':
+            runSeconds = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            srand(strtoul(optarg, NULL, 10));
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (lockstep) {
+        vPortEnableLockstep(runSeconds * configTICK_RATE_HZ, lockstepEnd);
+    }
 
     /* NOTE: Do NOT modify the following start-up sequence */
     /* Any new initialization functions should be added in OpenPilotInit() */
@@ -115,6 +153,49 @@ int main()
 
     return 0;
 }
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-l] [-t seconds] [-s seed]\n", name);
+    fprintf(stderr, "  -l          lockstep simulation, run faster than real time\n");
+    fprintf(stderr, "  -t seconds  end the lockstep simulation after this much simulated time\n");
+    fprintf(stderr, "  -s seed     seed of the simulated sensor noise\n");
+}
+
+/**
+ * Called from the idle task at the end of a lockstep run, prints the final
+ * simulated state so two runs with the same seed can be compared.
+ */
+static void lockstepEnd(void)
+{
+    AttitudeStateData attitude;
+    PositionStateData position;
+    VelocityStateData velocity;
+    GyroSensorData gyro;
+    AccelSensorData accel;
+    BaroSensorData baro;
+    AttitudeSimulatedData simulated;
+
+    AttitudeStateGet(&attitude);
+    PositionStateGet(&position);
+    VelocityStateGet(&velocity);
+    GyroSensorGet(&gyro);
+    AccelSensorGet(&accel);
+    BaroSensorGet(&baro);
+    AttitudeSimulatedGet(&simulated);
+
+    printf("AttitudeState q %.9g %.9g %.9g %.9g\n", (double)attitude.q1, (double)attitude.q2, (double)attitude.q3, (double)attitude.q4);
+    printf("PositionState %.9g %.9g %.9g\n", (double)position.North, (double)position.East, (double)position.Down);
+    printf("VelocityState %.9g %.9g %.9g\n", (double)velocity.North, (double)velocity.East, (double)velocity.Down);
+    printf("GyroSensor %.9g %.9g %.9g\n", (double)gyro.x, (double)gyro.y, (double)gyro.z);
+    printf("AccelSensor %.9g %.9g %.9g\n", (double)accel.x, (double)accel.y, (double)accel.z);
+    printf("BaroSensor %.9g\n", (double)baro.Altitude);
+    printf("AttitudeSimulated position %.9g %.9g %.9g velocity %.9g %.9g %.9g\n",
+           (double)simulated.Position.North, (double)simulated.Position.East, (double)simulated.Position.Down,
+           (double)simulated.Velocity.North, (double)simulated.Velocity.East, (double)simulated.Velocity.Down);
+    fflush(stdout);
+}
+
 /**
  * Initialisation task.
  *
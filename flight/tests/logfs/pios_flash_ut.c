@@ -15,6 +15,7 @@ struct flash_ut_dev {
     const struct pios_flash_ut_cfg *cfg;
     bool transaction_in_progress;
     FILE *flash_file;
+    uint32_t num_reads;
 };
 
 static struct flash_ut_dev *PIOS_Flash_UT_Alloc(void)
@@ -40,6 +41,7 @@ int32_t PIOS_Flash_UT_Init(uintptr_t *flash_id, const struct pios_flash_ut_cfg *
 
     flash_dev->cfg = cfg;
     flash_dev->transaction_in_progress = false;
+    flash_dev->num_reads = 0;
 
     flash_dev->flash_file = fopen(FLASH_IMAGE_FILE, "rb+");
     if (flash_dev->flash_file == NULL) {
@@ -156,6 +158,8 @@ static int32_t PIOS_Flash_UT_ReadData(uintptr_t flash_id, uint32_t addr, uint8_t
 
     assert(flash_dev->transaction_in_progress);
 
+    flash_dev->num_reads++;
+
     if (fseek(flash_dev->flash_file, addr, SEEK_SET) != 0) {
         assert(0);
     }
@@ -168,6 +172,13 @@ static int32_t PIOS_Flash_UT_ReadData(uintptr_t flash_id, uint32_t addr, uint8_t
     return 0;
 }
 
+uint32_t PIOS_Flash_UT_GetNumReads(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->num_reads;
+}
+
 /* Provide a flash driver to external drivers */
 const struct pios_flash_driver pios_ut_flash_driver = {
     .start_transaction = PIOS_Flash_UT_StartTransaction,
@@ -297,6 +297,313 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
     EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
 
+TEST_F(LogfsTestCooked, LoadReadsOnlyMatchingSlots) {
+    for (uint16_t i = 0; i < 100; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+    }
+
+    /* Slot header and data, plus at most one other slot sharing the index key */
+    uint32_t reads = PIOS_Flash_UT_GetNumReads(flash_id);
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 99, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+    EXPECT_GE(3u, PIOS_Flash_UT_GetNumReads(flash_id) - reads);
+
+    /* Nonexistent objects are not looked up in flash at all */
+    reads = PIOS_Flash_UT_GetNumReads(flash_id);
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_GE(1u, PIOS_Flash_UT_GetNumReads(flash_id) - reads);
+}
+
+TEST_F(LogfsTestCooked, SharedIndexKey) {
+    /* Both ids fold into the same slot index key */
+    const uint32_t obj1_twin_id = OBJ1_ID ^ 0x01010000;
+
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, obj1_twin_id, 0, obj1_alt, sizeof(obj1_alt)));
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, obj1_twin_id, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, 0));
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, obj1_twin_id, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+}
+
+TEST_F(LogfsTestCooked, RemountVerify) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ3_ID, 0, obj3, sizeof(obj3)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ2_ID, 0));
+
+    /* Mount again, the slot index has to be rebuilt from flash */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+    unsigned char obj2_check[OBJ2_SIZE];
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+
+    unsigned char obj3_check[OBJ3_SIZE];
+    memset(obj3_check, 0, sizeof(obj3_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ3_ID, 0, obj3_check, sizeof(obj3_check)));
+    EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
+}
+
+TEST_F(LogfsTestCooked, BackgroundGarbageCollect) {
+    struct PIOS_FLASHFS_Stats stats;
+
+    /* Nothing to collect on an empty filesystem */
+    EXPECT_EQ(0, PIOS_FLASHFS_CollectGarbage(fs_id, 8));
+
+    /* Fill most of the log with obsolete versions of a few objects */
+    for (uint16_t i = 0; i < 10; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+    }
+    for (uint16_t i = 0; i < 200; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+    }
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(10, stats.num_active_slots);
+    EXPECT_EQ(45, stats.num_free_slots);
+
+    /* Collect in small steps while objects keep being saved and deleted */
+    uint32_t steps = 0;
+    int32_t rc;
+    do {
+        rc = PIOS_FLASHFS_CollectGarbage(fs_id, 8);
+        EXPECT_LE(0, rc);
+        steps++;
+
+        if (steps == 10) {
+            /* Instance 1 has already been migrated at this point */
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 1, obj1_alt, sizeof(obj1_alt)));
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, 2));
+        }
+        if (steps == 20) {
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+        }
+    } while (rc > 0 && steps < 1000);
+    EXPECT_EQ(0, rc);
+    EXPECT_LT(10u, steps);
+
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(10, stats.num_active_slots);
+    EXPECT_LT(200, stats.num_free_slots);
+
+    /* Collection is done until the log fills up again */
+    EXPECT_EQ(0, PIOS_FLASHFS_CollectGarbage(fs_id, 8));
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 2, obj1_check, sizeof(obj1_check)));
+
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 9, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+
+    unsigned char obj2_check[OBJ2_SIZE];
+    memset(obj2_check, 0, sizeof(obj2_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+    EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+
+    /* Remount the collected arena */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(10, stats.num_active_slots);
+
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+}
+
+TEST_F(LogfsTestCooked, PowerLossDuringGarbageCollect) {
+    for (uint16_t i = 0; i < 10; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+    }
+    for (uint16_t i = 0; i < 200; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+    }
+
+    /* Erase the destination arena and migrate part of the log */
+    for (uint8_t i = 0; i < 5; i++) {
+        EXPECT_EQ(1, PIOS_FLASHFS_CollectGarbage(fs_id, 8));
+    }
+
+    /* Lose power, the partially filled destination arena must be ignored */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+
+    struct PIOS_FLASHFS_Stats stats;
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(10, stats.num_active_slots);
+    EXPECT_EQ(45, stats.num_free_slots);
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+    /* Fill the log, the collection starts over from scratch */
+    for (uint16_t i = 0; i < 100; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+    }
+
+    for (uint16_t i = 0; i < 10; i++) {
+        memset(obj1_check, 0, sizeof(obj1_check));
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+    }
+}
+
+TEST_F(LogfsTestCooked, MountMigratedArena) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+
+    /* Power was lost after the arena was migrated but before its copy got activated */
+    uint32_t migrated = 0xE6E60000;
+    EXPECT_EQ(0, pios_ut_flash_driver.start_transaction(flash_id));
+    EXPECT_EQ(0, pios_ut_flash_driver.write_data(flash_id, flashfs_config_partition_a.start_offset + sizeof(uint32_t), (uint8_t *)&migrated, sizeof(migrated)));
+    EXPECT_EQ(0, pios_ut_flash_driver.end_transaction(flash_id));
+
+    /* The migrated arena is still the most recent one */
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+
+    /* Keeps working through the next garbage collection */
+    for (uint32_t i = 0; i < (flashfs_config_partition_a.arena_size / flashfs_config_partition_a.slot_size); i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+    }
+
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+    unsigned char obj2_check[OBJ2_SIZE];
+    memset(obj2_check, 0, sizeof(obj2_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+    EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+
+    /* Only the new arena is left after a remount */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+    struct PIOS_FLASHFS_Stats stats;
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(2, stats.num_active_slots);
+}
+
+struct BatchContext {
+    struct PIOS_FLASHFS_Obj *objs;
+    uint16_t num_objs;
+    uint16_t next;
+};
+
+static bool nextBatchObj(void *context, struct PIOS_FLASHFS_Obj *obj)
+{
+    struct BatchContext *batch = (struct BatchContext *)context;
+
+    if (batch->next >= batch->num_objs) {
+        return false;
+    }
+    *obj = batch->objs[batch->next++];
+    return true;
+}
+
+TEST_F(LogfsTestCooked, SaveBatchSkipsUnchanged) {
+    struct PIOS_FLASHFS_Obj objs[] = {
+        { OBJ1_ID, 0, OBJ1_SIZE, obj1,     false },
+        { OBJ1_ID, 1, OBJ1_SIZE, obj1_alt, false },
+        { OBJ2_ID, 0, OBJ2_SIZE, obj2,     false },
+        { OBJ3_ID, 0, OBJ3_SIZE, obj3,     false },
+    };
+    struct BatchContext batch = { objs, 4, 0 };
+    struct PIOS_FLASHFS_Stats stats;
+
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, &nextBatchObj, &batch));
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(4, stats.num_active_slots);
+    uint16_t free_slots = stats.num_free_slots;
+
+    /* Saving the same data again doesn't write anything */
+    batch.next = 0;
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, &nextBatchObj, &batch));
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(free_slots, stats.num_free_slots);
+
+    /* Only the changed object is written */
+    objs[2].obj_data[0] ^= 0xFF;
+    batch.next = 0;
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, &nextBatchObj, &batch));
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(free_slots - 1, stats.num_free_slots);
+    EXPECT_EQ(4, stats.num_active_slots);
+
+    /* Objects flagged as changed are written without comparing */
+    objs[0].changed = true;
+    batch.next = 0;
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, &nextBatchObj, &batch));
+    EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+    EXPECT_EQ(free_slots - 2, stats.num_free_slots);
+
+    unsigned char obj2_check[OBJ2_SIZE];
+    memset(obj2_check, 0, sizeof(obj2_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+    EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+}
+
+TEST_F(LogfsTestCooked, SaveBatchGarbageCollect) {
+    struct PIOS_FLASHFS_Obj objs[] = {
+        { OBJ1_ID, 0, OBJ1_SIZE, obj1, true },
+        { OBJ2_ID, 0, OBJ2_SIZE, obj2, true },
+    };
+    struct BatchContext batch = { objs, 2, 0 };
+
+    /* Batches keep working when the log fills up */
+    for (uint32_t i = 0; i < (flashfs_config_partition_a.arena_size / flashfs_config_partition_a.slot_size); i++) {
+        batch.next = 0;
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, &nextBatchObj, &batch));
+    }
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+
+    unsigned char obj2_check[OBJ2_SIZE];
+    memset(obj2_check, 0, sizeof(obj2_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+    EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+}
+
 class LogfsTestCookedMultiPart : public LogfsTestRaw {
 protected:
     virtual void SetUp()
@@ -0,0 +1,6 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+/* the simulated clock of the test, see unittest_init.c */
+#define portTICK_RATE_MS 1
+uint32_t xTaskGetTickCount(void);
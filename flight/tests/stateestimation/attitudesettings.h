@@ -0,0 +1,21 @@
+#ifndef ATTITUDESETTINGS_H
+#define ATTITUDESETTINGS_H
+
+typedef enum {
+    ATTITUDESETTINGS_ZERODURINGARMING_FALSE = 0,
+    ATTITUDESETTINGS_ZERODURINGARMING_TRUE  = 1
+} AttitudeSettingsZeroDuringArmingOptions;
+
+typedef struct {
+    float   AccelKp;
+    float   AccelKi;
+    float   MagKi;
+    float   MagKp;
+    float   AccelTau;
+    float   YawBiasRate;
+    uint8_t ZeroDuringArming;
+} AttitudeSettingsData;
+
+void AttitudeSettingsGet(AttitudeSettingsData *data);
+
+#endif /* ATTITUDESETTINGS_H */
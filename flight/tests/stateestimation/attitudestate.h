@@ -0,0 +1,17 @@
+#ifndef ATTITUDESTATE_H
+#define ATTITUDESTATE_H
+
+typedef struct {
+    float q1;
+    float q2;
+    float q3;
+    float q4;
+    float Roll;
+    float Pitch;
+    float Yaw;
+} AttitudeStateData;
+
+void AttitudeStateGet(AttitudeStateData *data);
+void AttitudeStateSet(AttitudeStateData *data);
+
+#endif /* ATTITUDESTATE_H */
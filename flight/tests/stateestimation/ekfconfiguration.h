@@ -0,0 +1,57 @@
+#ifndef EKFCONFIGURATION_H
+#define EKFCONFIGURATION_H
+
+#include "uavobjectmanager.h"
+
+typedef struct {
+    float PositionNorth, PositionEast, PositionDown;
+    float VelocityNorth, VelocityEast, VelocityDown;
+    float AttitudeQ1, AttitudeQ2, AttitudeQ3, AttitudeQ4;
+    float GyroDriftX, GyroDriftY, GyroDriftZ;
+} EKFConfigurationPData;
+typedef struct {
+    float array[13];
+} EKFConfigurationPDataArray;
+#define EKFConfigurationPToArray(var) UAVObjectFieldToArray(EKFConfigurationPData, var)
+#define EKFCONFIGURATION_P_NUMELEM 13
+
+typedef struct {
+    float GyroX, GyroY, GyroZ;
+    float AccelX, AccelY, AccelZ;
+    float GyroDriftX, GyroDriftY, GyroDriftZ;
+} EKFConfigurationQData;
+typedef struct {
+    float array[9];
+} EKFConfigurationQDataArray;
+#define EKFConfigurationQToArray(var) UAVObjectFieldToArray(EKFConfigurationQData, var)
+#define EKFCONFIGURATION_Q_NUMELEM 9
+
+typedef struct {
+    float GPSPosNorth, GPSPosEast, GPSPosDown;
+    float GPSVelNorth, GPSVelEast, GPSVelDown;
+    float MagX, MagY, MagZ;
+    float BaroZ;
+} EKFConfigurationRData;
+typedef struct {
+    float array[10];
+} EKFConfigurationRDataArray;
+#define EKFConfigurationRToArray(var) UAVObjectFieldToArray(EKFConfigurationRData, var)
+#define EKFCONFIGURATION_R_NUMELEM 10
+
+typedef struct {
+    float FakeGPSPosIndoor;
+    float FakeGPSVelIndoor;
+    float FakeGPSVelAirspeed;
+} EKFConfigurationFakeRData;
+
+typedef struct {
+    EKFConfigurationPData     P;
+    EKFConfigurationQData     Q;
+    EKFConfigurationRData     R;
+    EKFConfigurationFakeRData FakeR;
+} EKFConfigurationData;
+
+int32_t EKFConfigurationInitialize();
+void EKFConfigurationGet(EKFConfigurationData *data);
+
+#endif /* EKFCONFIGURATION_H */
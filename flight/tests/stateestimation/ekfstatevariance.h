@@ -0,0 +1,26 @@
+#ifndef EKFSTATEVARIANCE_H
+#define EKFSTATEVARIANCE_H
+
+#include "uavobjectmanager.h"
+
+typedef struct {
+    float PositionNorth, PositionEast, PositionDown;
+    float VelocityNorth, VelocityEast, VelocityDown;
+    float AttitudeQ1, AttitudeQ2, AttitudeQ3, AttitudeQ4;
+    float GyroDriftX, GyroDriftY, GyroDriftZ;
+} EKFStateVariancePData;
+typedef struct {
+    float array[13];
+} EKFStateVariancePDataArray;
+#define EKFStateVariancePToArray(var) UAVObjectFieldToArray(EKFStateVariancePData, var)
+#define EKFSTATEVARIANCE_P_NUMELEM 13
+
+typedef struct {
+    EKFStateVariancePData P;
+} EKFStateVarianceData;
+
+int32_t EKFStateVarianceInitialize();
+void EKFStateVarianceGet(EKFStateVarianceData *data);
+void EKFStateVarianceSet(EKFStateVarianceData *data);
+
+#endif /* EKFSTATEVARIANCE_H */
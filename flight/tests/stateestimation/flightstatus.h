@@ -0,0 +1,20 @@
+#ifndef FLIGHTSTATUS_H
+#define FLIGHTSTATUS_H
+
+#include "uavobjectmanager.h"
+
+typedef enum {
+    FLIGHTSTATUS_ARMED_DISARMED = 0,
+    FLIGHTSTATUS_ARMED_ARMING   = 1,
+    FLIGHTSTATUS_ARMED_ARMED    = 2
+} FlightStatusArmedOptions;
+
+typedef struct {
+    uint8_t Armed;
+} FlightStatusData;
+
+int32_t FlightStatusInitialize();
+void FlightStatusGet(FlightStatusData *data);
+int32_t FlightStatusConnectCallback(UAVObjEventCallback cb);
+
+#endif /* FLIGHTSTATUS_H */
@@ -0,0 +1,12 @@
+#ifndef HOMELOCATION_H
+#define HOMELOCATION_H
+
+typedef struct {
+    float Be[3];
+    float g_e;
+} HomeLocationData;
+
+int32_t HomeLocationInitialize();
+void HomeLocationGet(HomeLocationData *data);
+
+#endif /* HOMELOCATION_H */
@@ -0,0 +1,11 @@
+#ifndef OPENPILOT_H
+#define OPENPILOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "pios.h"
+#include "uavobjectmanager.h"
+
+#endif /* OPENPILOT_H */
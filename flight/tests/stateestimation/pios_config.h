@@ -0,0 +1,11 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+#define PIOS_INCLUDE_FREERTOS
+
+#define PIOS_SENSOR_RATE 500.0f
+
+/* like Revolution, the complementary filter initializes its heading from the magnetometer */
+#define PIOS_INCLUDE_HMC5X83
+
+#endif /* PIOS_CONFIG_H */
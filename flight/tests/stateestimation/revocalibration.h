@@ -0,0 +1,7 @@
+#ifndef REVOCALIBRATION_H
+#define REVOCALIBRATION_H
+
+int32_t RevoCalibrationInitialize();
+void RevoCalibrationmag_biasArrayGet(float *NewMagBias);
+
+#endif /* REVOCALIBRATION_H */
@@ -0,0 +1,18 @@
+#ifndef SYSTEMALARMS_H
+#define SYSTEMALARMS_H
+
+typedef enum {
+    SYSTEMALARMS_ALARM_UNINITIALISED = 0,
+    SYSTEMALARMS_ALARM_OK       = 1,
+    SYSTEMALARMS_ALARM_WARNING  = 2,
+    SYSTEMALARMS_ALARM_CRITICAL = 3,
+    SYSTEMALARMS_ALARM_ERROR    = 4
+} SystemAlarmsAlarmOptions;
+
+typedef struct {
+    uint8_t Magnetometer;
+} SystemAlarmsAlarmData;
+
+void SystemAlarmsAlarmGet(SystemAlarmsAlarmData *data);
+
+#endif /* SYSTEMALARMS_H */
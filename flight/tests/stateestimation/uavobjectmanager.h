@@ -0,0 +1,17 @@
+#ifndef UAVOBJECTMANAGER_H
+#define UAVOBJECTMANAGER_H
+
+/* Just enough of the UAVObject API for the stubbed objects of the state estimation filters */
+
+typedef struct {
+    void *obj;
+} UAVObjEvent;
+
+typedef void (*UAVObjEventCallback)(UAVObjEvent *ev);
+
+#define UAVObjectFieldToArray(type, var) \
+    (*({ type *const dummy = &(var); \
+         &(((type##Array *)dummy)->array); } \
+       ))
+
+#endif /* UAVOBJECTMANAGER_H */
@@ -0,0 +1,233 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <math.h>
+#include <time.h> /* clock_gettime */
+
+extern "C" {
+#include "openpilot.h"
+#include "stateestimation.h"
+#include "attitudestate.h"
+#include "homelocation.h"
+#include "CoordinateConversions.h"
+
+extern uint32_t simTimeuS;
+extern AttitudeStateData attitudeState;
+extern HomeLocationData homeLocation;
+}
+
+// Host side harness for the attitude filters of StateEstimation. A known
+// trajectory is turned into sensor samples at the board sensor rate, the
+// filter runs on them against a simulated clock and the test checks the
+// attitude error versus the trajectory. The filter run time per sample is
+// reported as well, so changes to the filter code can be compared off-target.
+
+#define SENSOR_PERIOD_US 2000 // 500Hz, PIOS_SENSOR_RATE
+#define MAG_DIVIDER      5 // 100Hz
+#define BARO_DIVIDER     10 // 50Hz
+#define GPS_DIVIDER      50 // 10Hz
+#define GRAVITY          9.81
+
+struct Scenario {
+    double seconds; // duration of the run
+    double settle; // errors before this time are not accounted
+    double rpy[3]; // initial attitude in deg
+    double start; // time the vehicle starts rotating
+    double rate[3]; // body rates in deg/s
+    double gyroBias[3]; // deg/s
+    double gyroNoise; // deg/s
+    double accelNoise; // m/s^2
+};
+
+struct Result {
+    double meanuS; // filter run time per sample
+    double maxuS;
+    double finalErrorDeg; // attitude error at the end
+    double maxErrorDeg; // attitude error after settle time
+    uint32_t failures; // samples with a filter result other than OK after settle time
+};
+
+// deterministic noise, roughly gaussian with the given standard deviation
+static double noise(uint32_t *seed, double sigma)
+{
+    double sum = 0.0;
+
+    for (int i = 0; i < 12; i++) {
+        *seed = *seed * 1664525u + 1013904223u;
+        sum  += (*seed >> 8) / 16777216.0;
+    }
+    return (sum - 6.0) * sigma;
+}
+
+// angle in degrees of the rotation between two attitudes
+static double attitudeError(const double q[4], const float qest[4])
+{
+    double dot = q[0] * qest[0] + q[1] * qest[1] + q[2] * qest[2] + q[3] * qest[3];
+
+    dot = fabs(dot);
+    if (dot > 1.0) {
+        dot = 1.0;
+    }
+    return 2.0 * acos(dot) * 180.0 / M_PI;
+}
+
+static double elapseduS(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) * 1e-3;
+}
+
+static Result runFilter(int32_t (*initialize)(stateFilter *), const Scenario &scenario, const char *name)
+{
+    stateFilter filter;
+    Result result = { 0.0, 0.0, 0.0, 0.0, 0 };
+    double q[4];
+    uint32_t seed = 1;
+    uint32_t steps = (uint32_t)(scenario.seconds * 1e6 / SENSOR_PERIOD_US);
+
+    float rpy[3]  = { (float)scenario.rpy[0], (float)scenario.rpy[1], (float)scenario.rpy[2] };
+    float q0[4];
+    RPY2Quaternion(rpy, q0);
+    for (int i = 0; i < 4; i++) {
+        q[i] = q0[i];
+    }
+
+    simTimeuS = 0;
+    attitudeState.q1 = 1.0f;
+    attitudeState.q2 = attitudeState.q3 = attitudeState.q4 = 0.0f;
+
+    initialize(&filter);
+    EXPECT_EQ(0, filter.init(&filter));
+
+    for (uint32_t step = 1; step <= steps; step++) {
+        double t = step * SENSOR_PERIOD_US * 1e-6;
+        double rate[3];
+
+        for (int i = 0; i < 3; i++) {
+            rate[i] = (t > scenario.start) ? scenario.rate[i] : 0.0;
+        }
+
+        // advance the trajectory, qdot = 1/2 q * w
+        const int substeps = 10;
+        double dT = SENSOR_PERIOD_US * 1e-6 / substeps;
+        for (int s = 0; s < substeps; s++) {
+            double p  = rate[0] * M_PI / 180.0, r = rate[2] * M_PI / 180.0;
+            double qq = rate[1] * M_PI / 180.0;
+            double qdot[4] = {
+                0.5 * (-q[1] * p - q[2] * qq - q[3] * r),
+                0.5 * (q[0] * p - q[3] * qq + q[2] * r),
+                0.5 * (q[3] * p + q[0] * qq - q[1] * r),
+                0.5 * (-q[2] * p + q[1] * qq + q[0] * r)
+            };
+            double qmag = 0.0;
+            for (int i = 0; i < 4; i++) {
+                q[i] += qdot[i] * dT;
+                qmag += q[i] * q[i];
+            }
+            qmag = sqrt(qmag);
+            for (int i = 0; i < 4; i++) {
+                q[i] /= qmag;
+            }
+        }
+        simTimeuS += SENSOR_PERIOD_US;
+
+        // sensor samples, the vehicle rotates in place
+        float qf[4] = { (float)q[0], (float)q[1], (float)q[2], (float)q[3] };
+        float Rbe[3][3];
+        Quaternion2R(qf, Rbe);
+
+        stateEstimation state;
+        memset(&state, 0, sizeof(state));
+        for (int i = 0; i < 3; i++) {
+            state.gyro[i]  = rate[i] + scenario.gyroBias[i] + noise(&seed, scenario.gyroNoise);
+            state.accel[i] = -GRAVITY * Rbe[i][2] + noise(&seed, scenario.accelNoise);
+            state.mag[i]   = Rbe[i][0] * homeLocation.Be[0] + Rbe[i][1] * homeLocation.Be[1] + Rbe[i][2] * homeLocation.Be[2];
+        }
+        state.updated = (sensorUpdates)(SENSORUPDATES_gyro | SENSORUPDATES_accel);
+        if (step % MAG_DIVIDER == 0) {
+            state.updated = (sensorUpdates)(state.updated | SENSORUPDATES_mag);
+        }
+        if (step % BARO_DIVIDER == 0) {
+            state.updated = (sensorUpdates)(state.updated | SENSORUPDATES_baro);
+        }
+        if (step % GPS_DIVIDER == 0) {
+            state.updated = (sensorUpdates)(state.updated | SENSORUPDATES_pos | SENSORUPDATES_vel);
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        filterResult res = filter.filter(&filter, &state);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double us = elapseduS(&start, &end);
+        result.meanuS += us;
+        if (us > result.maxuS) {
+            result.maxuS = us;
+        }
+
+        // publish the attitude the way StateEstimation does, the filters read it back
+        if (IS_SET(state.updated, SENSORUPDATES_attitude)) {
+            attitudeState.q1 = state.attitude[0];
+            attitudeState.q2 = state.attitude[1];
+            attitudeState.q3 = state.attitude[2];
+            attitudeState.q4 = state.attitude[3];
+            Quaternion2RPY(&attitudeState.q1, &attitudeState.Roll);
+        }
+
+        if (t >= scenario.settle) {
+            double error = attitudeError(q, &attitudeState.q1);
+            if (error > result.maxErrorDeg) {
+                result.maxErrorDeg = error;
+            }
+            result.finalErrorDeg = error;
+            if (res != FILTERRESULT_OK) {
+                result.failures++;
+            }
+        }
+    }
+    result.meanuS /= steps;
+
+    printf("[ %-8s ] %.2f us/sample mean, %.2f us max, attitude error %.3f deg final, %.3f deg max, %u failures\n",
+           name, result.meanuS, result.maxuS, result.finalErrorDeg, result.maxErrorDeg, (unsigned)result.failures);
+    return result;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class StateEstimationTest : public testing::Test {};
+
+TEST_F(StateEstimationTest, EKF13Stationary) {
+    Scenario scenario = { 30.0, 10.0, { 10.0, -20.0, 45.0 }, 0.0, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, 0.1, 0.05 };
+    Result result     = runFilter(&filterEKF13Initialize, scenario, "EKF13");
+
+    EXPECT_EQ(0u, result.failures);
+    EXPECT_LT(result.maxErrorDeg, 1.0);
+}
+
+TEST_F(StateEstimationTest, EKF13Rotating) {
+    Scenario scenario = { 60.0, 20.0, { 0.0, 0.0, 0.0 }, 2.0, { 5.0, -3.0, 20.0 }, { 0.5, -0.5, 0.3 }, 0.1, 0.05 };
+    Result result     = runFilter(&filterEKF13Initialize, scenario, "EKF13");
+
+    EXPECT_EQ(0u, result.failures);
+    EXPECT_LT(result.maxErrorDeg, 5.0);
+    EXPECT_LT(result.finalErrorDeg, 2.0);
+}
+
+TEST_F(StateEstimationTest, CFMStationary) {
+    // the complementary filter calibrates the gyro bias for the first ten seconds
+    Scenario scenario = { 30.0, 15.0, { 10.0, -20.0, 45.0 }, 0.0, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, 0.1, 0.05 };
+    Result result     = runFilter(&filterCFMInitialize, scenario, "CFM");
+
+    EXPECT_EQ(0u, result.failures);
+    EXPECT_LT(result.maxErrorDeg, 1.0);
+}
+
+TEST_F(StateEstimationTest, CFMRotating) {
+    // rotation starts after the gyro bias calibration of the complementary filter
+    Scenario scenario = { 60.0, 20.0, { 0.0, 0.0, 0.0 }, 12.0, { 5.0, -3.0, 20.0 }, { 0.5, -0.5, 0.3 }, 0.1, 0.05 };
+    Result result     = runFilter(&filterCFMInitialize, scenario, "CFM");
+
+    EXPECT_EQ(0u, result.failures);
+    EXPECT_LT(result.maxErrorDeg, 5.0);
+    EXPECT_LT(result.finalErrorDeg, 2.0);
+}
@@ -0,0 +1,141 @@
+/*
+ * Stubbed UAVObjects and the simulated clock the state estimation
+ * filters run against. The objects hold the defaults of their xml
+ * definitions, the test writes to them through the extern variables.
+ */
+
+#include "openpilot.h"
+
+#include <ekfconfiguration.h>
+#include <ekfstatevariance.h>
+#include <attitudestate.h>
+#include <attitudesettings.h>
+#include <systemalarms.h>
+#include <homelocation.h>
+#include <flightstatus.h>
+#include <revocalibration.h>
+
+/* simulated time, advanced by the test for every sensor sample */
+uint32_t simTimeuS = 0;
+
+uint32_t xTaskGetTickCount(void)
+{
+    return simTimeuS / 1000;
+}
+
+uint32_t PIOS_DELAY_GetRaw()
+{
+    return simTimeuS;
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return simTimeuS - raw;
+}
+
+void PIOS_NOTIFY_StartNotification(__attribute__((unused)) pios_notify_notification notification, __attribute__((unused)) pios_notify_priority priority) {}
+
+EKFConfigurationData ekfConfiguration = {
+    .P     = { 10.0f, 10.0f, 10.0f, 1.0f, 1.0f, 1.0f, 0.007f, 0.007f, 0.007f, 0.007f, 0.000001f, 0.000001f, 0.000001f },
+    .Q     = { 0.01f, 0.01f, 0.01f, 0.01f, 0.01f, 0.01f, 0.000001f, 0.000001f, 0.000001f },
+    .R     = { 1.0f, 1.0f, 1000000.0f, 0.001f, 0.001f, 0.001f, 10.0f, 10.0f, 10.0f, 0.01f },
+    .FakeR = { 10.0f, 1.0f, 1000.0f },
+};
+EKFStateVarianceData ekfStateVariance;
+AttitudeStateData attitudeState = { .q1 = 1.0f };
+AttitudeSettingsData attitudeSettings = {
+    .AccelKp          = 0.05f,
+    .AccelKi          = 0.0001f,
+    .MagKi            = 0.000001f,
+    .MagKp            = 0.01f,
+    .AccelTau         = 0.0f,
+    .YawBiasRate      = 0.000001f,
+    .ZeroDuringArming = ATTITUDESETTINGS_ZERODURINGARMING_TRUE,
+};
+SystemAlarmsAlarmData systemAlarms = { .Magnetometer = SYSTEMALARMS_ALARM_OK };
+// no declination, the complementary filter takes the magnetic field for north when it initializes
+HomeLocationData homeLocation = { .Be = { 200.0f, 0.0f, 400.0f }, .g_e = 9.81f };
+FlightStatusData flightStatus = { .Armed = FLIGHTSTATUS_ARMED_DISARMED };
+float revoCalibrationMagBias[3] = { 1.0f, 1.0f, 1.0f }; // non zero, the magnetometer counts as calibrated
+
+int32_t EKFConfigurationInitialize()
+{
+    return 0;
+}
+
+void EKFConfigurationGet(EKFConfigurationData *data)
+{
+    *data = ekfConfiguration;
+}
+
+int32_t EKFStateVarianceInitialize()
+{
+    return 0;
+}
+
+void EKFStateVarianceGet(EKFStateVarianceData *data)
+{
+    *data = ekfStateVariance;
+}
+
+void EKFStateVarianceSet(EKFStateVarianceData *data)
+{
+    ekfStateVariance = *data;
+}
+
+void AttitudeStateGet(AttitudeStateData *data)
+{
+    *data = attitudeState;
+}
+
+void AttitudeStateSet(AttitudeStateData *data)
+{
+    attitudeState = *data;
+}
+
+void AttitudeSettingsGet(AttitudeSettingsData *data)
+{
+    *data = attitudeSettings;
+}
+
+void SystemAlarmsAlarmGet(SystemAlarmsAlarmData *data)
+{
+    *data = systemAlarms;
+}
+
+int32_t HomeLocationInitialize()
+{
+    return 0;
+}
+
+void HomeLocationGet(HomeLocationData *data)
+{
+    *data = homeLocation;
+}
+
+int32_t FlightStatusInitialize()
+{
+    return 0;
+}
+
+void FlightStatusGet(FlightStatusData *data)
+{
+    *data = flightStatus;
+}
+
+int32_t FlightStatusConnectCallback(__attribute__((unused)) UAVObjEventCallback cb)
+{
+    return 0;
+}
+
+int32_t RevoCalibrationInitialize()
+{
+    return 0;
+}
+
+void RevoCalibrationmag_biasArrayGet(float *NewMagBias)
+{
+    NewMagBias[0] = revoCalibrationMagBias[0];
+    NewMagBias[1] = revoCalibrationMagBias[1];
+    NewMagBias[2] = revoCalibrationMagBias[2];
+}
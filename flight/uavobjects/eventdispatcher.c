@@ -44,6 +44,10 @@
 #define CALLBACK_PRIORITY    CALLBACK_PRIORITY_CRITICAL
 #define TASK_PRIORITY        CALLBACK_TASK_FLIGHTCONTROL
 #define MAX_UPDATE_PERIOD_MS 1000
+#define HEAP_CHUNK_SHIFT     5
+#define HEAP_CHUNK_SIZE      (1 << HEAP_CHUNK_SHIFT)
+#define HEAP_MAX_CHUNKS      16
+#define HEAP_INDEX_NONE      0xFFFF
 
 // Private types
 
@@ -60,17 +64,28 @@ typedef struct {
 
 /**
  * List of object properties that are needed for the periodic updates.
+ * Entries with a non zero period are also kept in a binary min-heap ordered
+ * by the time of their next update, so only due entries are visited. The heap
+ * storage is added in chunks that are never moved or freed, pios_free() does
+ * nothing with heap_1.
  */
 struct PeriodicObjectListStruct {
     EventCallbackInfo evInfo; /** Event callback information */
     uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
-    int32_t  timeToNextUpdateMs; /** Time delay to the next update */
+    uint16_t heapIndex; /** Position in the heap or HEAP_INDEX_NONE */
+    int32_t  timeToNextUpdateMs; /** System time of the next update */
     struct PeriodicObjectListStruct *next; /** Needed by linked list library (utlist.h) */
 };
 typedef struct PeriodicObjectListStruct PeriodicObjectList;
 
 // Private variables
 static PeriodicObjectList *mObjList;
+static PeriodicObjectList **mHeapChunks[HEAP_MAX_CHUNKS];
+static uint16_t mHeapSize;
+static uint16_t mHeapCapacity;
+static uint32_t mLatencySumMs;
+static int32_t mLastLatencyMs;
+static uint32_t mJitterX16;
 static xQueueHandle mQueue;
 static DelayedCallbackInfo *eventSchedulerCallback;
 static xSemaphoreHandle mMutex;
@@ -82,6 +97,14 @@ static void eventTask();
 static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static uint16_t randomizePeriod(uint16_t periodMs);
+static void schedulePeriodic(PeriodicObjectList *objEntry);
+static void heapRemove(PeriodicObjectList *objEntry);
+static void heapSiftUp(uint16_t index);
+static void heapSiftDown(uint16_t index);
+static void updateLatencyStats(int32_t latencyMs);
+
+// Heap entry at a position
+#define HEAP(index) (mHeapChunks[(index) >> HEAP_CHUNK_SHIFT][(index) & (HEAP_CHUNK_SIZE - 1)])
 
 
 /**
@@ -92,7 +115,13 @@ int32_t EventDispatcherInitialize()
 {
     // Initialize variables
     mObjList = NULL;
+    mHeapSize     = 0;
+    mHeapCapacity = 0;
+    memset(mHeapChunks, 0, sizeof(mHeapChunks));
     memset(&mStats, 0, sizeof(EventStats));
+    mLatencySumMs  = 0;
+    mLastLatencyMs = 0;
+    mJitterX16     = 0;
 
     // Create mMutex
     mMutex = xSemaphoreCreateRecursiveMutex();
@@ -119,6 +148,10 @@ void EventGetStats(EventStats *statsOut)
 {
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
     memcpy(statsOut, &mStats, sizeof(EventStats));
+    if (mStats.periodicEvents > 0) {
+        statsOut->avgLatencyMs = mLatencySumMs / mStats.periodicEvents;
+    }
+    statsOut->jitterMs = mJitterX16 / 16;
     xSemaphoreGiveRecursive(mMutex);
 }
 
@@ -129,6 +162,9 @@ void EventClearStats()
 {
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
     memset(&mStats, 0, sizeof(EventStats));
+    mLatencySumMs  = 0;
+    mLastLatencyMs = 0;
+    mJitterX16     = 0;
     xSemaphoreGiveRecursive(mMutex);
 }
 
@@ -230,6 +266,7 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     // Create handle
     objEntry = (PeriodicObjectList *)pios_malloc(sizeof(PeriodicObjectList));
     if (objEntry == NULL) {
+        xSemaphoreGiveRecursive(mMutex);
         return -1;
     }
     objEntry->evInfo.ev.obj      = ev->obj;
@@ -238,7 +275,8 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     objEntry->evInfo.cb = cb;
     objEntry->evInfo.queue       = queue;
     objEntry->updatePeriodMs     = periodMs;
-    objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+    objEntry->heapIndex = HEAP_INDEX_NONE;
+    schedulePeriodic(objEntry);
     // Add to list
     LL_APPEND(mObjList, objEntry);
     // Release lock
@@ -268,8 +306,8 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
             objEntry->evInfo.ev.instId == ev->instId &&
             objEntry->evInfo.ev.event == ev->event) {
             // Object found, update period
-            objEntry->updatePeriodMs     = periodMs;
-            objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+            objEntry->updatePeriodMs = periodMs;
+            schedulePeriodic(objEntry);
             // Release lock
             xSemaphoreGiveRecursive(mMutex);
             return 0;
@@ -311,8 +349,8 @@ static void eventTask()
 }
 
 /**
- * Handle periodic updates for all objects.
- * \return The system time until the next update (in ms) or -1 if failed
+ * Handle periodic updates of all objects that are due.
+ * \return The system time of the next update (in ms)
  */
 static int32_t processPeriodicUpdates()
 {
@@ -324,44 +362,165 @@ static int32_t processPeriodicUpdates()
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update.
-    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
-    LL_FOREACH(mObjList, objEntry) {
-        // If object is configured for periodic updates
-        if (objEntry->updatePeriodMs > 0) {
-            // Check if time for the next update
-            timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
-            if (objEntry->timeToNextUpdateMs <= timeNow) {
-                // Reset timer
-                offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
-                objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
-                // Invoke callback, if one
-                if (objEntry->evInfo.cb != 0) {
-                    objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
-                }
-                // Push event to queue, if one
-                if (objEntry->evInfo.queue != 0) {
-                    if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
-                        if (objEntry->evInfo.ev.obj != NULL) {
-                            mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
-                        }
-                        ++mStats.eventErrors;
-                    }
+    // Pop due entries off the heap, reschedule and dispatch them
+    timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    while (mHeapSize > 0 && HEAP(0)->timeToNextUpdateMs <= timeNow) {
+        objEntry = HEAP(0);
+        updateLatencyStats(timeNow - objEntry->timeToNextUpdateMs);
+        // Reset timer, the callbacks below may change the heap so do this first
+        offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
+        objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
+        heapSiftDown(0);
+        // Invoke callback, if one
+        if (objEntry->evInfo.cb != 0) {
+            objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
+        }
+        // Push event to queue, if one
+        if (objEntry->evInfo.queue != 0) {
+            if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
+                if (objEntry->evInfo.ev.obj != NULL) {
+                    mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
                 }
-            }
-            // Update minimum delay
-            if (objEntry->timeToNextUpdateMs < timeToNextUpdate) {
-                timeToNextUpdate = objEntry->timeToNextUpdateMs;
+                ++mStats.eventErrors;
             }
         }
     }
 
+    // The next update is the one on top of the heap
+    timeToNextUpdate = timeNow + MAX_UPDATE_PERIOD_MS;
+    if (mHeapSize > 0 && HEAP(0)->timeToNextUpdateMs < timeToNextUpdate) {
+        timeToNextUpdate = HEAP(0)->timeToNextUpdateMs;
+    }
+
     // Done
     xSemaphoreGiveRecursive(mMutex);
     return timeToNextUpdate;
 }
 
+/**
+ * Account the dispatch latency of a periodic event.
+ * The jitter is the running mean deviation of consecutive latencies (as in RFC 3550).
+ * \param[in] latencyMs Time between the event being due and its dispatch
+ */
+static void updateLatencyStats(int32_t latencyMs)
+{
+    int32_t delta = latencyMs - mLastLatencyMs;
+
+    mLastLatencyMs = latencyMs;
+    ++mStats.periodicEvents;
+    mLatencySumMs += latencyMs;
+    if ((uint32_t)latencyMs > mStats.maxLatencyMs) {
+        mStats.maxLatencyMs = latencyMs;
+    }
+    mJitterX16 += (delta < 0 ? -delta : delta) - ((mJitterX16 + 8) / 16);
+}
+
+/**
+ * (Re)schedule an entry after its period changed. The first update is
+ * randomly spread over one period to avoid bunching of updates.
+ * \param[in] objEntry The entry
+ */
+static void schedulePeriodic(PeriodicObjectList *objEntry)
+{
+    if (objEntry->updatePeriodMs == 0) {
+        heapRemove(objEntry);
+        return;
+    }
+
+    objEntry->timeToNextUpdateMs = xTaskGetTickCount() * portTICK_RATE_MS + randomizePeriod(objEntry->updatePeriodMs);
+
+    if (objEntry->heapIndex == HEAP_INDEX_NONE) {
+        if (mHeapSize == mHeapCapacity) {
+            // Add a chunk to the heap storage
+            PeriodicObjectList **chunk = NULL;
+            if ((mHeapCapacity >> HEAP_CHUNK_SHIFT) < HEAP_MAX_CHUNKS) {
+                chunk = (PeriodicObjectList **)pios_malloc(HEAP_CHUNK_SIZE * sizeof(PeriodicObjectList *));
+            }
+            if (chunk == NULL) {
+                // Out of memory, the entry never fires
+                ++mStats.eventErrors;
+                return;
+            }
+            mHeapChunks[mHeapCapacity >> HEAP_CHUNK_SHIFT] = chunk;
+            mHeapCapacity += HEAP_CHUNK_SIZE;
+        }
+        objEntry->heapIndex = mHeapSize;
+        HEAP(mHeapSize)     = objEntry;
+        ++mHeapSize;
+    }
+    heapSiftUp(objEntry->heapIndex);
+    heapSiftDown(objEntry->heapIndex);
+}
+
+/**
+ * Remove an entry from the heap, if it is in there.
+ * \param[in] objEntry The entry
+ */
+static void heapRemove(PeriodicObjectList *objEntry)
+{
+    uint16_t index = objEntry->heapIndex;
+
+    if (index == HEAP_INDEX_NONE) {
+        return;
+    }
+    objEntry->heapIndex = HEAP_INDEX_NONE;
+
+    PeriodicObjectList *last = HEAP(mHeapSize - 1);
+    --mHeapSize;
+    if (last != objEntry) {
+        // Fill the hole with the last entry and restore the heap order
+        HEAP(index)    = last;
+        last->heapIndex = index;
+        heapSiftUp(index);
+        heapSiftDown(last->heapIndex);
+    }
+}
+
+/**
+ * Move a heap entry up until its parent is due before it.
+ * \param[in] index Position of the entry
+ */
+static void heapSiftUp(uint16_t index)
+{
+    PeriodicObjectList *objEntry = HEAP(index);
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if (HEAP(parent)->timeToNextUpdateMs <= objEntry->timeToNextUpdateMs) {
+            break;
+        }
+        HEAP(index) = HEAP(parent);
+        HEAP(index)->heapIndex = index;
+        index = parent;
+    }
+    HEAP(index) = objEntry;
+    objEntry->heapIndex = index;
+}
+
+/**
+ * Move a heap entry down until its children are due after it.
+ * \param[in] index Position of the entry
+ */
+static void heapSiftDown(uint16_t index)
+{
+    PeriodicObjectList *objEntry = HEAP(index);
+
+    while (2 * index + 1 < mHeapSize) {
+        uint16_t child = 2 * index + 1;
+        if (child + 1 < mHeapSize && HEAP(child + 1)->timeToNextUpdateMs < HEAP(child)->timeToNextUpdateMs) {
+            ++child;
+        }
+        if (objEntry->timeToNextUpdateMs <= HEAP(child)->timeToNextUpdateMs) {
+            break;
+        }
+        HEAP(index) = HEAP(child);
+        HEAP(index)->heapIndex = index;
+        index = child;
+    }
+    HEAP(index) = objEntry;
+    objEntry->heapIndex = index;
+}
+
 /**
  * Return a psedorandom integer from 0 to periodMs
  * Based on the Park-Miller-Carta Pseudo-Random Number Generator
@@ -33,6 +33,10 @@
 typedef struct {
     uint32_t lastErrorID;
     uint32_t eventErrors;
+    uint32_t periodicEvents; /** Number of periodic events dispatched */
+    uint32_t avgLatencyMs; /** Average delay between a periodic event being due and its dispatch */
+    uint32_t maxLatencyMs; /** Largest delay between a periodic event being due and its dispatch */
+    uint32_t jitterMs; /** Smoothed variation of that delay between consecutive events */
 } EventStats;
 
 // Public functions
@@ -101,6 +101,19 @@ struct UAVOBase {
         bool isSettings    : 1;
         bool isPriority    : 1;
     } flags;
+
+    /*
+     * CRC of instance 0 as last saved to or loaded from flash,
+     * lets UAVObjSaveSettings() tell changed objects apart.
+     */
+    uint8_t savedCRC;
+
+    /*
+     * Sequence counter for lock-free readers, odd while the
+     * instance data is being written. Kept halfword aligned
+     * so that it can be read and written in a single access.
+     */
+    uint16_t seq;
 } __attribute__((packed));
 
 /* Augmented type for Meta UAVO */
@@ -165,8 +178,18 @@ struct UAVOMulti {
 #define InstanceDataOffset(inst)         ((void *)&(((struct UAVOMultiInst *)inst)->instance))
 #define InstanceData(instance)           ((void *)instance)
 
+/** access to the sequence counter, see beginInstanceWrite() and endInstanceWrite() **/
+#define InstanceSeq(obj)                 (*(volatile uint16_t *)&((obj)->seq))
+
 // Private functions
 int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType event);
 InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId);
+void beginInstanceWrite(struct UAVOBase *obj);
+void endInstanceWrite(struct UAVOBase *obj);
+
+/* Hands out the next object instance to save, returns false once there are no more */
+typedef bool (*UAVObjSaveIterator)(void *context, UAVObjHandle *obj_handle, uint16_t *instId, bool *changed);
+int32_t UAVObjSaveMultiple(UAVObjSaveIterator next, void *context);
+int32_t UAVObjPersistenceInitialize();
 
 #endif /* UAVOBJECTPRIVATE_H_ */
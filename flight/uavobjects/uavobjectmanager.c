@@ -34,12 +34,22 @@
 #include "openpilot.h"
 #include "pios_struct_helper.h"
 #include "inc/uavobjectprivate.h"
+#include <uavobjectsinit.h>
+
+#define PIOS_INSTRUMENT_MODULE
+#include <pios_instrumentation_helper.h>
+
+// Number of lock-free read attempts before waiting on the lock
+#define LOCKFREE_READ_RETRIES 3
 
 // Private functions
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId);
 static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask);
 static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb);
 static void instanceAutoUpdated(UAVObjHandle obj_handle, uint16_t instId);
+static int32_t findIndexSlot(uint32_t id);
+static void lockTracked(void);
+static void readInstanceData(struct UAVOBase *obj, void *dataOut, const void *dataIn, uint32_t size);
 
 
 int32_t UAVObjPers_stub(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused))  uint16_t instId)
@@ -49,6 +59,16 @@ int32_t UAVObjPers_stub(__attribute__((unused)) UAVObjHandle obj_handle, __attri
 int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId)  __attribute__((weak, alias("UAVObjPers_stub")));;
 int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId) __attribute__((weak, alias("UAVObjPers_stub")));
 int32_t UAVObjDelete(UAVObjHandle obj_handle, uint16_t instId) __attribute__((weak, alias("UAVObjPers_stub")));
+int32_t UAVObjPersMultiple_stub(__attribute__((unused)) UAVObjSaveIterator next, __attribute__((unused)) void *context)
+{
+    return 0;
+}
+int32_t UAVObjSaveMultiple(UAVObjSaveIterator next, void *context) __attribute__((weak, alias("UAVObjPersMultiple_stub")));
+int32_t UAVObjPersInit_stub()
+{
+    return 0;
+}
+int32_t UAVObjPersistenceInitialize() __attribute__((weak, alias("UAVObjPersInit_stub")));
 
 
 // Private variables
@@ -67,6 +87,17 @@ static const UAVObjMetadata defMetadata = {
 
 static UAVObjStats stats;
 
+// Object ID lookup table, generated in ascending order by the UAVObjectGenerator.
+// uavo_index holds the registered object for each ID (or NULL) at the same position.
+static const uint32_t uavo_ids[UAVOBJECTS_COUNT] = UAVOBJECTS_ID_TABLE;
+static struct UAVOData *uavo_index[UAVOBJECTS_COUNT];
+
+PERF_DEFINE_COUNTER(counterLockWait);
+PERF_DEFINE_COUNTER(counterLockedReads);
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+static uint32_t lockedReads;
+#endif
+
 /**
  * Initialize the object manager
  * \return 0 Success
@@ -88,12 +119,27 @@ int32_t UAVObjInitialize()
     memset(__start__uavo_handles, 0,
            (uintptr_t)__stop__uavo_handles - (uintptr_t)__start__uavo_handles);
 
+    // Initialize the object ID index
+    memset(uavo_index, 0, sizeof(uavo_index));
+
     // Create mutex
     mutex = xSemaphoreCreateRecursiveMutex();
     if (mutex == NULL) {
         return -1;
     }
 
+    if (UAVObjPersistenceInitialize() != 0) {
+        return -1;
+    }
+
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+    // Only create the counters if the instrumentation has been initialized
+    if (pios_instrumentation_perf_counters) {
+        PERF_INIT_COUNTER(counterLockWait, 0x55A70001);
+        PERF_INIT_COUNTER(counterLockedReads, 0x55A70002);
+    }
+#endif
+
     // Done
     return 0;
 }
@@ -259,6 +305,12 @@ UAVObjHandle UAVObjRegister(uint32_t id,
         UAVObjLoad((UAVObjHandle)uavo_data, 0);
     }
 
+    /* Publish the fully initialized object in the ID index */
+    int32_t slot = findIndexSlot(id);
+    if (slot >= 0) {
+        uavo_index[slot] = uavo_data;
+    }
+
     // fire events for outer object and its embedded meta object
     instanceAutoUpdated((UAVObjHandle)uavo_data, 0);
     instanceAutoUpdated((UAVObjHandle) & (uavo_data->metaObj), 0);
@@ -268,14 +320,54 @@ unlock_exit:
     return (UAVObjHandle)uavo_data;
 }
 
+/**
+ * Find the position of an object ID in the generated ID table
+ * \param[in] id The object ID
+ * \return The table position or -1 if the ID is not in the table
+ */
+static int32_t findIndexSlot(uint32_t id)
+{
+    int32_t low  = 0;
+    int32_t high = UAVOBJECTS_COUNT - 1;
+
+    while (low <= high) {
+        int32_t mid = (low + high) >> 1;
+        if (uavo_ids[mid] < id) {
+            low = mid + 1;
+        } else if (uavo_ids[mid] > id) {
+            high = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+    return -1;
+}
+
 /**
  * Retrieve an object from the list given its id
+ * Objects known to the UAVObjectGenerator are looked up in the ID index without
+ * taking the lock, other IDs fall back to a search of the whole object list.
  * \param[in] The object ID
  * \return The object or NULL if not found.
  */
 UAVObjHandle UAVObjGetByID(uint32_t id)
 {
     UAVObjHandle *found_obj = (UAVObjHandle *)NULL;
+    struct UAVOData *uavo_data;
+    int32_t slot;
+
+    // Look for a data object
+    slot = findIndexSlot(id);
+    if (slot >= 0) {
+        return (UAVObjHandle)uavo_index[slot];
+    }
+
+    // Look for a meta object
+    slot = findIndexSlot(id - 1);
+    if (slot >= 0) {
+        uavo_data = uavo_index[slot];
+        return uavo_data ? (UAVObjHandle)MetaObjectPtr(uavo_data) : NULL;
+    }
 
     // Get lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
@@ -506,7 +598,7 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockTracked();
 
     int32_t rc = -1;
 
@@ -514,7 +606,9 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
         if (instId != 0) {
             goto unlock_exit;
         }
+        beginInstanceWrite((struct UAVOBase *)obj_handle);
         memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+        endInstanceWrite((struct UAVOBase *)obj_handle);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -533,7 +627,9 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
             }
         }
         // Set the data
+        beginInstanceWrite(&obj->base);
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        endInstanceWrite(&obj->base);
     }
 
     // Fire event
@@ -556,16 +652,11 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
-
     if (UAVObjIsMetaobject(obj_handle)) {
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+        readInstanceData((struct UAVOBase *)obj_handle, dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -576,17 +667,13 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
         // Get the instance
         instEntry = getInstance(obj, instId);
         if (instEntry == NULL) {
-            goto unlock_exit;
+            return -1;
         }
         // Pack data
-        memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
+        readInstanceData(&obj->base, dataOut, InstanceData(instEntry), obj->instance_size);
     }
 
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return 0;
 }
 
 /**
@@ -607,7 +694,8 @@ uint8_t UAVObjUpdateCRC(UAVObjHandle obj_handle, uint16_t instId, uint8_t crc)
         if (instId != 0) {
             goto unlock_exit;
         }
-        // TODO
+        // Update crc
+        crc = PIOS_CRC_updateCRC(crc, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -666,34 +754,61 @@ unlock_exit:
     xSemaphoreGiveRecursive(mutex);
 }
 
+struct SaveAllContext {
+    struct UAVOData * *slot;
+    bool metaobjects;
+};
+
+/**
+ * Iterator over all settings objects or all metaobjects for UAVObjSaveMultiple().
+ * An object is known to have changed if its CRC differs from the one of the data
+ * last saved or loaded, otherwise it still gets compared against the saved version.
+ */
+static bool nextObjectToSave(void *context, UAVObjHandle *obj_handle, uint16_t *instId, bool *changed)
+{
+    struct SaveAllContext *ctx = (struct SaveAllContext *)context;
+
+    while (ctx->slot && ctx->slot < __stop__uavo_handles) {
+        struct UAVOData *obj = *ctx->slot++;
+        if (obj == NULL) {
+            continue;
+        }
+        if (!ctx->metaobjects && !UAVObjIsSettings(obj)) {
+            continue;
+        }
+
+        struct UAVOBase *base = ctx->metaobjects ? (struct UAVOBase *)MetaObjectPtr(obj) : &obj->base;
+        uint8_t crc = UAVObjUpdateCRC((UAVObjHandle)base, 0, 0);
+
+        *obj_handle    = (UAVObjHandle)base;
+        *instId        = 0;
+        *changed       = (crc != base->savedCRC);
+        base->savedCRC = crc;
+        return true;
+    }
+
+    return false;
+}
+
 /**
  * Save all settings objects to the SD card.
+ * Unchanged objects are skipped and all others are written in one go.
  * @return 0 if success or -1 if failure
  */
 int32_t UAVObjSaveSettings()
 {
+    struct SaveAllContext ctx = {
+        .slot        = __start__uavo_handles,
+        .metaobjects = false,
+    };
+
     // Get lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
-    int32_t rc = -1;
-
-    // Save all settings objects
-    UAVO_LIST_ITERATE(obj)
-    // Check if this is a settings object
-    if (UAVObjIsSettings(obj)) {
-        // Save object
-        if (UAVObjSave((UAVObjHandle)obj, 0) ==
-            -1) {
-            goto unlock_exit;
-        }
-    }
-}
-
-rc = 0;
+    int32_t rc = UAVObjSaveMultiple(&nextObjectToSave, &ctx);
 
-unlock_exit:
-xSemaphoreGiveRecursive(mutex);
-return rc;
+    xSemaphoreGiveRecursive(mutex);
+    return rc;
 }
 
 /**
@@ -758,29 +873,23 @@ return rc;
 
 /**
  * Save all metaobjects to the SD card.
+ * Unchanged objects are skipped and all others are written in one go.
  * @return 0 if success or -1 if failure
  */
 int32_t UAVObjSaveMetaobjects()
 {
+    struct SaveAllContext ctx = {
+        .slot        = __start__uavo_handles,
+        .metaobjects = true,
+    };
+
     // Get lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
-    int32_t rc = -1;
+    int32_t rc = UAVObjSaveMultiple(&nextObjectToSave, &ctx);
 
-    // Save all settings objects
-    UAVO_LIST_ITERATE(obj)
-    // Save object
-    if (UAVObjSave((UAVObjHandle)MetaObjectPtr(obj), 0) ==
-        -1) {
-        goto unlock_exit;
-    }
-}
-
-rc = 0;
-
-unlock_exit:
-xSemaphoreGiveRecursive(mutex);
-return rc;
+    xSemaphoreGiveRecursive(mutex);
+    return rc;
 }
 
 /**
@@ -894,7 +1003,7 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockTracked();
 
     int32_t rc = -1;
 
@@ -902,7 +1011,9 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
         if (instId != 0) {
             goto unlock_exit;
         }
+        beginInstanceWrite((struct UAVOBase *)obj_handle);
         memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+        endInstanceWrite((struct UAVOBase *)obj_handle);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -920,7 +1031,9 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
             goto unlock_exit;
         }
         // Set data
+        beginInstanceWrite(&obj->base);
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        endInstanceWrite(&obj->base);
     }
 
     // Fire event
@@ -944,7 +1057,7 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    lockTracked();
 
     int32_t rc = -1;
 
@@ -960,7 +1073,9 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
         }
 
         // Set data
+        beginInstanceWrite((struct UAVOBase *)obj_handle);
         memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
+        endInstanceWrite((struct UAVOBase *)obj_handle);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -985,7 +1100,9 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
         }
 
         // Set data
+        beginInstanceWrite(&obj->base);
         memcpy(InstanceData(instEntry) + offset, dataIn, size);
+        endInstanceWrite(&obj->base);
     }
 
 
@@ -1010,18 +1127,13 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
-
     if (UAVObjIsMetaobject(obj_handle)) {
         // Get instance information
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
         // Set data
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+        readInstanceData((struct UAVOBase *)obj_handle, dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -1032,17 +1144,13 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
         // Get instance information
         instEntry = getInstance(obj, instId);
         if (instEntry == NULL) {
-            goto unlock_exit;
+            return -1;
         }
         // Set data
-        memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
+        readInstanceData(&obj->base, dataOut, InstanceData(instEntry), obj->instance_size);
     }
 
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return 0;
 }
 
 /**
@@ -1056,24 +1164,19 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
-
     if (UAVObjIsMetaobject(obj_handle)) {
         // Get instance information
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Check for overrun
         if ((size + offset) > MetaNumBytes) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Set data
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
+        readInstanceData((struct UAVOBase *)obj_handle, dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -1084,23 +1187,19 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
         // Get instance information
         instEntry = getInstance(obj, instId);
         if (instEntry == NULL) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Check for overrun
         if ((size + offset) > obj->instance_size) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Set data
-        memcpy(dataOut, InstanceData(instEntry) + offset, size);
+        readInstanceData(&obj->base, dataOut, InstanceData(instEntry) + offset, size);
     }
 
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return 0;
 }
 
 /**
@@ -1136,9 +1235,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
     // Get metadata
     if (UAVObjIsMetaobject(obj_handle)) {
         memcpy(dataOut, &defMetadata, sizeof(UAVObjMetadata));
@@ -1147,8 +1243,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
                       dataOut);
     }
 
-    // Unlock
-    xSemaphoreGiveRecursive(mutex);
     return 0;
 }
 
@@ -1544,6 +1638,75 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
     return 0;
 }
 
+/**
+ * Take the lock, keeping track of the time spent waiting for it.
+ */
+static void lockTracked(void)
+{
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+    if (counterLockWait) {
+        uint32_t start = PIOS_DELAY_GetRaw();
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        PERF_TRACK_VALUE(counterLockWait, PIOS_DELAY_DiffuS(start));
+        return;
+    }
+#endif
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+}
+
+/**
+ * Mark the start of a write to the instance data of an object.
+ * The lock is held until the matching endInstanceWrite().
+ * While the sequence counter is odd, lock-free readers wait on the lock.
+ */
+void beginInstanceWrite(struct UAVOBase *obj)
+{
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    InstanceSeq(obj)++;
+    __sync_synchronize();
+}
+
+/**
+ * Mark the end of a write to the instance data of an object.
+ */
+void endInstanceWrite(struct UAVOBase *obj)
+{
+    __sync_synchronize();
+    InstanceSeq(obj)++;
+    xSemaphoreGiveRecursive(mutex);
+}
+
+/**
+ * Copy instance data without taking the lock. The copy is retried if a writer
+ * modified the object meanwhile, and done under the lock if a write is in
+ * progress or the retries are exhausted.
+ */
+static void readInstanceData(struct UAVOBase *obj, void *dataOut, const void *dataIn, uint32_t size)
+{
+    for (uint8_t retry = 0; retry < LOCKFREE_READ_RETRIES; ++retry) {
+        uint16_t seq = InstanceSeq(obj);
+        if (seq & 1) {
+            // A writer holds the lock, wait for it below
+            break;
+        }
+        __sync_synchronize();
+        memcpy(dataOut, dataIn, size);
+        __sync_synchronize();
+        if (InstanceSeq(obj) == seq) {
+            return;
+        }
+    }
+
+    lockTracked();
+    memcpy(dataOut, dataIn, size);
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+    if (counterLockedReads) {
+        PERF_TRACK_VALUE(counterLockedReads, ++lockedReads);
+    }
+#endif
+    xSemaphoreGiveRecursive(mutex);
+}
+
 /**
  * Create a new object instance, return the instance info or NULL if failure.
  */
@@ -1583,6 +1746,8 @@ static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
     memset(instEntry, 0, size);
     LL_APPEND(((struct UAVOMulti *)obj)->instance0.next, instEntry);
 
+    // Lock-free readers check num_instances before walking the list
+    __sync_synchronize();
     ((struct UAVOMulti *)obj)->num_instances++;
 
     // Fire event
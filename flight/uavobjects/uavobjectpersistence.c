@@ -27,44 +27,140 @@
 #include "openpilot.h"
 #include "pios_struct_helper.h"
 #include "inc/uavobjectprivate.h"
+#include <uavobjectsinit.h>
 
 extern uintptr_t pios_uavo_settings_fs_id;
 
+// Objects are read from flash into this buffer, the instance data is only written for the copy
+static uint8_t loadBuffer[UAVOBJECTS_LARGEST];
+static xSemaphoreHandle loadLock;
+
+struct SaveMultipleContext {
+    UAVObjSaveIterator next;
+    void *context;
+};
+
 /**
- * Save the data of the specified object to the file system (SD card).
- * If the object contains multiple instances, all of them will be saved.
- * A new file with the name of the object will be created.
- * The object data can be restored using the UAVObjLoad function.
- * @param[in] obj The object handle.
- * @param[in] instId The instance ID
+ * Initialize the object persistence, called by UAVObjInitialize()
  * @return 0 if success or -1 if failure
  */
-int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId)
+int32_t UAVObjPersistenceInitialize()
 {
-    PIOS_Assert(obj_handle);
+    loadLock = xSemaphoreCreateMutex();
+    if (loadLock == NULL) {
+        return -1;
+    }
+    return 0;
+}
 
+/**
+ * Get the data of an object instance as it is stored in the file system
+ * @param[in] obj The object handle.
+ * @param[in] instId The instance ID
+ * @return pointer to the data or NULL if the instance does not exist
+ */
+static uint8_t *persistentData(UAVObjHandle obj_handle, uint16_t instId)
+{
     if (UAVObjIsMetaobject(obj_handle)) {
         if (instId != 0) {
-            return -1;
+            return NULL;
         }
 
-        if (PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle), UAVObjGetNumBytes(obj_handle)) != 0) {
-            return -1;
-        }
+        return (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle);
     } else {
         InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
 
         if (instEntry == NULL) {
-            return -1;
+            return NULL;
         }
 
-        if (InstanceData(instEntry) == NULL) {
-            return -1;
-        }
+        return InstanceData(instEntry);
+    }
+}
+
+/**
+ * Remember the CRC of the data last saved to or loaded from the file system
+ * @param[in] obj The object handle.
+ * @param[in] instId The instance ID
+ */
+static void updateSavedCRC(UAVObjHandle obj_handle, uint16_t instId)
+{
+    if (instId == 0) {
+        ((struct UAVOBase *)obj_handle)->savedCRC = UAVObjUpdateCRC(obj_handle, instId, 0);
+    }
+}
 
-        if (PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle)) != 0) {
-            return -1;
+/**
+ * Iterator for PIOS_FLASHFS_ObjSaveBatch() on top of a UAVObjSaveIterator
+ */
+static bool nextPersistentObject(void *context, struct PIOS_FLASHFS_Obj *fs_obj)
+{
+    struct SaveMultipleContext *ctx = (struct SaveMultipleContext *)context;
+    UAVObjHandle obj_handle;
+    uint16_t instId;
+    bool changed;
+
+    while (ctx->next(ctx->context, &obj_handle, &instId, &changed)) {
+        uint8_t *data = persistentData(obj_handle, instId);
+        if (data == NULL) {
+            continue;
         }
+
+        fs_obj->obj_id      = UAVObjGetID(obj_handle);
+        fs_obj->obj_inst_id = instId;
+        fs_obj->obj_size    = UAVObjGetNumBytes(obj_handle);
+        fs_obj->obj_data    = data;
+        fs_obj->changed     = changed;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Save the data of the specified object to the file system (SD card).
+ * If the object contains multiple instances, all of them will be saved.
+ * A new file with the name of the object will be created.
+ * The object data can be restored using the UAVObjLoad function.
+ * @param[in] obj The object handle.
+ * @param[in] instId The instance ID
+ * @return 0 if success or -1 if failure
+ */
+int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId)
+{
+    PIOS_Assert(obj_handle);
+
+    uint8_t *data = persistentData(obj_handle, instId);
+
+    if (data == NULL) {
+        return -1;
+    }
+
+    if (PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, data, UAVObjGetNumBytes(obj_handle)) != 0) {
+        return -1;
+    }
+
+    updateSavedCRC(obj_handle, instId);
+    return 0;
+}
+
+/**
+ * Save the object instances handed out by an iterator in a single file system transaction.
+ * Instances the iterator does not flag as changed are compared with their saved
+ * version first and only written if they differ.
+ * @param[in] next The iterator
+ * @param[in] context Context passed to the iterator
+ * @return 0 if success or -1 if failure
+ */
+int32_t UAVObjSaveMultiple(UAVObjSaveIterator next, void *context)
+{
+    struct SaveMultipleContext ctx = {
+        .next    = next,
+        .context = context,
+    };
+
+    if (PIOS_FLASHFS_ObjSaveBatch(pios_uavo_settings_fs_id, &nextPersistentObject, &ctx) != 0) {
+        return -1;
     }
     return 0;
 }
@@ -82,32 +178,30 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
 
-    if (UAVObjIsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            return -1;
-        }
+    uint8_t *data     = persistentData(obj_handle, instId);
+    uint16_t numBytes = UAVObjGetNumBytes(obj_handle);
 
-        // Fire event on success
-        if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle), UAVObjGetNumBytes(obj_handle)) == 0) {
-            sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
-        } else {
-            return -1;
-        }
-    } else {
-        InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
-
-        if (instEntry == NULL) {
-            return -1;
-        }
-
-        // Fire event on success
-        if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle)) == 0) {
-            sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
-        } else {
-            return -1;
-        }
+    if (data == NULL) {
+        return -1;
     }
+    PIOS_Assert(numBytes <= sizeof(loadBuffer));
+
+    // Read outside of the object lock, writers and readers of other objects must not wait for the flash
+    xSemaphoreTake(loadLock, portMAX_DELAY);
+    int32_t rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, loadBuffer, numBytes);
+    if (rc == 0) {
+        beginInstanceWrite((struct UAVOBase *)obj_handle);
+        memcpy(data, loadBuffer, numBytes);
+        endInstanceWrite((struct UAVOBase *)obj_handle);
+    }
+    xSemaphoreGive(loadLock);
 
+    // Fire event on success
+    if (rc != 0) {
+        return -1;
+    }
+    updateSavedCRC(obj_handle, instId);
+    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
 
     return 0;
 }
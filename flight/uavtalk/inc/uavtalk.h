@@ -46,8 +46,20 @@ typedef struct {
     uint32_t rxCrcErrors;
 } UAVTalkStats;
 
+// State of the acked transactions window
+typedef struct {
+    uint8_t  inFlight; // transactions waiting for a response
+    uint8_t  maxInFlight; // most transactions in flight at once since the last call
+    uint16_t rttMs; // smoothed round trip time
+    uint16_t rtoMs; // current retransmit timeout
+} UAVTalkLinkStats;
+
 typedef void *UAVTalkConnection;
 
+// Optional protocol features, enabled once the other end has announced support for them
+#define UAVTALK_FEATURE_MULTI_OBJECT 0x01
+#define UAVTALK_FEATURE_DELTA        0x02
+
 typedef enum { UAVTALK_STATE_ERROR = 0, UAVTALK_STATE_SYNC, UAVTALK_STATE_TYPE, UAVTALK_STATE_SIZE, UAVTALK_STATE_OBJID, UAVTALK_STATE_INSTID, UAVTALK_STATE_TIMESTAMP, UAVTALK_STATE_DATA, UAVTALK_STATE_CS, UAVTALK_STATE_COMPLETE } UAVTalkRxState;
 
 // Public functions
@@ -56,7 +68,12 @@ int32_t UAVTalkSetOutputStream(UAVTalkConnection connection, UAVTalkOutputStream
 UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connection);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
+int32_t UAVTalkSendObjects(UAVTalkConnection connection, const UAVObjHandle *objs, const uint16_t *instIds, uint8_t count);
 int32_t UAVTalkSendObjectRequest(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs);
+int32_t UAVTalkStartTransaction(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, bool request);
+int32_t UAVTalkProcessTransactions(UAVTalkConnection connection, uint8_t maxRetries, uint32_t *retries);
+int32_t UAVTalkWaitTransactionSlot(UAVTalkConnection connection);
+void UAVTalkGetLinkStats(UAVTalkConnection connection, UAVTalkLinkStats *stats);
 UAVTalkRxState UAVTalkProcessInputStream(UAVTalkConnection connection, uint8_t rxbyte);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connection, uint8_t rxbyte);
 int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle);
@@ -64,6 +81,7 @@ int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
 void UAVTalkAddStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
 void UAVTalkResetStats(UAVTalkConnection connection);
+void UAVTalkSetFeatures(UAVTalkConnection connection, uint8_t features);
 void UAVTalkGetLastTimestamp(UAVTalkConnection connection, uint16_t *timestamp);
 uint32_t UAVTalkGetPacketObjId(UAVTalkConnection connection);
 
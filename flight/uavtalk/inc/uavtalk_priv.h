@@ -46,6 +46,36 @@
 #define UAVTALK_MIN_PACKET_LENGTH  UAVTALK_MAX_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH
 #define UAVTALK_MAX_PACKET_LENGTH  UAVTALK_MIN_PACKET_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH
 
+// multi object entry : object ID(4), instance ID(2), followed by the object data
+#define UAVTALK_MULTI_ENTRY_HEADER_LENGTH 6
+
+// multi object frames must stay below the GCS payload limit of 256 bytes
+#define UAVTALK_MULTI_MAX_PAYLOAD_LENGTH  ((UAVTALK_MAX_PAYLOAD_LENGTH - 1) < 255 ? (UAVTALK_MAX_PAYLOAD_LENGTH - 1) : 255)
+
+// delta payload : base image CRC32 (little endian), changed block bitmap, changed blocks
+#define UAVTALK_DELTA_CHECK_LENGTH        4
+#define UAVTALK_DELTA_BLOCK_LENGTH        4
+#define UAVTALK_DELTA_MAX_BITMAP_LENGTH   ((UAVTALK_MAX_PAYLOAD_LENGTH + 8 * UAVTALK_DELTA_BLOCK_LENGTH - 1) / (8 * UAVTALK_DELTA_BLOCK_LENGTH))
+// only objects at least this large are delta encoded
+#define UAVTALK_DELTA_MIN_LENGTH          32
+// a full image is resent after this many updates, or when the receiver NACKs a delta
+#define UAVTALK_DELTA_KEYFRAME_INTERVAL   16
+#ifndef UAVTALK_DELTA_SLOTS
+#define UAVTALK_DELTA_SLOTS               8
+#endif
+
+// acked transactions that can be in flight at the same time
+#ifndef UAVTALK_MAX_PENDING
+#define UAVTALK_MAX_PENDING               4
+#endif
+// bounds of the retransmit timeout, in between it follows the measured round trip time
+#define UAVTALK_RTO_INITIAL_MS            250
+#define UAVTALK_RTO_MIN_MS                100
+#define UAVTALK_RTO_MAX_MS                2000
+
+// the transmit buffer leaves room to build a delta payload in place
+#define UAVTALK_TX_BUFFER_LENGTH          (UAVTALK_MAX_PACKET_LENGTH + UAVTALK_DELTA_CHECK_LENGTH + UAVTALK_DELTA_MAX_BITMAP_LENGTH)
+
 typedef struct {
     uint8_t  type;
     uint16_t packet_size;
@@ -60,19 +90,49 @@ typedef struct {
     uint16_t rxPacketLength;
 } UAVTalkInputProcessor;
 
+typedef struct {
+    UAVObjHandle obj;
+    uint16_t     instId;
+    uint16_t     capacity; // size of the base buffer, it is never reallocated
+    uint32_t     baseCrc;
+    uint8_t      sendCount; // zero when the next update has to be a full image
+    uint32_t     lastUsed;
+    uint8_t      *base;
+} UAVTalkDeltaSlot;
+
+// An acked object or object request waiting for its response. There is at most one
+// per object instance, so the object and instance ID of the response identify it.
+typedef struct {
+    UAVObjHandle obj; // NULL when the entry is free
+    uint16_t     instId;
+    uint8_t      type;
+    uint8_t      retries;
+    bool resend; // object changed or widened while in flight, send it again once answered
+    bool nacked;
+    uint32_t     sentTime;
+} UAVTalkPendingTransaction;
+
 typedef struct {
     uint8_t canari;
     UAVTalkOutputStream outStream;
     xSemaphoreHandle    lock;
     xSemaphoreHandle    transLock;
     xSemaphoreHandle    respSema;
+    xSemaphoreHandle    windowSema; // given when a windowed transaction is answered or freed
     uint8_t      respType;
     uint32_t     respObjId;
     uint16_t     respInstId;
     UAVTalkStats stats;
+    uint8_t      features;
     UAVTalkInputProcessor iproc;
     uint8_t      *rxBuffer;
     uint8_t      *txBuffer;
+    UAVTalkDeltaSlot deltaSlots[UAVTALK_DELTA_SLOTS];
+    uint32_t     deltaClock; // use counter for the least recently used slot
+    UAVTalkPendingTransaction pending[UAVTALK_MAX_PENDING];
+    uint8_t      maxPending; // deepest the window got since the last stats read
+    uint16_t     rttMs; // smoothed round trip time, zero until measured
+    uint16_t     rttVarMs; // mean deviation of the round trip time
 } UAVTalkConnectionData;
 
 #define UAVTALK_CANARI          0xCA
@@ -86,6 +146,8 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK    (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK        (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK       (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_OBJ_MULTI  (UAVTALK_TYPE_VER | 0x05)
+#define UAVTALK_TYPE_OBJ_DELTA  (UAVTALK_TYPE_VER | 0x06)
 #define UAVTALK_TYPE_OBJ_TS     (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
@@ -51,8 +51,18 @@
 static int32_t objectTransaction(UAVTalkConnectionData *connection, uint8_t type, UAVObjHandle obj, uint16_t instId, int32_t timeout);
 static int32_t sendObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
+static int32_t sendMultiObject(UAVTalkConnectionData *connection, const UAVObjHandle *objs, const uint16_t *instIds, uint8_t count);
+static bool isDeltaCandidate(UAVObjHandle obj, int32_t length);
+static int32_t packDeltaObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, int32_t length, UAVTalkDeltaSlot **slotOut);
+static void commitDeltaSlot(UAVTalkConnectionData *connection, UAVTalkDeltaSlot *slot, int32_t length, bool sent);
+static void forceDeltaKeyframe(UAVTalkConnectionData *connection, UAVObjHandle obj);
+static UAVTalkDeltaSlot *getDeltaSlot(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, int32_t length);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data);
+static int32_t receiveMultiObject(UAVTalkConnectionData *connection, uint16_t count, uint8_t *data, uint32_t length);
 static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId);
+static UAVTalkPendingTransaction *findPending(UAVTalkConnectionData *connection, uint8_t respType, uint32_t objId, uint16_t instId);
+static void updateRoundTripTime(UAVTalkConnectionData *connection, uint32_t sampleMs);
+static uint32_t getRetransmitTimeout(UAVTalkConnectionData *connection);
 
 /**
  * Initialize the UAVTalk library
@@ -70,6 +80,13 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
         return 0;
     }
     connection->canari      = UAVTALK_CANARI;
+    connection->features    = 0;
+    memset(connection->deltaSlots, 0, sizeof(connection->deltaSlots));
+    connection->deltaClock  = 0;
+    memset(connection->pending, 0, sizeof(connection->pending));
+    connection->maxPending  = 0;
+    connection->rttMs       = 0;
+    connection->rttVarMs    = 0;
     connection->iproc.rxPacketLength = 0;
     connection->iproc.state = UAVTALK_STATE_SYNC;
     connection->outStream   = outputStream;
@@ -80,12 +97,14 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     if (!connection->rxBuffer) {
         return 0;
     }
-    connection->txBuffer = pios_malloc(UAVTALK_MAX_PACKET_LENGTH);
+    connection->txBuffer = pios_malloc(UAVTALK_TX_BUFFER_LENGTH);
     if (!connection->txBuffer) {
         return 0;
     }
     vSemaphoreCreateBinary(connection->respSema);
     xSemaphoreTake(connection->respSema, 0); // reset to zero
+    vSemaphoreCreateBinary(connection->windowSema);
+    xSemaphoreTake(connection->windowSema, 0); // reset to zero
     UAVTalkResetStats((UAVTalkConnection)connection);
     return (UAVTalkConnection)connection;
 }
@@ -209,6 +228,32 @@ void UAVTalkResetStats(UAVTalkConnection connectionHandle)
     xSemaphoreGiveRecursive(connection->lock);
 }
 
+/**
+ * Set the optional protocol features the other end has announced support for.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] features Bitmask of UAVTALK_FEATURE_* flags
+ */
+void UAVTalkSetFeatures(UAVTalkConnection connectionHandle, uint8_t features)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+
+    // Lock
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    if (connection->features != features) {
+        // The receiver starts over, the next delta encoded update of each object has to be a full one
+        for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; ++n) {
+            connection->deltaSlots[n].sendCount = 0;
+        }
+        connection->features = features;
+    }
+
+    // Release lock
+    xSemaphoreGiveRecursive(connection->lock);
+}
+
 /**
  * Accessor method to get the timestamp from the last UAVTalk message
  */
@@ -289,6 +334,46 @@ int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjH
     }
 }
 
+/**
+ * Send several object instances through the telemetry link without acks.
+ * If the other end supports it (UAVTALK_FEATURE_MULTI_OBJECT) consecutive objects are
+ * packed into UAVTALK_TYPE_OBJ_MULTI frames sharing a single header and checksum,
+ * otherwise each object is sent in its own UAVTALK_TYPE_OBJ frame.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objs Objects to send
+ * \param[in] instIds The instance ID of each object (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] count Number of objects
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjects(UAVTalkConnection connectionHandle, const UAVObjHandle *objs, const uint16_t *instIds, uint8_t count)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret = 0;
+    int32_t sent;
+    uint8_t n   = 0;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    while (n < count) {
+        if (connection->features & UAVTALK_FEATURE_MULTI_OBJECT) {
+            sent = sendMultiObject(connection, &objs[n], &instIds[n], count - n);
+        } else {
+            sent = (sendSingleObject(connection, UAVTALK_TYPE_OBJ, UAVObjGetID(objs[n]), instIds[n], objs[n]) == 0) ? 1 : -1;
+        }
+        if (sent == -1) {
+            // skip the failed object, keep going with the others
+            ret  = -1;
+            sent = 1;
+        }
+        n += sent;
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
 /**
  * Execute the requested transaction on an object.
  * \param[in] connection UAVTalkConnection to be used
@@ -347,6 +432,188 @@ static int32_t objectTransaction(UAVTalkConnectionData *connection, uint8_t type
     return ret;
 }
 
+/**
+ * Send an object with an ack, or an object request, without waiting for the response.
+ * Several such transactions can be in flight at once, UAVTalkProcessTransactions()
+ * retransmits them on timeout. If the object instance is already in flight it is sent
+ * again once the pending transaction completes, so the last update is the one acked.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send or request
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] request Request an object update instead of sending the object
+ * \return 0 Success
+ * \return -1 Failure
+ * \return -2 Too many transactions in flight, UAVTalkWaitTransactionSlot() waits for room
+ */
+int32_t UAVTalkStartTransaction(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, bool request)
+{
+    UAVTalkConnectionData *connection;
+    UAVTalkPendingTransaction *pending;
+    uint8_t type     = request ? UAVTALK_TYPE_OBJ_REQ : UAVTALK_TYPE_OBJ_ACK;
+    uint8_t inFlight = 0;
+    int32_t ret;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    // all instances of a single instance object is instance 0, keep one transaction for both
+    if (instId == UAVOBJ_ALL_INSTANCES && UAVObjIsSingleInstance(obj)) {
+        instId = 0;
+    }
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    // a transaction for all instances completes with instance 0, so both share the lookup
+    pending = findPending(connection, request ? UAVTALK_TYPE_OBJ : UAVTALK_TYPE_ACK, UAVObjGetID(obj),
+                          (instId == UAVOBJ_ALL_INSTANCES) ? 0 : instId);
+    if (pending) {
+        if (pending->instId != instId && instId == UAVOBJ_ALL_INSTANCES) {
+            // instance 0 is in flight, widen it to all instances once it completes
+            pending->instId = UAVOBJ_ALL_INSTANCES;
+            pending->resend = true;
+        } else if (!request) {
+            // the same object is waiting for its response, an update follows once it arrives
+            pending->resend = true;
+        }
+        xSemaphoreGiveRecursive(connection->lock);
+        return 0;
+    }
+
+    pending = NULL;
+    for (uint8_t n = 0; n < UAVTALK_MAX_PENDING; ++n) {
+        if (connection->pending[n].obj == NULL) {
+            if (!pending) {
+                pending = &connection->pending[n];
+            }
+        } else {
+            ++inFlight;
+        }
+    }
+    if (!pending) {
+        xSemaphoreGiveRecursive(connection->lock);
+        return -2;
+    }
+
+    ret = sendObject(connection, type, UAVObjGetID(obj), instId, obj);
+    if (ret == 0) {
+        pending->obj      = obj;
+        pending->instId   = instId;
+        pending->type     = type;
+        pending->retries  = 0;
+        pending->resend   = false;
+        pending->nacked   = false;
+        pending->sentTime = xTaskGetTickCount() * portTICK_RATE_MS;
+        if (inFlight + 1 > connection->maxPending) {
+            connection->maxPending = inFlight + 1;
+        }
+    }
+
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Retransmit the transactions whose response did not arrive within the retransmit
+ * timeout, and give up on the ones that were nacked or ran out of retries. A failed
+ * transaction whose object changed meanwhile is restarted with the newer value.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] maxRetries Retransmissions before a transaction fails
+ * \param[out] retries Number of retransmissions done (may be NULL)
+ * \return Number of failed transactions
+ */
+int32_t UAVTalkProcessTransactions(UAVTalkConnection connectionHandle, uint8_t maxRetries, uint32_t *retries)
+{
+    UAVTalkConnectionData *connection;
+    int32_t failed   = 0;
+    uint32_t resent  = 0;
+    uint32_t timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+
+    CHECKCONHANDLE(connectionHandle, connection, return 0);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    uint32_t timeout = getRetransmitTimeout(connection);
+    for (uint8_t n = 0; n < UAVTALK_MAX_PENDING; ++n) {
+        UAVTalkPendingTransaction *pending = &connection->pending[n];
+        if (pending->obj == NULL || (!pending->nacked && (timeNow - pending->sentTime) < timeout)) {
+            continue;
+        }
+        if (!pending->nacked && pending->retries < maxRetries
+            && sendObject(connection, pending->type, UAVObjGetID(pending->obj), pending->instId, pending->obj) == 0) {
+            ++pending->retries;
+            ++resent;
+            pending->sentTime = timeNow;
+        } else {
+            ++failed;
+            if (pending->resend && sendObject(connection, pending->type, UAVObjGetID(pending->obj), pending->instId, pending->obj) == 0) {
+                // the newer value must not be lost with the failed one, it gets its own retries
+                pending->retries  = 0;
+                pending->resend   = false;
+                pending->nacked   = false;
+                pending->sentTime = timeNow;
+            } else {
+                pending->obj = NULL;
+                xSemaphoreGive(connection->windowSema);
+            }
+        }
+    }
+
+    xSemaphoreGiveRecursive(connection->lock);
+
+    if (retries) {
+        *retries = resent;
+    }
+    return failed;
+}
+
+/**
+ * Block until a windowed transaction gets answered, or until the retransmit timeout
+ * elapsed and UAVTalkProcessTransactions() has to free up the window.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 A transaction was answered
+ * \return -1 Timeout
+ */
+int32_t UAVTalkWaitTransactionSlot(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+    uint32_t timeoutMs;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    timeoutMs = getRetransmitTimeout(connection);
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return (xSemaphoreTake(connection->windowSema, timeoutMs / portTICK_RATE_MS) == pdTRUE) ? 0 : -1;
+}
+
+/**
+ * Get the state of the acked transactions window, the in flight maximum is reset.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[out] stats Window state
+ */
+void UAVTalkGetLinkStats(UAVTalkConnection connectionHandle, UAVTalkLinkStats *stats)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    stats->inFlight = 0;
+    for (uint8_t n = 0; n < UAVTALK_MAX_PENDING; ++n) {
+        if (connection->pending[n].obj) {
+            ++stats->inFlight;
+        }
+    }
+    stats->maxInFlight     = connection->maxPending;
+    stats->rttMs           = connection->rttMs;
+    stats->rtoMs           = getRetransmitTimeout(connection);
+    connection->maxPending = stats->inFlight;
+
+    xSemaphoreGiveRecursive(connection->lock);
+}
+
 /**
  * Process an byte from the telemetry stream.
  * \param[in] connectionHandle UAVTalkConnection to be used
@@ -466,7 +733,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
             iproc->timestampLength = 0;
         } else {
             iproc->timestampLength = (iproc->type & UAVTALK_TIMESTAMPED) ? 2 : 0;
-            if (obj) {
+            if (obj && (iproc->type & ~UAVTALK_TIMESTAMPED) != UAVTALK_TYPE_OBJ_MULTI && (iproc->type & ~UAVTALK_TIMESTAMPED) != UAVTALK_TYPE_OBJ_DELTA) {
                 iproc->length = UAVObjGetNumBytes(obj);
             } else {
                 iproc->length = iproc->packet_size - iproc->rxPacketLength - iproc->timestampLength;
@@ -795,6 +1062,8 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         if (obj) {
             // Object found, transmit it
             // The sent object will ack the object request on the receiver side
+            // A request is always answered with a full image, never with a delta
+            forceDeltaKeyframe(connection, obj);
             ret = sendObject(connection, UAVTALK_TYPE_OBJ, objId, instId, obj);
         } else {
             ret = -1;
@@ -806,8 +1075,27 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         }
         break;
 
+    case UAVTALK_TYPE_OBJ_MULTI:
+        // The instance ID field holds the number of packed objects
+        ret = receiveMultiObject(connection, instId, data, connection->iproc.length);
+        break;
+
     case UAVTALK_TYPE_NACK:
-        // Do nothing on flight side, let it time out.
+    {
+        // A windowed transaction fails right away
+        UAVTalkPendingTransaction *pending = findPending(connection, UAVTALK_TYPE_ACK, objId, instId);
+        if (!pending) {
+            pending = findPending(connection, UAVTALK_TYPE_OBJ, objId, instId);
+        }
+        if (pending) {
+            pending->nacked = true;
+            xSemaphoreGive(connection->windowSema);
+        }
+        // The receiver rejects a delta it has no matching base for, resend a full image
+        if (obj) {
+            forceDeltaKeyframe(connection, obj);
+        }
+        // Do nothing for a blocking transaction on flight side, let it time out.
         // TODO:
         // The transaction takes the result code of the "semaphore taking operation" into account to determine success.
         // If we give that semaphore in time, its "success" (ack received)
@@ -816,6 +1104,7 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         // that indicates failure and then above where it checks for the result code, have it behave as if it failed
         // if the explicit failure is set.
         break;
+    }
 
     case UAVTALK_TYPE_ACK:
         // All instances not allowed for ACK messages
@@ -838,6 +1127,42 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
     return ret;
 }
 
+/**
+ * Unpack the objects of a UAVTALK_TYPE_OBJ_MULTI message.
+ * Each entry is the object ID, the instance ID and the object data. As the entries do
+ * not carry their own length, unpacking stops at the first unknown object.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] count Number of packed objects
+ * \param[in] data Data buffer
+ * \param[in] length Buffer length
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveMultiObject(UAVTalkConnectionData *connection, uint16_t count, uint8_t *data, uint32_t length)
+{
+    uint32_t pos = 0;
+
+    for (uint16_t n = 0; n < count; ++n) {
+        if (pos + UAVTALK_MULTI_ENTRY_HEADER_LENGTH > length) {
+            return -1;
+        }
+        uint32_t objId  = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24);
+        uint16_t instId = data[pos + 4] | (data[pos + 5] << 8);
+        pos += UAVTALK_MULTI_ENTRY_HEADER_LENGTH;
+
+        UAVObjHandle obj = UAVObjGetByID(objId);
+        if (!obj || instId == UAVOBJ_ALL_INSTANCES || pos + UAVObjGetNumBytes(obj) > length) {
+            return -1;
+        }
+        if (UAVObjUnpack(obj, instId, &data[pos]) == 0) {
+            updateAck(connection, UAVTALK_TYPE_OBJ, objId, instId);
+        }
+        pos += UAVObjGetNumBytes(obj);
+    }
+
+    return (pos == length) ? 0 : -1;
+}
+
 /**
  * Check if an ack is pending on an object and give response semaphore
  * \param[in] connection UAVTalkConnection to be used
@@ -846,6 +1171,8 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
  */
 static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId)
 {
+    UAVTalkPendingTransaction *pending;
+
     if ((connection->respObjId == objId) && (connection->respType == type)) {
         if ((connection->respInstId == UAVOBJ_ALL_INSTANCES) && (instId == 0)) {
             // last instance received, complete transaction
@@ -856,6 +1183,94 @@ static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t
             connection->respObjId = 0;
         }
     }
+
+    pending = findPending(connection, type, objId, instId);
+    if (pending) {
+        uint32_t timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+        // a retransmitted transaction does not tell which copy got answered, do not sample it
+        if (pending->retries == 0) {
+            updateRoundTripTime(connection, timeNow - pending->sentTime);
+        }
+        if (pending->resend && sendObject(connection, pending->type, objId, pending->instId, pending->obj) == 0) {
+            // the object changed meanwhile, the follow up update takes over the entry
+            pending->retries  = 0;
+            pending->resend   = false;
+            pending->sentTime = timeNow;
+        } else {
+            pending->obj = NULL;
+        }
+        xSemaphoreGive(connection->windowSema);
+    }
+}
+
+/**
+ * Find the windowed transaction a response belongs to.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] respType Type of the response
+ * \param[in] objId The object ID of the response
+ * \param[in] instId The instance ID of the response
+ * \return The pending transaction or NULL
+ */
+static UAVTalkPendingTransaction *findPending(UAVTalkConnectionData *connection, uint8_t respType, uint32_t objId, uint16_t instId)
+{
+    for (uint8_t n = 0; n < UAVTALK_MAX_PENDING; ++n) {
+        UAVTalkPendingTransaction *pending = &connection->pending[n];
+        if (pending->obj == NULL || UAVObjGetID(pending->obj) != objId) {
+            continue;
+        }
+        if (((pending->type == UAVTALK_TYPE_OBJ_REQ) ? UAVTALK_TYPE_OBJ : UAVTALK_TYPE_ACK) != respType) {
+            continue;
+        }
+        // all instances are sent in reverse order, the transaction completes with instance 0
+        if (pending->instId == instId || (pending->instId == UAVOBJ_ALL_INSTANCES && instId == 0)) {
+            return pending;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Feed a round trip time sample into the smoothed estimate and its deviation.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] sampleMs Measured round trip time
+ */
+static void updateRoundTripTime(UAVTalkConnectionData *connection, uint32_t sampleMs)
+{
+    if (sampleMs > UAVTALK_RTO_MAX_MS) {
+        sampleMs = UAVTALK_RTO_MAX_MS;
+    }
+    if (connection->rttMs == 0) {
+        connection->rttMs    = sampleMs > 0 ? sampleMs : 1;
+        connection->rttVarMs = sampleMs / 2;
+    } else {
+        int32_t error = (int32_t)sampleMs - connection->rttMs;
+        connection->rttMs    += error / 8;
+        connection->rttVarMs += ((error < 0 ? -error : error) - connection->rttVarMs) / 4;
+        if (connection->rttMs == 0) {
+            connection->rttMs = 1;
+        }
+    }
+}
+
+/**
+ * Get the time to wait for a response before retransmitting.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return The retransmit timeout in ms
+ */
+static uint32_t getRetransmitTimeout(UAVTalkConnectionData *connection)
+{
+    uint32_t timeout;
+
+    if (connection->rttMs == 0) {
+        return UAVTALK_RTO_INITIAL_MS;
+    }
+    timeout = connection->rttMs + 4 * connection->rttVarMs;
+    if (timeout < UAVTALK_RTO_MIN_MS) {
+        timeout = UAVTALK_RTO_MIN_MS;
+    } else if (timeout > UAVTALK_RTO_MAX_MS) {
+        timeout = UAVTALK_RTO_MAX_MS;
+    }
+    return timeout;
 }
 
 /**
@@ -966,8 +1381,15 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
     }
 
     // Copy data (if any)
+    UAVTalkDeltaSlot *deltaSlot = NULL;
     if (length > 0) {
-        if (UAVObjPack(obj, instId, &connection->txBuffer[headerLength]) == -1) {
+        if (type == UAVTALK_TYPE_OBJ && (connection->features & UAVTALK_FEATURE_DELTA) && isDeltaCandidate(obj, length)) {
+            // Large plain updates may go out as a delta to the last full image
+            length = packDeltaObject(connection, obj, instId, length, &deltaSlot);
+        } else if (UAVObjPack(obj, instId, &connection->txBuffer[headerLength]) == -1) {
+            length = -1;
+        }
+        if (length == -1) {
             connection->stats.txErrors++;
             return -1;
         }
@@ -984,6 +1406,10 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
     uint16_t tx_msg_len = headerLength + length + UAVTALK_CHECKSUM_LENGTH;
     int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
 
+    if (deltaSlot) {
+        commitDeltaSlot(connection, deltaSlot, length, rc == tx_msg_len);
+    }
+
     // Update stats
     if (rc == tx_msg_len) {
         ++connection->stats.txObjects;
@@ -1000,6 +1426,271 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
     return 0;
 }
 
+/**
+ * Check if the updates of an object may be delta encoded. Only large single instance
+ * objects qualify that are not updated manually. Deltas between the instances of a
+ * multi instance object or between manual updates (log entries for example) rarely
+ * save anything and depend on every keyframe arriving.
+ * \param[in] obj Object
+ * \param[in] length Object data length
+ * \return true if the object may be sent as a delta
+ */
+static bool isDeltaCandidate(UAVObjHandle obj, int32_t length)
+{
+    UAVObjMetadata metadata;
+
+    if (length < UAVTALK_DELTA_MIN_LENGTH || UAVObjIsMetaobject(obj) || !UAVObjIsSingleInstance(obj)) {
+        return false;
+    }
+    if (UAVObjGetMetadata(obj, &metadata) < 0) {
+        return false;
+    }
+    return UAVObjGetTelemetryUpdateMode(&metadata) != UPDATEMODE_MANUAL;
+}
+
+/**
+ * Pack an object into the transmit buffer payload, either in full or as a UAVTALK_TYPE_OBJ_DELTA
+ * payload listing the blocks that differ from the last full image sent. The delta carries
+ * the CRC32 of that image so the receiver can reject it against any other base and NACK
+ * it, which forces a full image. Every UAVTALK_DELTA_KEYFRAME_INTERVAL updates a full image
+ * is sent anyway. The slot is only updated by commitDeltaSlot() once the frame is sent.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to pack
+ * \param[in] instId The instance ID
+ * \param[in] length Object data length
+ * \param[out] slotOut The delta slot of the object, NULL if it has none
+ * \return Payload length
+ * \return -1 Failure
+ */
+static int32_t packDeltaObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, int32_t length, UAVTalkDeltaSlot **slotOut)
+{
+    uint8_t *payload     = &connection->txBuffer[UAVTALK_MIN_HEADER_LENGTH];
+    int32_t numBlocks    = (length + UAVTALK_DELTA_BLOCK_LENGTH - 1) / UAVTALK_DELTA_BLOCK_LENGTH;
+    int32_t bitmapLength = (numBlocks + 7) / 8;
+
+    // Pack behind the room needed for the delta header, changed blocks are then moved down in place
+    uint8_t *image = payload + UAVTALK_DELTA_CHECK_LENGTH + bitmapLength;
+
+    if (UAVObjPack(obj, instId, image) == -1) {
+        return -1;
+    }
+
+    UAVTalkDeltaSlot *slot = getDeltaSlot(connection, obj, instId, length);
+    *slotOut = slot;
+    if (slot && slot->sendCount > 0) {
+        uint8_t bitmap[UAVTALK_DELTA_MAX_BITMAP_LENGTH];
+        int32_t deltaLength = UAVTALK_DELTA_CHECK_LENGTH + bitmapLength;
+
+        memset(bitmap, 0, bitmapLength);
+        for (int32_t n = 0; n < numBlocks; ++n) {
+            int32_t offset = n * UAVTALK_DELTA_BLOCK_LENGTH;
+            int32_t size   = (length - offset < UAVTALK_DELTA_BLOCK_LENGTH) ? length - offset : UAVTALK_DELTA_BLOCK_LENGTH;
+            if (memcmp(&image[offset], &slot->base[offset], size) != 0) {
+                bitmap[n / 8] |= 1 << (n % 8);
+                deltaLength   += size;
+            }
+        }
+
+        if (deltaLength < length) {
+            uint8_t *out = image;
+            for (int32_t n = 0; n < numBlocks; ++n) {
+                if (bitmap[n / 8] & (1 << (n % 8))) {
+                    int32_t offset = n * UAVTALK_DELTA_BLOCK_LENGTH;
+                    int32_t size   = (length - offset < UAVTALK_DELTA_BLOCK_LENGTH) ? length - offset : UAVTALK_DELTA_BLOCK_LENGTH;
+                    memmove(out, &image[offset], size);
+                    out += size;
+                }
+            }
+            payload[0] = (uint8_t)(slot->baseCrc & 0xff);
+            payload[1] = (uint8_t)((slot->baseCrc >> 8) & 0xff);
+            payload[2] = (uint8_t)((slot->baseCrc >> 16) & 0xff);
+            payload[3] = (uint8_t)((slot->baseCrc >> 24) & 0xff);
+            memcpy(&payload[UAVTALK_DELTA_CHECK_LENGTH], bitmap, bitmapLength);
+            connection->txBuffer[1] = UAVTALK_TYPE_OBJ_DELTA;
+            return deltaLength;
+        }
+    }
+
+    memmove(payload, image, length);
+    return length;
+}
+
+/**
+ * Update a delta slot once its frame went out. A full image that was sent becomes the
+ * base of the following deltas, a failed send forces the next update to be a full image.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] slot The slot of the object that was packed
+ * \param[in] length Payload length
+ * \param[in] sent True if the whole frame was sent
+ */
+static void commitDeltaSlot(UAVTalkConnectionData *connection, UAVTalkDeltaSlot *slot, int32_t length, bool sent)
+{
+    if (!sent) {
+        slot->sendCount = 0;
+    } else if (connection->txBuffer[1] == UAVTALK_TYPE_OBJ_DELTA) {
+        slot->sendCount = (slot->sendCount + 1) % UAVTALK_DELTA_KEYFRAME_INTERVAL;
+    } else {
+        memcpy(slot->base, &connection->txBuffer[UAVTALK_MIN_HEADER_LENGTH], length);
+        slot->baseCrc   = PIOS_CRC32_updateCRC(0, slot->base, length);
+        slot->sendCount = 1;
+    }
+}
+
+/**
+ * Make the next update of an object a full image.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object
+ */
+static void forceDeltaKeyframe(UAVTalkConnectionData *connection, UAVObjHandle obj)
+{
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; ++n) {
+        if (connection->deltaSlots[n].obj == obj) {
+            connection->deltaSlots[n].sendCount = 0;
+        }
+    }
+}
+
+/**
+ * Find the delta slot of an object instance. On first use a free slot is claimed, or
+ * the least recently used one large enough is taken over. The base buffers are never
+ * freed or reallocated since pios_free() does nothing on some targets.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object
+ * \param[in] instId The instance ID
+ * \param[in] length Object data length
+ * \return The slot, or NULL when none is available
+ */
+static UAVTalkDeltaSlot *getDeltaSlot(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, int32_t length)
+{
+    UAVTalkDeltaSlot *freeSlot = NULL;
+    UAVTalkDeltaSlot *oldest   = NULL;
+    UAVTalkDeltaSlot *slot;
+
+    ++connection->deltaClock;
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; ++n) {
+        slot = &connection->deltaSlots[n];
+        if (slot->obj == obj && slot->instId == instId) {
+            slot->lastUsed = connection->deltaClock;
+            return slot;
+        }
+        if (slot->obj == NULL) {
+            if (!freeSlot) {
+                freeSlot = slot;
+            }
+        } else if (slot->capacity >= length && (!oldest || (int32_t)(slot->lastUsed - oldest->lastUsed) < 0)) {
+            oldest = slot;
+        }
+    }
+
+    if (freeSlot) {
+        slot = freeSlot;
+        slot->base = pios_malloc(length);
+        if (!slot->base) {
+            return NULL;
+        }
+        slot->capacity = length;
+    } else if (oldest) {
+        slot = oldest;
+    } else {
+        return NULL;
+    }
+    slot->obj       = obj;
+    slot->instId    = instId;
+    slot->sendCount = 0;
+    slot->lastUsed  = connection->deltaClock;
+    return slot;
+}
+
+/**
+ * Send as many of the given object instances as fit into one UAVTALK_TYPE_OBJ_MULTI frame.
+ * A frame of a single object is sent as a plain UAVTALK_TYPE_OBJ message instead.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objs Objects to send
+ * \param[in] instIds The instance ID of each object (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] count Number of objects available
+ * \return Number of objects sent (at least one)
+ * \return -1 Failure
+ */
+static int32_t sendMultiObject(UAVTalkConnectionData *connection, const UAVObjHandle *objs, const uint16_t *instIds, uint8_t count)
+{
+    int32_t length = 0;
+    uint8_t n;
+
+    // Determine how many objects fit into the frame
+    for (n = 0; n < count; ++n) {
+        int32_t entryLength = UAVTALK_MULTI_ENTRY_HEADER_LENGTH + UAVObjGetNumBytes(objs[n]);
+        if (length + entryLength > UAVTALK_MULTI_MAX_PAYLOAD_LENGTH) {
+            break;
+        }
+        length += entryLength;
+    }
+
+    if (n < 2) {
+        // Nothing to gain, send the first object on its own
+        return (sendSingleObject(connection, UAVTALK_TYPE_OBJ, UAVObjGetID(objs[0]), instIds[0], objs[0]) == 0) ? 1 : -1;
+    }
+
+    if (!connection->outStream) {
+        connection->stats.txErrors++;
+        return -1;
+    }
+
+    // Setup sync byte
+    connection->txBuffer[0] = UAVTALK_SYNC_VAL;
+    // Setup type
+    connection->txBuffer[1] = UAVTALK_TYPE_OBJ_MULTI;
+    // Object ID is unused, instance ID holds the number of packed objects
+    connection->txBuffer[4] = 0;
+    connection->txBuffer[5] = 0;
+    connection->txBuffer[6] = 0;
+    connection->txBuffer[7] = 0;
+    connection->txBuffer[8] = n;
+    connection->txBuffer[9] = 0;
+    int32_t headerLength = 10;
+
+    // Pack the objects
+    uint8_t *entry = &connection->txBuffer[headerLength];
+    for (uint8_t i = 0; i < n; ++i) {
+        uint32_t objId = UAVObjGetID(objs[i]);
+        entry[0] = (uint8_t)(objId & 0xFF);
+        entry[1] = (uint8_t)((objId >> 8) & 0xFF);
+        entry[2] = (uint8_t)((objId >> 16) & 0xFF);
+        entry[3] = (uint8_t)((objId >> 24) & 0xFF);
+        entry[4] = (uint8_t)(instIds[i] & 0xFF);
+        entry[5] = (uint8_t)((instIds[i] >> 8) & 0xFF);
+        entry   += UAVTALK_MULTI_ENTRY_HEADER_LENGTH;
+        if (UAVObjPack(objs[i], instIds[i], entry) == -1) {
+            connection->stats.txErrors++;
+            return -1;
+        }
+        entry += UAVObjGetNumBytes(objs[i]);
+    }
+
+    // Store the packet length
+    connection->txBuffer[2] = (uint8_t)((headerLength + length) & 0xFF);
+    connection->txBuffer[3] = (uint8_t)(((headerLength + length) >> 8) & 0xFF);
+
+    // Calculate and store checksum
+    connection->txBuffer[headerLength + length] = PIOS_CRC_updateCRC(0, connection->txBuffer, headerLength + length);
+
+    // Send frame
+    uint16_t tx_msg_len = headerLength + length + UAVTALK_CHECKSUM_LENGTH;
+    int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+
+    // Update stats
+    if (rc == tx_msg_len) {
+        connection->stats.txObjects     += n;
+        connection->stats.txObjectBytes += length - n * UAVTALK_MULTI_ENTRY_HEADER_LENGTH;
+        connection->stats.txBytes += tx_msg_len;
+    } else {
+        connection->stats.txErrors++;
+        connection->stats.txBytes += (rc > 0) ? rc : 0;
+        return -1;
+    }
+
+    return n;
+}
+
 /**
  * @}
  * @}
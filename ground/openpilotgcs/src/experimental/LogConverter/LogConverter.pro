@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Headless converter from .opl telemetry logs to
+# per object columnar files.
+# Usage: LogConverter [-f bin|csv] [-j threads] <logfile.opl> <outdir>
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = LogConverter
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+include(../../../openpilotgcs.pri)
+
+LIBS += -L$$GCS_PLUGIN_PATH/OpenPilot
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+
+include(../../plugins/uavobjects/uavobjects.pri)
+
+HEADERS += columnwriter.h \
+    framescanner.h
+
+SOURCES += main.cpp \
+    columnwriter.cpp \
+    framescanner.cpp
@@ -0,0 +1,282 @@
+/**
+ ******************************************************************************
+ *
+ * @file       columnwriter.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2014.
+ * @brief      Decodes UAVObject frames into per object column files
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "columnwriter.h"
+
+#include <QDir>
+#include <QTextStream>
+#include <QDebug>
+
+ColumnWriter::ColumnWriter(const QHash<quint32, ObjectLayout> *layouts, const QString &outDir, Format format) :
+    m_layouts(layouts), m_outDir(outDir), m_format(format), m_finishing(false), m_framesWritten(0)
+{}
+
+ColumnWriter::~ColumnWriter()
+{
+    finish();
+    wait();
+}
+
+void ColumnWriter::enqueue(Batch *batch)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_queue.size() >= MAX_QUEUED_BATCHES) {
+        m_notFull.wait(&m_mutex);
+    }
+    m_queue.enqueue(batch);
+    m_notEmpty.wakeOne();
+}
+
+void ColumnWriter::finish()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_finishing = true;
+    m_notEmpty.wakeOne();
+}
+
+void ColumnWriter::run()
+{
+    forever {
+        Batch *batch;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_finishing) {
+                m_notEmpty.wait(&m_mutex);
+            }
+            if (m_queue.isEmpty()) {
+                break;
+            }
+            batch = m_queue.dequeue();
+            m_notFull.wakeOne();
+        }
+
+        const quint8 *data = (const quint8 *)batch->data.constData();
+        foreach(const Frame &frame, batch->frames) {
+            ObjectFiles *files = m_files.value(frame.objId);
+
+            if (!files) {
+                files = openFiles(&(*m_layouts->find(frame.objId)));
+                m_files.insert(frame.objId, files);
+            }
+            if (m_format == FORMAT_BIN) {
+                writeBin(files, frame, data + frame.offset);
+            } else {
+                writeCsv(files, frame, data + frame.offset);
+            }
+            m_framesWritten++;
+        }
+        delete batch;
+    }
+
+    closeFiles();
+}
+
+static const char *typeSuffix(UAVObjectField::FieldType type)
+{
+    switch (type) {
+    case UAVObjectField::INT8:
+        return "i8";
+
+    case UAVObjectField::INT16:
+        return "i16";
+
+    case UAVObjectField::INT32:
+        return "i32";
+
+    case UAVObjectField::UINT16:
+        return "u16";
+
+    case UAVObjectField::UINT32:
+        return "u32";
+
+    case UAVObjectField::FLOAT32:
+        return "f32";
+
+    default:
+        return "u8";
+    }
+}
+
+ColumnWriter::ObjectFiles *ColumnWriter::openFiles(const ObjectLayout *layout)
+{
+    ObjectFiles *files = new ObjectFiles;
+
+    files->layout     = layout;
+    files->timeStamps = NULL;
+    files->instances  = NULL;
+    files->csv = NULL;
+
+    if (m_format == FORMAT_BIN) {
+        // One directory per object, one raw little endian file per column
+        QDir dir(m_outDir);
+        dir.mkpath(layout->name);
+        dir.cd(layout->name);
+
+        QFile schema(dir.filePath("schema.txt"));
+        schema.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        QTextStream schemaStream(&schema);
+        schemaStream << "timestamp.u32 1 ms\n";
+
+        files->timeStamps = new QFile(dir.filePath("timestamp.u32"));
+        files->timeStamps->open(QIODevice::WriteOnly | QIODevice::Truncate);
+        if (!layout->singleInstance) {
+            schemaStream << "instance.u16 1\n";
+            files->instances = new QFile(dir.filePath("instance.u16"));
+            files->instances->open(QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+        foreach(const FieldLayout &field, layout->fields) {
+            QString fileName = QString("%1.%2").arg(field.name).arg(typeSuffix(field.type));
+
+            schemaStream << fileName << ' ' << field.numElements;
+            if (field.numElements > 1) {
+                schemaStream << ' ' << field.elementNames.join(",");
+            }
+            if (field.type == UAVObjectField::ENUM) {
+                schemaStream << " options=" << field.options.join(",");
+            }
+            schemaStream << '\n';
+
+            QFile *column = new QFile(dir.filePath(fileName));
+            column->open(QIODevice::WriteOnly | QIODevice::Truncate);
+            files->columns.append(column);
+        }
+    } else {
+        files->csv = new QFile(QDir(m_outDir).filePath(layout->name + ".csv"));
+        files->csv->open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+        QByteArray header("timestamp,instance");
+        foreach(const FieldLayout &field, layout->fields) {
+            if (field.numElements == 1) {
+                header += ',' + field.name.toLatin1();
+            } else {
+                foreach(const QString &element, field.elementNames) {
+                    header += ',' + field.name.toLatin1() + '.' + element.toLatin1();
+                }
+            }
+        }
+        header += '\n';
+        files->csv->write(header);
+    }
+
+    return files;
+}
+
+void ColumnWriter::writeBin(ObjectFiles *files, const Frame &frame, const quint8 *payload)
+{
+    files->timeStamps->write((const char *)&frame.timeStamp, sizeof(frame.timeStamp));
+    if (files->instances) {
+        files->instances->write((const char *)&frame.instId, sizeof(frame.instId));
+    }
+
+    // The wire format already is packed little endian, so columns are plain slices
+    const QVector<FieldLayout> &fields = files->layout->fields;
+    for (int i = 0; i < fields.size(); i++) {
+        files->columns[i]->write((const char *)payload + fields[i].offset, fields[i].numBytes);
+    }
+}
+
+void ColumnWriter::writeCsv(ObjectFiles *files, const Frame &frame, const quint8 *payload)
+{
+    QByteArray line;
+
+    line += QByteArray::number(frame.timeStamp);
+    line += ',';
+    line += QByteArray::number(frame.instId);
+
+    foreach(const FieldLayout &field, files->layout->fields) {
+        const quint8 *value = payload + field.offset;
+
+        for (quint32 i = 0; i < field.numElements; i++, value += field.elementSize) {
+            line += ',';
+            switch (field.type) {
+            case UAVObjectField::INT8:
+                line += QByteArray::number(*(const qint8 *)value);
+                break;
+            case UAVObjectField::INT16:
+            {
+                qint16 tmp;
+                memcpy(&tmp, value, sizeof(tmp));
+                line += QByteArray::number(tmp);
+                break;
+            }
+            case UAVObjectField::INT32:
+            {
+                qint32 tmp;
+                memcpy(&tmp, value, sizeof(tmp));
+                line += QByteArray::number(tmp);
+                break;
+            }
+            case UAVObjectField::UINT16:
+            {
+                quint16 tmp;
+                memcpy(&tmp, value, sizeof(tmp));
+                line += QByteArray::number(tmp);
+                break;
+            }
+            case UAVObjectField::UINT32:
+            {
+                quint32 tmp;
+                memcpy(&tmp, value, sizeof(tmp));
+                line += QByteArray::number(tmp);
+                break;
+            }
+            case UAVObjectField::FLOAT32:
+            {
+                float tmp;
+                memcpy(&tmp, value, sizeof(tmp));
+                line += QByteArray::number(tmp, 'g', 9);
+                break;
+            }
+            case UAVObjectField::ENUM:
+                if (*value < field.options.size()) {
+                    line += field.options.at(*value).toLatin1();
+                } else {
+                    line += QByteArray::number(*value);
+                }
+                break;
+            case UAVObjectField::BITFIELD:
+                // bits are packed, one byte holds eight elements
+                line += QByteArray::number((payload[field.offset + i / 8] >> (i % 8)) & 1);
+                break;
+            default:
+                line += QByteArray::number(*value);
+                break;
+            }
+        }
+    }
+    line += '\n';
+    files->csv->write(line);
+}
+
+void ColumnWriter::closeFiles()
+{
+    foreach(ObjectFiles * files, m_files) {
+        delete files->timeStamps;
+        delete files->instances;
+        delete files->csv;
+        qDeleteAll(files->columns);
+        delete files;
+    }
+    m_files.clear();
+}
@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ *
+ * @file       columnwriter.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2014.
+ * @brief      Decodes UAVObject frames into per object column files
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef COLUMNWRITER_H
+#define COLUMNWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QFile>
+
+#include "uavobjects/uavobjectfield.h"
+
+/**
+ * Plain copy of the layout of a generated UAVObject, so the writer threads
+ * never have to touch the QObjects owned by the main thread.
+ */
+struct FieldLayout {
+    QString name;
+    UAVObjectField::FieldType type;
+    quint32 offset;
+    quint32 elementSize;
+    quint32 numElements;
+    quint32 numBytes;
+    QStringList elementNames;
+    QStringList options;
+};
+
+struct ObjectLayout {
+    QString name;
+    quint32 objId;
+    quint32 numBytes;
+    bool    singleInstance;
+    QVector<FieldLayout> fields;
+};
+
+/**
+ * A frame of a batch, the payload lives in Batch::data.
+ */
+struct Frame {
+    quint32 timeStamp;
+    quint32 objId;
+    quint16 instId;
+    qint32  offset;
+    qint32  length;
+};
+
+struct Batch {
+    QVector<Frame> frames;
+    QByteArray data;
+};
+
+class ColumnWriter : public QThread {
+public:
+    typedef enum { FORMAT_BIN, FORMAT_CSV } Format;
+
+    ColumnWriter(const QHash<quint32, ObjectLayout> *layouts, const QString &outDir, Format format);
+    ~ColumnWriter();
+
+    // Queue a batch, blocks while the writer is too far behind
+    void enqueue(Batch *batch);
+    // Flush and stop after all queued batches are written
+    void finish();
+
+    quint64 framesWritten() const
+    {
+        return m_framesWritten;
+    }
+
+protected:
+    void run();
+
+private:
+    // Output files of one object
+    struct ObjectFiles {
+        const ObjectLayout *layout;
+        QFile *timeStamps;
+        QFile *instances;
+        QVector<QFile *> columns;
+        QFile *csv;
+    };
+
+    static const int MAX_QUEUED_BATCHES = 8;
+
+    const QHash<quint32, ObjectLayout> *m_layouts;
+    QString m_outDir;
+    Format m_format;
+
+    QQueue<Batch *> m_queue;
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    bool m_finishing;
+
+    QHash<quint32, ObjectFiles *> m_files;
+    quint64 m_framesWritten;
+
+    ObjectFiles *openFiles(const ObjectLayout *layout);
+    void writeBin(ObjectFiles *files, const Frame &frame, const quint8 *payload);
+    void writeCsv(ObjectFiles *files, const Frame &frame, const quint8 *payload);
+    void closeFiles();
+};
+
+#endif // COLUMNWRITER_H
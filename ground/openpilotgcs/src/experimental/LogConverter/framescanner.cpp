@@ -0,0 +1,193 @@
+/**
+ ******************************************************************************
+ *
+ * @file       framescanner.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2014.
+ * @brief      Splits a recorded UAVTalk stream into object frames
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "framescanner.h"
+
+#include <utils/crc.h>
+#include <QtEndian>
+#include <string.h>
+
+using namespace Utils;
+
+FrameScanner::FrameScanner(const QHash<quint32, ObjectLayout> *layouts, FrameSink *sink) :
+    m_layouts(layouts), m_sink(sink)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/**
+ * Scan the next chunk of the stream.
+ * \param[in] data Stream bytes
+ * \param[in] length Number of bytes in \a data
+ * \param[in] timeStamp Time stamp assigned to frames completed by this chunk
+ */
+void FrameScanner::scan(const quint8 *data, qint64 length, quint32 timeStamp)
+{
+    if (m_pending.isEmpty()) {
+        // Common case, scan straight from the caller's buffer
+        qint64 used = scanBuffer(data, length, timeStamp);
+        if (used < length) {
+            m_pending.append((const char *)data + used, length - used);
+        }
+    } else {
+        m_pending.append((const char *)data, length);
+        qint64 used = scanBuffer((const quint8 *)m_pending.constData(), m_pending.size(), timeStamp);
+        m_pending.remove(0, used);
+    }
+}
+
+/**
+ * Hand out all complete frames of a buffer.
+ * \return number of bytes consumed, the rest is the start of an incomplete frame
+ */
+qint64 FrameScanner::scanBuffer(const quint8 *data, qint64 length, quint32 timeStamp)
+{
+    qint64 pos = 0;
+
+    while (pos < length) {
+        const quint8 *sync = (const quint8 *)memchr(data + pos, SYNC_VAL, length - pos);
+        if (!sync) {
+            m_stats.skippedBytes += length - pos;
+            return length;
+        }
+        m_stats.skippedBytes += (sync - data) - pos;
+        pos = sync - data;
+
+        if (length - pos < HEADER_LENGTH) {
+            return pos;
+        }
+
+        const quint8 *header = data + pos;
+        quint8 type = header[1];
+        quint16 packetSize = qFromLittleEndian<quint16>(header + 2);
+        if ((type & TYPE_MASK) != TYPE_VER || packetSize < HEADER_LENGTH || packetSize > HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
+            // Not a frame start, resync on the next byte
+            m_stats.skippedBytes++;
+            pos++;
+            continue;
+        }
+
+        if (length - pos < packetSize + CHECKSUM_LENGTH) {
+            return pos;
+        }
+
+        if (Crc::updateCRC(0, header, packetSize) != header[packetSize]) {
+            m_stats.crcErrors++;
+            m_stats.skippedBytes++;
+            pos++;
+            continue;
+        }
+
+        // Only object updates carry data worth converting
+        if (type == TYPE_OBJ || type == TYPE_OBJ_ACK) {
+            quint32 objId = qFromLittleEndian<quint32>(header + 4);
+            quint16 instId = qFromLittleEndian<quint16>(header + 8);
+            QHash<quint32, ObjectLayout>::const_iterator layout = m_layouts->constFind(objId);
+
+            if (layout == m_layouts->constEnd() || layout->numBytes != (quint32)(packetSize - HEADER_LENGTH)) {
+                m_stats.unknownObjects++;
+            } else {
+                if (type == TYPE_OBJ && layout->numBytes >= DELTA_MIN_LENGTH) {
+                    m_deltaBase.insert(((quint64)objId << 16) | instId, QByteArray((const char *)header + HEADER_LENGTH, layout->numBytes));
+                }
+                m_sink->frame(timeStamp, objId, instId, header + HEADER_LENGTH, packetSize - HEADER_LENGTH);
+                m_stats.frames++;
+            }
+        } else if (type == TYPE_OBJ_MULTI) {
+            scanMultiObject(header + HEADER_LENGTH, packetSize - HEADER_LENGTH, qFromLittleEndian<quint16>(header + 8), timeStamp);
+        } else if (type == TYPE_OBJ_DELTA) {
+            scanDeltaObject(header + HEADER_LENGTH, packetSize - HEADER_LENGTH, qFromLittleEndian<quint32>(header + 4), qFromLittleEndian<quint16>(header + 8), timeStamp);
+        }
+        pos += packetSize + CHECKSUM_LENGTH;
+    }
+
+    return pos;
+}
+
+/**
+ * Split a multi object frame into its object updates. The entries carry no length
+ * of their own, so the rest of the frame is dropped at the first unknown object.
+ */
+void FrameScanner::scanMultiObject(const quint8 *data, qint32 length, quint16 count, quint32 timeStamp)
+{
+    qint32 pos = 0;
+
+    for (quint16 n = 0; n < count && pos + MULTI_ENTRY_HEADER_LENGTH <= length; ++n) {
+        quint32 objId  = qFromLittleEndian<quint32>(data + pos);
+        quint16 instId = qFromLittleEndian<quint16>(data + pos + 4);
+        pos += MULTI_ENTRY_HEADER_LENGTH;
+
+        QHash<quint32, ObjectLayout>::const_iterator layout = m_layouts->constFind(objId);
+        if (layout == m_layouts->constEnd() || pos + (qint32)layout->numBytes > length) {
+            m_stats.unknownObjects++;
+            return;
+        }
+        m_sink->frame(timeStamp, objId, instId, data + pos, layout->numBytes);
+        m_stats.frames++;
+        pos += layout->numBytes;
+    }
+}
+
+/**
+ * Rebuild an object update from a delta frame and the last full image of the instance.
+ * Deltas without a matching base image are counted as unknown objects.
+ */
+void FrameScanner::scanDeltaObject(const quint8 *data, qint32 length, quint32 objId, quint16 instId, quint32 timeStamp)
+{
+    QHash<quint64, QByteArray>::iterator base = m_deltaBase.find(((quint64)objId << 16) | instId);
+
+    if (base == m_deltaBase.end()) {
+        m_stats.unknownObjects++;
+        return;
+    }
+
+    qint32 numBytes     = base->size();
+    qint32 numBlocks    = (numBytes + DELTA_BLOCK_LENGTH - 1) / DELTA_BLOCK_LENGTH;
+    qint32 bitmapLength = (numBlocks + 7) / 8;
+    if (length < DELTA_CHECK_LENGTH + bitmapLength) {
+        m_stats.unknownObjects++;
+        return;
+    }
+    quint32 baseCrc = (quint32)data[0] | ((quint32)data[1] << 8) | ((quint32)data[2] << 16) | ((quint32)data[3] << 24);
+    if (Crc::updateCRC32(0, (const quint8 *)base->constData(), numBytes) != baseCrc) {
+        m_stats.unknownObjects++;
+        return;
+    }
+
+    QByteArray image(*base);
+    qint32 pos = DELTA_CHECK_LENGTH + bitmapLength;
+    for (qint32 n = 0; n < numBlocks; ++n) {
+        if (data[DELTA_CHECK_LENGTH + n / 8] & (1 << (n % 8))) {
+            qint32 offset = n * DELTA_BLOCK_LENGTH;
+            qint32 size   = (numBytes - offset < DELTA_BLOCK_LENGTH) ? numBytes - offset : DELTA_BLOCK_LENGTH;
+            if (pos + size > length) {
+                m_stats.unknownObjects++;
+                return;
+            }
+            memcpy(image.data() + offset, data + pos, size);
+            pos += size;
+        }
+    }
+
+    m_sink->frame(timeStamp, objId, instId, (const quint8 *)image.constData(), numBytes);
+    m_stats.frames++;
+}
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ *
+ * @file       framescanner.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2014.
+ * @brief      Splits a recorded UAVTalk stream into object frames
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef FRAMESCANNER_H
+#define FRAMESCANNER_H
+
+#include <QHash>
+#include <QByteArray>
+
+#include "columnwriter.h"
+
+class FrameSink {
+public:
+    virtual ~FrameSink() {}
+    virtual void frame(quint32 timeStamp, quint32 objId, quint16 instId, const quint8 *payload, qint32 length) = 0;
+};
+
+/**
+ * Scanner for the UAVTalk wire format. Unlike the UAVTalk plugin it works on
+ * whole buffers, carries partial frames over to the next buffer and only hands
+ * out object updates, it never answers requests or touches UAVObjects.
+ */
+class FrameScanner {
+public:
+    typedef struct {
+        quint64 frames;
+        quint64 skippedBytes;
+        quint64 crcErrors;
+        quint64 unknownObjects;
+    } Stats;
+
+    FrameScanner(const QHash<quint32, ObjectLayout> *layouts, FrameSink *sink);
+
+    void scan(const quint8 *data, qint64 length, quint32 timeStamp);
+
+    const Stats &stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    static const int SYNC_VAL      = 0x3C;
+    static const int TYPE_MASK     = 0xF8;
+    static const int TYPE_VER      = 0x20;
+    static const int TYPE_OBJ      = (TYPE_VER | 0x00);
+    static const int TYPE_OBJ_ACK  = (TYPE_VER | 0x02);
+    static const int TYPE_OBJ_MULTI = (TYPE_VER | 0x05);
+    static const int TYPE_OBJ_DELTA = (TYPE_VER | 0x06);
+
+    // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
+    static const int HEADER_LENGTH = 10;
+    // multi object entry : object ID(4), instance ID(2)
+    static const int MULTI_ENTRY_HEADER_LENGTH = 6;
+    // delta payload : base image CRC32 (little endian), changed block bitmap, changed blocks
+    static const int DELTA_CHECK_LENGTH = 4;
+    static const int DELTA_BLOCK_LENGTH = 4;
+    static const int DELTA_MIN_LENGTH   = 32;
+    static const int MAX_PAYLOAD_LENGTH = 256;
+    static const int CHECKSUM_LENGTH    = 1;
+
+    const QHash<quint32, ObjectLayout> *m_layouts;
+    FrameSink *m_sink;
+    QByteArray m_pending;
+    // last full image of each large object instance, base of the following deltas
+    QHash<quint64, QByteArray> m_deltaBase;
+    Stats m_stats;
+
+    qint64 scanBuffer(const quint8 *data, qint64 length, quint32 timeStamp);
+    void scanMultiObject(const quint8 *data, qint32 length, quint16 count, quint32 timeStamp);
+    void scanDeltaObject(const quint8 *data, qint32 length, quint32 objId, quint16 instId, quint32 timeStamp);
+};
+
+#endif // FRAMESCANNER_H
@@ -0,0 +1,231 @@
+/**
+ ******************************************************************************
+ *
+ * @file       main.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2014.
+ * @brief      Headless converter from .opl logs to per object columnar files.
+ *             On-board DebugLog dumps are converted after exporting them as
+ *             .opl from the flight log dialog.
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QTextStream>
+
+#include "uavobjects/uavobjectmanager.h"
+#include "uavobjects/uavobjectsinit.h"
+#include "framescanner.h"
+#include "columnwriter.h"
+
+/**
+ * Collects frames into per writer batches, every writer thread owns a fixed
+ * subset of the objects so no object file is ever shared between threads.
+ */
+class Dispatcher : public FrameSink {
+public:
+    static const int BATCH_SIZE = 256 * 1024;
+
+    Dispatcher(const QHash<quint32, int> *objWriter, const QList<ColumnWriter *> &writers) :
+        m_objWriter(objWriter), m_writers(writers)
+    {
+        for (int i = 0; i < m_writers.size(); i++) {
+            m_batches.append(new Batch);
+        }
+    }
+
+    void frame(quint32 timeStamp, quint32 objId, quint16 instId, const quint8 *payload, qint32 length)
+    {
+        int writer   = m_objWriter->value(objId);
+        Batch *batch = m_batches[writer];
+
+        Frame frame;
+
+        frame.timeStamp = timeStamp;
+        frame.objId     = objId;
+        frame.instId    = instId;
+        frame.offset    = batch->data.size();
+        frame.length    = length;
+        batch->frames.append(frame);
+        batch->data.append((const char *)payload, length);
+
+        if (batch->data.size() >= BATCH_SIZE) {
+            m_writers[writer]->enqueue(batch);
+            m_batches[writer] = new Batch;
+        }
+    }
+
+    void flush()
+    {
+        for (int i = 0; i < m_writers.size(); i++) {
+            m_writers[i]->enqueue(m_batches[i]);
+            m_batches[i] = new Batch;
+        }
+    }
+
+    ~Dispatcher()
+    {
+        qDeleteAll(m_batches);
+    }
+
+private:
+    const QHash<quint32, int> *m_objWriter;
+    QList<ColumnWriter *> m_writers;
+    QList<Batch *> m_batches;
+};
+
+/**
+ * Copy the layout of every registered object out of the object manager.
+ */
+static void collectLayouts(UAVObjectManager *objMngr, QHash<quint32, ObjectLayout> &layouts)
+{
+    foreach(QList<UAVObject *> instances, objMngr->getObjects()) {
+        UAVObject *obj = instances.first();
+        ObjectLayout layout;
+
+        layout.name     = obj->getName();
+        layout.objId    = obj->getObjID();
+        layout.numBytes = obj->getNumBytes();
+        layout.singleInstance = obj->isSingleInstance();
+        foreach(UAVObjectField * field, obj->getFields()) {
+            FieldLayout fieldLayout;
+
+            fieldLayout.name         = field->getName();
+            fieldLayout.type         = field->getType();
+            fieldLayout.offset       = field->getDataOffset();
+            fieldLayout.numElements  = field->getNumElements();
+            fieldLayout.numBytes     = field->getNumBytes();
+            fieldLayout.elementSize  = (field->getType() == UAVObjectField::BITFIELD) ? 1 : fieldLayout.numBytes / fieldLayout.numElements;
+            fieldLayout.elementNames = field->getElementNames();
+            fieldLayout.options      = field->getOptions();
+            layout.fields.append(fieldLayout);
+        }
+        layouts.insert(layout.objId, layout);
+    }
+}
+
+static void usage(QTextStream &sout)
+{
+    sout << "Usage: LogConverter [-f bin|csv] [-j threads] <logfile.opl> <outdir>\n";
+    sout << "  -f bin   one directory per object, one raw little endian file per field (default)\n";
+    sout << "  -f csv   one csv file per object\n";
+    sout << "  -j n     number of writer threads (default: number of cores)\n";
+}
+
+int main(int argc, char *argv[])
+{
+    // Needed for the object manager only, no event loop is ever run
+    QCoreApplication a(argc, argv);
+    QTextStream sout(stdout);
+
+    ColumnWriter::Format format = ColumnWriter::FORMAT_BIN;
+    int threads = qMax(1, QThread::idealThreadCount());
+    QStringList files;
+
+    QStringList args = a.arguments();
+    for (int i = 1; i < args.size(); i++) {
+        if (args[i] == "-f" && i + 1 < args.size()) {
+            format = (args[++i] == "csv") ? ColumnWriter::FORMAT_CSV : ColumnWriter::FORMAT_BIN;
+        } else if (args[i] == "-j" && i + 1 < args.size()) {
+            threads = qMax(1, args[++i].toInt());
+        } else {
+            files << args[i];
+        }
+    }
+    if (files.size() != 2) {
+        usage(sout);
+        return 1;
+    }
+
+    QFile logFile(files[0]);
+    if (!logFile.open(QIODevice::ReadOnly)) {
+        sout << "Unable to open " << files[0] << "\n";
+        return 1;
+    }
+    qint64 size = logFile.size();
+    const uchar *log = logFile.map(0, size);
+    if (!log) {
+        sout << "Unable to map " << files[0] << "\n";
+        return 1;
+    }
+    if (!QDir().mkpath(files[1])) {
+        sout << "Unable to create " << files[1] << "\n";
+        return 1;
+    }
+
+    UAVObjectManager *objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(objMngr);
+
+    QHash<quint32, ObjectLayout> layouts;
+    collectLayouts(objMngr, layouts);
+
+    // Spread the objects over the writers
+    QList<ColumnWriter *> writers;
+    for (int i = 0; i < threads; i++) {
+        writers.append(new ColumnWriter(&layouts, files[1], format));
+        writers.last()->start();
+    }
+    QHash<quint32, int> objWriter;
+    int next = 0;
+    foreach(const ObjectLayout &layout, layouts) {
+        objWriter.insert(layout.objId, next++ % threads);
+    }
+
+    Dispatcher dispatcher(&objWriter, writers);
+    FrameScanner scanner(&layouts, &dispatcher);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Walk the .opl records: time stamp (4), data size (8), data
+    qint64 pos = 0;
+    quint32 timeStamp;
+    qint64 dataSize;
+    while (pos + (qint64)(sizeof(timeStamp) + sizeof(dataSize)) <= size) {
+        memcpy(&timeStamp, log + pos, sizeof(timeStamp));
+        memcpy(&dataSize, log + pos + sizeof(timeStamp), sizeof(dataSize));
+        pos += sizeof(timeStamp) + sizeof(dataSize);
+
+        if (dataSize < 1 || dataSize > (1024 * 1024) || size - pos < dataSize) {
+            sout << "Log corrupted at offset " << pos << ", stopping\n";
+            break;
+        }
+        scanner.scan(log + pos, dataSize, timeStamp);
+        pos += dataSize;
+    }
+
+    dispatcher.flush();
+    quint64 written = 0;
+    foreach(ColumnWriter * writer, writers) {
+        writer->finish();
+        writer->wait();
+        written += writer->framesWritten();
+    }
+    qDeleteAll(writers);
+
+    double seconds = qMax(timer.nsecsElapsed() / 1e9, 1e-9);
+    const FrameScanner::Stats &stats = scanner.stats();
+    sout << "frames:          " << written << "\n";
+    sout << "unknown objects: " << stats.unknownObjects << "\n";
+    sout << "crc errors:      " << stats.crcErrors << "\n";
+    sout << "skipped bytes:   " << stats.skippedBytes << "\n";
+    sout << "time:            " << seconds << " s (" << size / seconds / (1024 * 1024) << " MB/s)\n";
+
+    delete objMngr;
+    return 0;
+}
@@ -36,9 +36,15 @@ struct diagnostics {
     int     tilesFromMem;
     int     tilesFromNet;
     int     tilesFromDB;
+    int     tilesPrefetched;
+    int     memoryMisses;
+    int     memoryEvictions;
+    int     memoryTiles;
+    double  memoryUsedMB;
     QString toString()
     {
-        return QString("Network errors:%1\nEmpty Tiles:%2\nTimeOuts:%3\nRunningThreads:%4\nTilesFromMem:%5\nTilesFromNet:%6\nTilesFromDB:%7").arg(networkerrors).arg(emptytiles).arg(timeouts).arg(runningThreads).arg(tilesFromMem).arg(tilesFromNet).arg(tilesFromDB);
+        return QString("Network errors:%1\nEmpty Tiles:%2\nTimeOuts:%3\nRunningThreads:%4\nTilesFromMem:%5\nTilesFromNet:%6\nTilesFromDB:%7").arg(networkerrors).arg(emptytiles).arg(timeouts).arg(runningThreads).arg(tilesFromMem).arg(tilesFromNet).arg(tilesFromDB)
+               + QString("\nTilesPrefetched:%1\nMemoryMisses:%2\nMemoryEvictions:%3\nMemoryTiles:%4\nMemoryUsed:%5MB").arg(tilesPrefetched).arg(memoryMisses).arg(memoryEvictions).arg(memoryTiles).arg(memoryUsedMB, 0, 'f', 1);
 
         ;
     }
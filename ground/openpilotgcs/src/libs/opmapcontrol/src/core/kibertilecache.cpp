@@ -26,43 +26,90 @@
  */
 #include "kibertilecache.h"
 
-// TODO add readwrite lock
-
 namespace core {
-KiberTileCache::KiberTileCache()
+KiberTileCache::KiberTileCache() : _MemoryCacheCapacity(128), hits(0), misses(0), evictions(0)
 {
-    memoryCacheSize = 0;
-    _MemoryCacheCapacity = 22;
+    // the cost of a tile is the size of its image data in bytes
+    cache.setMaxCost(_MemoryCacheCapacity * 1048576);
 }
 
 void KiberTileCache::setMemoryCacheCapacity(const int &value)
 {
-    kiberCacheLock.lockForWrite();
+    QMutexLocker locker(&mutex);
+    int count = cache.count();
+
     _MemoryCacheCapacity = value;
-    kiberCacheLock.unlock();
+    cache.setMaxCost(_MemoryCacheCapacity * 1048576);
+    evictions += count - cache.count();
 }
 int KiberTileCache::MemoryCacheCapacity()
 {
-    kiberCacheLock.lockForRead();
+    QMutexLocker locker(&mutex);
+
     return _MemoryCacheCapacity;
+}
+double KiberTileCache::MemoryCacheSize()
+{
+    QMutexLocker locker(&mutex);
+
+    return cache.totalCost() / 1048576.0;
+}
+int KiberTileCache::MemoryCacheCount()
+{
+    QMutexLocker locker(&mutex);
 
-    kiberCacheLock.unlock();
+    return cache.count();
 }
 
-void KiberTileCache::RemoveMemoryOverload()
+/**
+ * Returns the tile and marks it as the most recently used one, a null image
+ * if the tile is not in memory
+ */
+QImage KiberTileCache::GetTile(const RawTile &tile)
 {
-    while (MemoryCacheSize() > MemoryCacheCapacity()) {
-        if (cachequeue.count() > 0 && list.count() > 0) {
-#ifdef DEBUG_MEMORY_CACHE
-            qDebug() << "Cleaning Memory cache=" << " started with " << cachequeue.count() << " tile " << "ocupying " << memoryCacheSize << " bytes";
-#endif
-            RawTile first = list.dequeue();
-            memoryCacheSize -= cachequeue.value(first).size();
-            cachequeue.remove(first);
-        }
+    QMutexLocker locker(&mutex);
+    QImage *image = cache.object(tile);
+
+    if (image) {
+        ++hits;
+        return *image;
+    }
+    ++misses;
+    return QImage();
+}
+
+/**
+ * Checks for a tile without touching its recency or the statistics
+ */
+bool KiberTileCache::Contains(const RawTile &tile)
+{
+    QMutexLocker locker(&mutex);
+
+    return cache.contains(tile);
+}
+
+void KiberTileCache::AddTile(const RawTile &tile, const QImage &image)
+{
+    QMutexLocker locker(&mutex);
+    int count = cache.count();
+
+    if (!cache.contains(tile)) {
+        ++count;
     }
+    // the least recently used tiles are dropped until the new one fits
+    cache.insert(tile, new QImage(image), image.byteCount());
+    evictions += count - cache.count();
 #ifdef DEBUG_MEMORY_CACHE
-    qDebug() << "Cleaning Memory cache=" << " ended with " << cachequeue.count() << " tile " << "ocupying " << memoryCacheSize << " bytes";
+    qDebug() << "Current memory=" << cache.totalCost() << " in " << cache.count() << " tiles";
 #endif
 }
+
+void KiberTileCache::Statistics(int &hits, int &misses, int &evictions)
+{
+    QMutexLocker locker(&mutex);
+
+    hits      = this->hits;
+    misses    = this->misses;
+    evictions = this->evictions;
+}
 }
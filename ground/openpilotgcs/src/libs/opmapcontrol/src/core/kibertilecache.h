@@ -29,28 +29,35 @@
 
 #include "rawtile.h"
 #include <QMutex>
-#include <QReadWriteLock>
-#include <QQueue>
+#include <QCache>
+#include <QImage>
 #include <QDebug>
 #include "debugheader.h"
 namespace core {
+/**
+ * Least recently used cache of decoded tiles, bounded by the bytes of image
+ * data it holds. Tiles are stored ready to be drawn so a redraw of the map
+ * never decodes them again.
+ */
 class KiberTileCache {
 public:
     KiberTileCache();
 
     void setMemoryCacheCapacity(const int &value);
     int MemoryCacheCapacity();
-    double MemoryCacheSize()
-    {
-        return memoryCacheSize / 1048576.0;
-    }
-    void RemoveMemoryOverload();
-    QReadWriteLock kiberCacheLock;
-    QHash <RawTile, QByteArray> cachequeue;
-    QQueue <RawTile> list;
-    long memoryCacheSize;
+    double MemoryCacheSize();
+    int MemoryCacheCount();
+    QImage GetTile(const RawTile &tile);
+    bool Contains(const RawTile &tile);
+    void AddTile(const RawTile &tile, const QImage &image);
+    void Statistics(int &hits, int &misses, int &evictions);
 private:
+    QMutex mutex;
+    QCache<RawTile, QImage> cache;
     int _MemoryCacheCapacity;
+    int hits;
+    int misses;
+    int evictions;
 };
 }
 #endif // KIBERTILECACHE_H
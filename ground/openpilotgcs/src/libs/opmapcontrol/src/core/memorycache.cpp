@@ -25,33 +25,22 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 #include "memorycache.h"
-// TODO add readwrite lock
 
 namespace core {
 MemoryCache::MemoryCache()
 {}
 
 
-QByteArray MemoryCache::GetTileFromMemoryCache(const RawTile &tile)
+QImage MemoryCache::GetTileFromMemoryCache(const RawTile &tile)
 {
-    kiberCacheLock.lockForRead();
-    QByteArray pic;
-    pic = TilesInMemory.cachequeue.value(tile);
-    // TilesInMemory.find(key,&pic);
-    kiberCacheLock.unlock();
-    return pic;
+    return TilesInMemory.GetTile(tile);
 }
-void MemoryCache::AddTileToMemoryCache(const RawTile &tile, const QByteArray &pic)
+bool MemoryCache::IsTileInMemoryCache(const RawTile &tile)
 {
-    kiberCacheLock.lockForWrite();
-    // QPixmapCache::Key key=TilesInMemory.insert(pic);
-    TilesInMemory.memoryCacheSize += pic.size();
-#ifdef DEBUG_MEMORY_CACHE
-    qDebug() << "Current memory=" << TilesInMemory.memoryCacheSize << " in " << TilesInMemory.cachequeue.count() << " tiles";
-#endif
-    TilesInMemory.cachequeue.insert(tile, pic);
-    TilesInMemory.list.enqueue(tile);
-
-    kiberCacheLock.unlock();
+    return TilesInMemory.Contains(tile);
+}
+void MemoryCache::AddTileToMemoryCache(const RawTile &tile, const QImage &pic)
+{
+    TilesInMemory.AddTile(tile, pic);
 }
 }
@@ -28,9 +28,7 @@
 #define MEMORYCACHE_H
 
 #include "rawtile.h"
-#include <QMutex>
-#include <QReadWriteLock>
-#include <QQueue>
+#include <QImage>
 #include "kibertilecache.h"
 #include <QDebug>
 #include "debugheader.h"
@@ -40,9 +38,9 @@ public:
     MemoryCache();
 
     KiberTileCache TilesInMemory;
-    QByteArray GetTileFromMemoryCache(const RawTile &tile);
-    void AddTileToMemoryCache(const RawTile &tile, const QByteArray &pic);
-    QReadWriteLock kiberCacheLock;
+    QImage GetTileFromMemoryCache(const RawTile &tile);
+    bool IsTileInMemoryCache(const RawTile &tile);
+    void AddTileToMemoryCache(const RawTile &tile, const QImage &pic);
 };
 }
 #endif // MEMORYCACHE_H
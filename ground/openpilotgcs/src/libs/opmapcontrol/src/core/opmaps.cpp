@@ -63,184 +63,156 @@ QByteArray OPMaps::GetImageFrom(const MapType::Types &type, const Point &pos, co
 #endif // DEBUG_GMAPS
     QByteArray ret;
 
-    if (useMemoryCache) {
+    if (accessmode != (AccessMode::ServerOnly)) {
 #ifdef DEBUG_GMAPS
-        qDebug() << "Try Tile from memory:Size=" << TilesInMemory.MemoryCacheSize();
+        qDebug() << "Try tile from DataBase";
 #endif // DEBUG_GMAPS
-        ret = GetTileFromMemoryCache(RawTile(type, pos, zoom));
+        ret = Cache::Instance()->ImageCache.GetImageFromCache(type, pos, zoom);
         if (!ret.isEmpty()) {
             errorvars.lock();
-            ++diag.tilesFromMem;
+            ++diag.tilesFromDB;
             errorvars.unlock();
-        }
-    }
-    if (ret.isEmpty()) {
-#ifdef DEBUG_GMAPS
-        qDebug() << "Tile not in memory";
-#endif // DEBUG_GMAPS
-        if (accessmode != (AccessMode::ServerOnly)) {
-#ifdef DEBUG_GMAPS
-            qDebug() << "Try tile from DataBase";
-#endif // DEBUG_GMAPS
-            ret = Cache::Instance()->ImageCache.GetImageFromCache(type, pos, zoom);
-            if (!ret.isEmpty()) {
-                errorvars.lock();
-                ++diag.tilesFromDB;
-                errorvars.unlock();
 #ifdef DEBUG_GMAPS
-                qDebug() << "Tile found in Database";
+            qDebug() << "Tile found in Database";
 #endif // DEBUG_GMAPS
-                if (useMemoryCache) {
-#ifdef DEBUG_GMAPS
-                    qDebug() << "Add Tile to memory";
-#endif // DEBUG_GMAPS
-                    AddTileToMemoryCache(RawTile(type, pos, zoom), ret);
-                }
-                return ret;
-            }
+            return ret;
         }
-        if (accessmode != AccessMode::CacheOnly) {
-            QEventLoop q;
-            QNetworkReply *reply;
-            QNetworkRequest qheader;
-            QNetworkAccessManager network;
-            QTimer tT;
-            tT.setSingleShot(true);
-            connect(&network, SIGNAL(finished(QNetworkReply *)),
-                    &q, SLOT(quit()));
-            connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
-            network.setProxy(Proxy);
+    }
+    if (accessmode != AccessMode::CacheOnly) {
+        QEventLoop q;
+        QNetworkReply *reply;
+        QNetworkRequest qheader;
+        QNetworkAccessManager network;
+        QTimer tT;
+        tT.setSingleShot(true);
+        connect(&network, SIGNAL(finished(QNetworkReply *)),
+                &q, SLOT(quit()));
+        connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
+        network.setProxy(Proxy);
 #ifdef DEBUG_GMAPS
-            qDebug() << "Try Tile from the Internet";
+        qDebug() << "Try Tile from the Internet";
 #endif // DEBUG_GMAPS
 #ifdef DEBUG_TIMINGS
-            qDebug() << "opmaps before make image url" << time.elapsed();
+        qDebug() << "opmaps before make image url" << time.elapsed();
 #endif
-            QString url = MakeImageUrl(type, pos, zoom, LanguageStr);
+        QString url = MakeImageUrl(type, pos, zoom, LanguageStr);
 #ifdef DEBUG_TIMINGS
-            qDebug() << "opmaps after make image url" << time.elapsed();
+        qDebug() << "opmaps after make image url" << time.elapsed();
 #endif // url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
-       // "http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
-            qheader.setUrl(QUrl(url));
-            qheader.setRawHeader("User-Agent", UserAgent);
-            qheader.setRawHeader("Accept", "*/*");
-            switch (type) {
-            case MapType::GoogleMap:
-            case MapType::GoogleSatellite:
-            case MapType::GoogleLabels:
-            case MapType::GoogleTerrain:
-            case MapType::GoogleHybrid:
-            {
-                qheader.setRawHeader("Referrer", "http://maps.google.com/");
-            }
-            break;
+        // "http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
+        qheader.setUrl(QUrl(url));
+        qheader.setRawHeader("User-Agent", UserAgent);
+        qheader.setRawHeader("Accept", "*/*");
+        switch (type) {
+        case MapType::GoogleMap:
+        case MapType::GoogleSatellite:
+        case MapType::GoogleLabels:
+        case MapType::GoogleTerrain:
+        case MapType::GoogleHybrid:
+        {
+            qheader.setRawHeader("Referrer", "http://maps.google.com/");
+        }
+        break;
 
-            case MapType::GoogleMapChina:
-            case MapType::GoogleSatelliteChina:
-            case MapType::GoogleLabelsChina:
-            case MapType::GoogleTerrainChina:
-            case MapType::GoogleHybridChina:
-            {
-                qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
-            }
-            break;
+        case MapType::GoogleMapChina:
+        case MapType::GoogleSatelliteChina:
+        case MapType::GoogleLabelsChina:
+        case MapType::GoogleTerrainChina:
+        case MapType::GoogleHybridChina:
+        {
+            qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
+        }
+        break;
 
-            case MapType::BingHybrid:
-            case MapType::BingMap:
-            case MapType::BingSatellite:
-            {
-                qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
-            }
-            break;
+        case MapType::BingHybrid:
+        case MapType::BingMap:
+        case MapType::BingSatellite:
+        {
+            qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
+        }
+        break;
 
-            case MapType::YahooHybrid:
-            case MapType::YahooLabels:
-            case MapType::YahooMap:
-            case MapType::YahooSatellite:
-            {
-                qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
-            }
-            break;
+        case MapType::YahooHybrid:
+        case MapType::YahooLabels:
+        case MapType::YahooMap:
+        case MapType::YahooSatellite:
+        {
+            qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
+        }
+        break;
 
-            case MapType::ArcGIS_MapsLT_Map_Labels:
-            case MapType::ArcGIS_MapsLT_Map:
-            case MapType::ArcGIS_MapsLT_OrtoFoto:
-            case MapType::ArcGIS_MapsLT_Map_Hybrid:
-            {
-                qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
-            }
-            break;
+        case MapType::ArcGIS_MapsLT_Map_Labels:
+        case MapType::ArcGIS_MapsLT_Map:
+        case MapType::ArcGIS_MapsLT_OrtoFoto:
+        case MapType::ArcGIS_MapsLT_Map_Hybrid:
+        {
+            qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
+        }
+        break;
 
-            case MapType::OpenStreetMapSurfer:
-            case MapType::OpenStreetMapSurferTerrain:
-            {
-                qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
-            }
-            break;
+        case MapType::OpenStreetMapSurfer:
+        case MapType::OpenStreetMapSurferTerrain:
+        {
+            qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
+        }
+        break;
 
-            case MapType::OpenStreetMap:
-            case MapType::OpenStreetOsm:
-            {
-                qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
-            }
-            break;
+        case MapType::OpenStreetMap:
+        case MapType::OpenStreetOsm:
+        {
+            qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
+        }
+        break;
 
-            case MapType::YandexMapRu:
-            {
-                qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
-            }
+        case MapType::YandexMapRu:
+        {
+            qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
+        }
+        break;
+        default:
             break;
-            default:
-                break;
-            }
-            reply = network.get(qheader);
-            tT.start(Timeout);
-            q.exec();
+        }
+        reply = network.get(qheader);
+        tT.start(Timeout);
+        q.exec();
 
-            if (!tT.isActive()) {
-                errorvars.lock();
-                ++diag.timeouts;
-                errorvars.unlock();
-                return ret;
-            }
-            tT.stop();
-            if ((reply->error() != QNetworkReply::NoError)) {
-                errorvars.lock();
-                ++diag.networkerrors;
-                errorvars.unlock();
-                reply->deleteLater();
-                return ret;
-            }
-            ret = reply->readAll();
-            reply->deleteLater(); // TODO can't this be global??
-            if (ret.isEmpty()) {
-#ifdef DEBUG_GMAPS
-                qDebug() << "Invalid Tile";
-#endif // DEBUG_GMAPS
-                errorvars.lock();
-                ++diag.emptytiles;
-                errorvars.unlock();
-                return ret;
-            }
+        if (!tT.isActive()) {
+            errorvars.lock();
+            ++diag.timeouts;
+            errorvars.unlock();
+            return ret;
+        }
+        tT.stop();
+        if ((reply->error() != QNetworkReply::NoError)) {
+            errorvars.lock();
+            ++diag.networkerrors;
+            errorvars.unlock();
+            reply->deleteLater();
+            return ret;
+        }
+        ret = reply->readAll();
+        reply->deleteLater(); // TODO can't this be global??
+        if (ret.isEmpty()) {
 #ifdef DEBUG_GMAPS
-            qDebug() << "Received Tile from the Internet";
+            qDebug() << "Invalid Tile";
 #endif // DEBUG_GMAPS
             errorvars.lock();
-            ++diag.tilesFromNet;
+            ++diag.emptytiles;
             errorvars.unlock();
-            if (useMemoryCache) {
+            return ret;
+        }
 #ifdef DEBUG_GMAPS
-                qDebug() << "Add Tile to memory cache";
+        qDebug() << "Received Tile from the Internet";
 #endif // DEBUG_GMAPS
-                AddTileToMemoryCache(RawTile(type, pos, zoom), ret);
-            }
-            if (accessmode != AccessMode::ServerOnly) {
+        errorvars.lock();
+        ++diag.tilesFromNet;
+        errorvars.unlock();
+        if (accessmode != AccessMode::ServerOnly) {
 #ifdef DEBUG_GMAPS
-                qDebug() << "Add tile to DataBase";
+            qDebug() << "Add tile to DataBase";
 #endif // DEBUG_GMAPS
-                CacheItemQueue *item = new CacheItemQueue(type, pos, ret, zoom);
-                TileDBcacheQueue.EnqueueCacheTask(item);
-            }
+            CacheItemQueue *item = new CacheItemQueue(type, pos, ret, zoom);
+            TileDBcacheQueue.EnqueueCacheTask(item);
         }
     }
 #ifdef DEBUG_GMAPS
@@ -249,6 +221,66 @@ QByteArray OPMaps::GetImageFrom(const MapType::Types &type, const Point &pos, co
     return ret;
 }
 
+/**
+ * Returns the decoded tile, from the memory cache when possible. Tiles loaded
+ * from the database or the network are decoded once and kept in memory.
+ */
+QImage OPMaps::GetTileImage(const MapType::Types &type, const Point &pos, const int &zoom)
+{
+    RawTile tile(type, pos, zoom);
+    QImage image;
+
+    if (useMemoryCache) {
+#ifdef DEBUG_GMAPS
+        qDebug() << "Try Tile from memory:Size=" << TilesInMemory.MemoryCacheSize();
+#endif // DEBUG_GMAPS
+        image = GetTileFromMemoryCache(tile);
+        if (!image.isNull()) {
+            return image;
+        }
+    }
+    QByteArray data = GetImageFrom(type, pos, zoom);
+    if (!data.isEmpty()) {
+        image = PureImageProxy::Decode(data);
+        if (useMemoryCache && !image.isNull()) {
+#ifdef DEBUG_GMAPS
+            qDebug() << "Add Tile to memory cache";
+#endif // DEBUG_GMAPS
+            AddTileToMemoryCache(tile, image);
+        }
+    }
+    return image;
+}
+
+/**
+ * Loads a tile from the database into the memory cache ahead of its use.
+ * Prefetching never goes to the network, tiles not in the database are
+ * loaded as usual once they are shown.
+ *
+ * @return true if the tile was added to the memory cache
+ */
+bool OPMaps::PrefetchTile(const MapType::Types &type, const Point &pos, const int &zoom)
+{
+    RawTile tile(type, pos, zoom);
+
+    if (!useMemoryCache || accessmode == AccessMode::ServerOnly || IsTileInMemoryCache(tile)) {
+        return false;
+    }
+    QByteArray data = Cache::Instance()->ImageCache.GetImageFromCache(type, pos, zoom);
+    if (data.isEmpty()) {
+        return false;
+    }
+    QImage image = PureImageProxy::Decode(data);
+    if (image.isNull()) {
+        return false;
+    }
+    AddTileToMemoryCache(tile, image);
+    errorvars.lock();
+    ++diag.tilesPrefetched;
+    errorvars.unlock();
+    return true;
+}
+
 bool OPMaps::ExportToGMDB(const QString &file)
 {
     return Cache::Instance()->ImageCache.ExportMapDataToDB(Cache::Instance()->ImageCache.GtileCache() + QDir::separator() + "Data.qmdb", file);
@@ -265,6 +297,10 @@ diagnostics OPMaps::GetDiagnostics()
     errorvars.lock();
     i = diag;
     errorvars.unlock();
+    // the memory cache keeps its own hit and miss counts
+    TilesInMemory.Statistics(i.tilesFromMem, i.memoryMisses, i.memoryEvictions);
+    i.memoryTiles  = TilesInMemory.MemoryCacheCount();
+    i.memoryUsedMB = TilesInMemory.MemoryCacheSize();
     return i;
 }
 }
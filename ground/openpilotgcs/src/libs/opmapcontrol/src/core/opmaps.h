@@ -40,6 +40,7 @@
 #include "alllayersoftype.h"
 #include "urlfactory.h"
 #include "diagnostics.h"
+#include "pureimage.h"
 
 // #include "point.h"
 
@@ -57,6 +58,8 @@ public: ~OPMaps();
 
 
     QByteArray GetImageFrom(const MapType::Types &type, const core::Point &pos, const int &zoom);
+    QImage GetTileImage(const MapType::Types &type, const core::Point &pos, const int &zoom);
+    bool PrefetchTile(const MapType::Types &type, const core::Point &pos, const int &zoom);
     bool UseMemoryCache()
     {
         return useMemoryCache;
@@ -31,13 +31,39 @@
 namespace core {
 qlonglong PureImageCache::ConnCounter = 0;
 
-PureImageCache::PureImageCache()
+PureImageCacheConnection::PureImageCacheConnection() : generation(-1), selectTile(NULL), insertTile(NULL), insertTileData(NULL)
+{}
+
+PureImageCacheConnection::~PureImageCacheConnection()
+{
+    close();
+}
+
+void PureImageCacheConnection::close()
+{
+    // the queries and the database handle must be gone before the connection is removed
+    delete selectTile;
+    delete insertTile;
+    delete insertTileData;
+    selectTile     = NULL;
+    insertTile     = NULL;
+    insertTileData = NULL;
+    if (!name.isEmpty()) {
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+        name.clear();
+    }
+}
+
+PureImageCache::PureImageCache() : generation(0)
 {}
 
 void PureImageCache::setGtileCache(const QString &value)
 {
     lock.lockForWrite();
     gtilecache = value;
+    ++generation;
     QDir d;
     if (!d.exists(gtilecache)) {
         d.mkdir(gtilecache);
@@ -154,132 +180,183 @@ bool PureImageCache::CreateEmptyDB(const QString &file)
         db.close();
         return false;
     }
+    query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
     db.close();
     QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
     return true;
 }
+
+/**
+ * Get the connection of the calling thread to the cache database, opening it on first use
+ * and after a change of the cache location. Must be called with the lock held.
+ * @returns The connection or NULL if the database can not be opened
+ */
+PureImageCacheConnection *PureImageCache::Connection()
+{
+    PureImageCacheConnection *conn = connections.localData();
+
+    if (conn && conn->generation == generation) {
+        return conn->name.isEmpty() ? NULL : conn;
+    }
+    if (!conn) {
+        // deleted by QThreadStorage when the thread exits
+        conn = new PureImageCacheConnection();
+        connections.setLocalData(conn);
+    }
+    conn->close();
+    conn->generation = generation;
+
+    Mcounter.lock();
+    qlonglong id = ++ConnCounter;
+    Mcounter.unlock();
+    conn->name = QString("PureImageCache%1").arg(id);
+    conn->db   = QSqlDatabase::addDatabase("QSQLITE", conn->name);
+    conn->db.setDatabaseName(gtilecache + "Data.qmdb");
+    // readers do not block in WAL mode, the writer waits for the other writers
+    conn->db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (!conn->db.open()) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "Connection: Unable to open database" << conn->db.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        conn->close();
+        return NULL;
+    }
+    {
+        QSqlQuery query(conn->db);
+        query.exec("PRAGMA journal_mode=WAL");
+        query.exec("PRAGMA synchronous=NORMAL");
+        // databases created by older versions have no index
+        query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+    }
+    conn->selectTile = new QSqlQuery(conn->db);
+    conn->selectTile->setForwardOnly(true);
+    conn->selectTile->prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=? LIMIT 1)");
+    conn->insertTile = new QSqlQuery(conn->db);
+    conn->insertTile->prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+    conn->insertTileData = new QSqlQuery(conn->db);
+    conn->insertTileData->prepare("INSERT INTO TilesData(id, Tile) VALUES(?, ?)");
+    return conn;
+}
+
+bool PureImageCache::InsertTile(PureImageCacheConnection *conn, const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom)
+{
+    conn->insertTile->addBindValue(pos.X());
+    conn->insertTile->addBindValue(pos.Y());
+    conn->insertTile->addBindValue(zoom);
+    conn->insertTile->addBindValue((int)type);
+    conn->insertTile->addBindValue(QDateTime::currentDateTime().toString());
+    if (!conn->insertTile->exec()) {
+        return false;
+    }
+    conn->insertTileData->addBindValue(conn->insertTile->lastInsertId());
+    conn->insertTileData->addBindValue(tile);
+    return conn->insertTileData->exec();
+}
 bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom)
 {
+    QReadLocker locker(&lock);
+
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
         return false;
     }
-    lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
     qDebug() << "PutImageToCache Start:"; // <<pos;
 #endif // DEBUG_PUREIMAGECACHE
-    Mcounter.lock();
-    qlonglong id = ++ConnCounter;
-    Mcounter.unlock();
-    {
-        QSqlDatabase cn;
-        cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-        QString db = gtilecache + "Data.qmdb";
-        cn.setDatabaseName(db);
-        cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-        if (cn.open()) {
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                query.addBindValue(pos.X());
-                query.addBindValue(pos.Y());
-                query.addBindValue(zoom);
+    PureImageCacheConnection *conn = Connection();
+    if (!conn) {
+        return false;
+    }
+    return InsertTile(conn, tile, type, pos, zoom);
+}
 
-                query.addBindValue((int)type);
-                query.addBindValue(QDateTime::currentDateTime().toString());
-                query.exec();
-            }
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                query.addBindValue(tile);
-                query.exec();
-            }
-            cn.close();
+/**
+ * Store several tiles in a single transaction
+ */
+bool PureImageCache::PutImagesToCache(QList<CacheItemQueue *> &tiles)
+{
+    QReadLocker locker(&lock);
+
+    if (gtilecache.isEmpty() | gtilecache.isNull()) {
+        return false;
+    }
+    PureImageCacheConnection *conn = Connection();
+    if (!conn) {
+        return false;
+    }
+    if (!conn->db.transaction()) {
+        return false;
+    }
+    foreach(CacheItemQueue * task, tiles) {
+        if (!InsertTile(conn, task->GetImg(), task->GetMapType(), task->GetPosition(), task->GetZoom())) {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug() << "PutImagesToCache: " << conn->insertTile->lastError().driverText() << conn->insertTileData->lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
         }
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
-    lock.unlock();
-    return true;
+    return conn->db.commit();
 }
 QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
 {
-    lock.lockForRead();
+    QReadLocker locker(&lock);
     QByteArray ar;
+
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
         return ar;
     }
-    QString dir  = gtilecache;
-    Mcounter.lock();
-    qlonglong id = ++ConnCounter;
-    Mcounter.unlock();
 #ifdef DEBUG_PUREIMAGECACHE
-    qDebug() << "Cache dir=" << dir << " Try to GET:" << pos.X() + "," + pos.Y();
+    qDebug() << "Cache dir=" << gtilecache << " Try to GET:" << pos.X() + "," + pos.Y();
 #endif // DEBUG_PUREIMAGECACHE
 
-    {
-        QString db = dir + "Data.qmdb";
-        {
-            QSqlDatabase cn;
-
-            cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if (cn.open()) {
-                {
-                    QSqlQuery query(cn);
-                    query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int)type));
-                    query.next();
-                    if (query.isValid()) {
-                        ar = query.value(0).toByteArray();
-                    }
-                }
-                cn.close();
-            }
-        }
+    PureImageCacheConnection *conn = Connection();
+    if (!conn) {
+        return ar;
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
-    lock.unlock();
+    conn->selectTile->addBindValue(pos.X());
+    conn->selectTile->addBindValue(pos.Y());
+    conn->selectTile->addBindValue(zoom);
+    conn->selectTile->addBindValue((int)type);
+    if (conn->selectTile->exec() && conn->selectTile->next()) {
+        ar = conn->selectTile->value(0).toByteArray();
+    }
+    // release the read transaction
+    conn->selectTile->finish();
     return ar;
 }
 void PureImageCache::deleteOlderTiles(int const & days)
 {
+    QReadLocker locker(&lock);
+
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
         return;
     }
     QList<long> add;
-    bool ret    = true;
-    QString dir = gtilecache;
+    if (!QFileInfo(gtilecache + "Data.qmdb").exists()) {
+        return;
+    }
+    PureImageCacheConnection *conn = Connection();
+    if (!conn) {
+        return;
+    }
     {
-        QString db = dir + "Data.qmdb";
-        ret = QFileInfo(db).exists();
-        if (ret) {
-            QSqlDatabase cn;
-            Mcounter.lock();
-            qlonglong id = ++ConnCounter;
-            Mcounter.unlock();
-            cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if (cn.open()) {
-                {
-                    QSqlQuery query(cn);
-                    query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                    while (query.next()) {
-                        if (QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime()) > days) {
-                            add.append(query.value(0).toLongLong());
-                        }
-                    }
-                    foreach(long i, add) {
-                        query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                    }
-                }
-
-                cn.close();
+        QSqlQuery query(conn->db);
+        query.setForwardOnly(true);
+        query.exec(QString("SELECT id, Date FROM Tiles"));
+        while (query.next()) {
+            if (QDateTime::fromString(query.value(1).toString()).daysTo(QDateTime::currentDateTime()) > days) {
+                add.append(query.value(0).toLongLong());
             }
-            QSqlDatabase::removeDatabase(QString::number(id));
         }
     }
+    if (!add.isEmpty()) {
+        QSqlQuery query(conn->db);
+        query.prepare("DELETE FROM Tiles WHERE id = ?");
+        conn->db.transaction();
+        foreach(long i, add) {
+            query.addBindValue((qlonglong)i);
+            query.exec();
+        }
+        conn->db.commit();
+    }
 }
 // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
 bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
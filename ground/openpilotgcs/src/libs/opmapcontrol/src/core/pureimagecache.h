@@ -39,24 +39,48 @@
 #include "point.h"
 #include <QVariant>
 #include "pureimage.h"
+#include "cacheitemqueue.h"
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
 namespace core {
+/**
+ * Connection of one thread to the cache database, kept open with its prepared statements
+ */
+class PureImageCacheConnection {
+public:
+    PureImageCacheConnection();
+    ~PureImageCacheConnection();
+    void close();
+    QString name;
+    int generation;
+    QSqlDatabase db;
+    QSqlQuery *selectTile;
+    QSqlQuery *insertTile;
+    QSqlQuery *insertTileData;
+};
+
 class PureImageCache {
 public:
     PureImageCache();
     static bool CreateEmptyDB(const QString &file);
     bool PutImageToCache(const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom);
+    bool PutImagesToCache(QList<CacheItemQueue *> &tiles);
     QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
     QString GtileCache();
     void setGtileCache(const QString &value);
     static bool ExportMapDataToDB(QString sourceFile, QString destFile);
     void deleteOlderTiles(int const & days);
 private:
+    PureImageCacheConnection *Connection();
+    bool InsertTile(PureImageCacheConnection *conn, const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom);
     QString gtilecache;
+    // incremented when the cache location changes, connections to the old database are reopened
+    int generation;
     QMutex Mcounter;
     QReadWriteLock lock;
+    QThreadStorage<PureImageCacheConnection *> connections;
     static qlonglong ConnCounter;
 };
 }
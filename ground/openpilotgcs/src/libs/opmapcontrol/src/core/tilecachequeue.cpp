@@ -71,20 +71,22 @@ void TileCacheQueue::run()
     qDebug() << "Cache Engine Start";
 #endif // DEBUG_TILECACHEQUEUE
     while (true) {
-        CacheItemQueue *task;
+        QList<CacheItemQueue *> tasks;
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug() << "Cache";
 #endif // DEBUG_TILECACHEQUEUE
-        if (tileCacheQueue.count() > 0) {
-            mutex.lock();
-            task = tileCacheQueue.dequeue();
-            mutex.unlock();
+        // take all the queued tiles, they are written in one transaction
+        mutex.lock();
+        while (!tileCacheQueue.isEmpty() && tasks.count() < MAX_BATCH_SIZE) {
+            tasks.append(tileCacheQueue.dequeue());
+        }
+        mutex.unlock();
+        if (!tasks.isEmpty()) {
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug() << "Cache engine Put:" << task->GetPosition().X() << "," << task->GetPosition().Y();
+            qDebug() << "Cache engine Put:" << tasks.count() << "tiles";
 #endif // DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(), task->GetMapType(), task->GetPosition(), task->GetZoom());
-            usleep(44);
-            delete task;
+            Cache::Instance()->ImageCache.PutImagesToCache(tasks);
+            qDeleteAll(tasks);
         } else {
             qDebug() << "Cache engine BEGIN WAIT";
             waitmutex.lock();
@@ -49,6 +49,7 @@ public:
 protected:
     QQueue<CacheItemQueue *> tileCacheQueue;
 private:
+    static const int MAX_BATCH_SIZE = 64;
     void run();
     QMutex mutex;
     QMutex waitmutex;
@@ -109,27 +109,27 @@ void Core::run()
                             int retry = 0;
 
                             do {
-                                QByteArray img;
+                                QImage img;
 
                                 // tile number inversion(BottomLeft -> TopLeft) for pergo maps
                                 if (tl == MapType::PergoTurkeyMap) {
-                                    img = OPMaps::Instance()->GetImageFrom(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
+                                    img = OPMaps::Instance()->GetTileImage(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
                                 } else { // ok
 #ifdef DEBUG_CORE
                                     qDebug() << "start getting image" << " ID=" << debug;
 #endif // DEBUG_CORE
-                                    img = OPMaps::Instance()->GetImageFrom(tl, task.Pos, task.Zoom);
+                                    img = OPMaps::Instance()->GetTileImage(tl, task.Pos, task.Zoom);
 #ifdef DEBUG_CORE
-                                    qDebug() << "Core::run:gotimage size:" << img.count() << " ID=" << debug << " time=" << t.elapsed();
+                                    qDebug() << "Core::run:gotimage size:" << img.byteCount() << " ID=" << debug << " time=" << t.elapsed();
 #endif // DEBUG_CORE
                                 }
 
-                                if (img.length() != 0) {
+                                if (!img.isNull()) {
                                     Moverlays.lock();
                                     {
                                         t->Overlays.append(img);
 #ifdef DEBUG_CORE
-                                        qDebug() << "Core::run append img:" << img.length() << " to tile:" << t->GetPos().ToString() << " now has " << t->Overlays.count() << " overlays" << " ID=" << debug;
+                                        qDebug() << "Core::run append img:" << img.byteCount() << " to tile:" << t->GetPos().ToString() << " now has " << t->Overlays.count() << " overlays" << " ID=" << debug;
 #endif // DEBUG_CORE
                                     }
                                     Moverlays.unlock();
@@ -173,10 +173,6 @@ void Core::run()
                 {
                     // last buddy cleans stuff ;}
                     if (last) {
-                        OPMaps::Instance()->kiberCacheLock.lockForWrite();
-                        OPMaps::Instance()->TilesInMemory.RemoveMemoryOverload();
-                        OPMaps::Instance()->kiberCacheLock.unlock();
-
                         MtileDrawingList.lock();
                         {
                             Matrix.ClearPointsNotIn(tileDrawingList);
@@ -196,6 +192,11 @@ void Core::run()
 #endif
             emit OnTilesStillToLoad(tilesToload < 0 ? 0 : tilesToload);
             loaderLimit.release();
+
+            // the visible tiles are loaded, warm the memory cache for panning and zooming
+            if (last) {
+                PrefetchTilesAround();
+            }
         }
     }
     MrunningThreads.lock();
@@ -615,6 +616,89 @@ void Core::FindTilesAround(QList<Point> &list)
         }
     }
 }
+/**
+ * Loads the tiles the map is likely to show next into the memory cache: the
+ * ring just outside of the drawn area and the tiles around the center at the
+ * zoom levels above and below. Stops as soon as new tiles are to be loaded.
+ */
+void Core::PrefetchTilesAround()
+{
+    QList<Point> ring;
+    QList<Point> zoomOut;
+    QList<Point> zoomIn;
+    int z;
+    Point center;
+    Size area;
+
+    MtileDrawingList.lock();
+    z      = Zoom();
+    center = centerTileXYLocation;
+    area   = sizeOfMapArea;
+    MtileDrawingList.unlock();
+
+    for (int i = -area.Width() - 1; i <= area.Width() + 1; i++) {
+        for (int j = -area.Height() - 1; j <= area.Height() + 1; j++) {
+            if (qAbs(i) > area.Width() || qAbs(j) > area.Height()) {
+                ring.append(Point(center.X() + i, center.Y() + j));
+            }
+        }
+    }
+    // a tile covers four tiles of the next zoom level, half of the area is enough when zooming out
+    for (int i = -area.Width() / 2 - 1; i <= area.Width() / 2 + 1; i++) {
+        for (int j = -area.Height() / 2 - 1; j <= area.Height() / 2 + 1; j++) {
+            zoomOut.append(Point(center.X() / 2 + i, center.Y() / 2 + j));
+        }
+    }
+    for (int i = -1; i <= 1; i++) {
+        for (int j = -1; j <= 1; j++) {
+            for (int k = 0; k < 4; k++) {
+                zoomIn.append(Point((center.X() + i) * 2 + k % 2, (center.Y() + j) * 2 + k / 2));
+            }
+        }
+    }
+
+    if (!PrefetchTiles(ring, z)) {
+        return;
+    }
+    if (z > 0 && !PrefetchTiles(zoomOut, z - 1)) {
+        return;
+    }
+    if (z < MaxZoom()) {
+        PrefetchTiles(zoomIn, z + 1);
+    }
+}
+
+/**
+ * @return false if prefetching was abandoned for new tiles to load
+ */
+bool Core::PrefetchTiles(const QList<Point> &list, const int &zoom)
+{
+    Size min = Projection()->GetTileMatrixMinXY(zoom);
+    Size max = Projection()->GetTileMatrixMaxXY(zoom);
+    QVector<MapType::Types> layers = OPMaps::Instance()->GetAllLayersOfType(GetMapType());
+
+    foreach(Point p, list) {
+        if (p.X() < min.Width() || p.Y() < min.Height() || p.X() > max.Width() || p.Y() > max.Height()) {
+            continue;
+        }
+        foreach(MapType::Types tl, layers) {
+            MtileToload.lock();
+            bool busy = (tilesToload > 0);
+            MtileToload.unlock();
+            if (busy) {
+                return false;
+            }
+            // tile number inversion(BottomLeft -> TopLeft) for pergo maps
+            if (tl == MapType::PergoTurkeyMap) {
+                OPMaps::Instance()->PrefetchTile(tl, Point(p.X(), max.Height() - p.Y()), zoom);
+            } else {
+                OPMaps::Instance()->PrefetchTile(tl, p, zoom);
+            }
+        }
+    }
+    return true;
+}
+
 void Core::UpdateGroundResolution()
 {
     double rez = Projection()->GetGroundResolution(Zoom(), CurrentPosition().Lat());
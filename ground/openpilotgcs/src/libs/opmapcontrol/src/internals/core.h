@@ -319,6 +319,8 @@ signals:
 private:
 
     void keepInBounds();
+    void PrefetchTilesAround();
+    bool PrefetchTiles(const QList<core::Point> &list, const int &zoom);
     PointLatLng currentPosition;
     core::Point currentPositionPixel;
     core::Point renderOffset;
@@ -66,7 +66,7 @@ public:
     {
         return !(zoom == 0);
     }
-    QList<QByteArray> Overlays;
+    QList<QImage> Overlays;
 protected:
 
     QMutex mutex;
@@ -52,6 +52,17 @@ public:
      * \return         The updated crc value.
      */
     static quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
+
+    /**
+     * Update a 32-bit crc value with new data, using the same polynomial
+     * and bit order as the flight side PIOS_CRC32_updateCRC().
+     *
+     * \param crc      The current crc value.
+     * \param data     Pointer to a buffer of \a data_len bytes.
+     * \param length   Number of bytes in the \a data buffer.
+     * \return         The updated crc value.
+     */
+    static quint32 updateCRC32(quint32 crc, const quint8 *data, qint32 length);
 };
 } // namespace Utils
 
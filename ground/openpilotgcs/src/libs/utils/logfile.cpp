@@ -2,12 +2,17 @@
 #include <QDebug>
 #include <QtGlobal>
 
+#include <algorithm>
+
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
-    m_lastTimeStamp(0),
+    m_dataBufferPos(0),
+    m_logData(NULL),
+    m_nextPacket(0),
     m_lastPlayed(0),
     m_timeOffset(0),
     m_playbackSpeed(1.0),
+    m_replayFastMode(false),
     m_nextTimeStamp(0),
     m_useProvidedTimeStamp(false)
 {
@@ -54,6 +59,13 @@ void LogFile::close()
     if (m_timer.isActive()) {
         m_timer.stop();
     }
+    if (m_logData && m_logContents.isEmpty()) {
+        m_file.unmap(const_cast<uchar *>(m_logData));
+    }
+    m_logData = NULL;
+    m_logContents.clear();
+    m_index.clear();
+    m_nextPacket = 0;
     m_file.close();
     QIODevice::close();
 }
@@ -82,84 +94,144 @@ qint64 LogFile::writeData(const char *data, qint64 dataSize)
 qint64 LogFile::readData(char *data, qint64 maxSize)
 {
     QMutexLocker locker(&m_mutex);
-    qint64 toRead = qMin(maxSize, (qint64)m_dataBuffer.size());
+    qint64 toRead = qMin(maxSize, (qint64)(m_dataBuffer.size() - m_dataBufferPos));
+
+    memcpy(data, m_dataBuffer.constData() + m_dataBufferPos, toRead);
+    m_dataBufferPos += toRead;
 
-    memcpy(data, m_dataBuffer.data(), toRead);
-    m_dataBuffer.remove(0, toRead);
+    // Rewind instead of shifting the remaining data on every read
+    if (m_dataBufferPos == m_dataBuffer.size()) {
+        m_dataBuffer.clear();
+        m_dataBufferPos = 0;
+    }
     return toRead;
 }
 
 qint64 LogFile::bytesAvailable() const
 {
-    return m_dataBuffer.size();
+    return m_dataBuffer.size() - m_dataBufferPos;
+}
+
+/**
+ * Hand the next indexed packet to the reader.
+ * \return number of bytes queued
+ */
+qint64 LogFile::queuePacket()
+{
+    const IndexEntry &entry = m_index.at(m_nextPacket++);
+
+    QMutexLocker locker(&m_mutex);
+
+    // Drop the consumed part of the buffer once it dominates
+    if (m_dataBufferPos > 0 && m_dataBufferPos >= m_dataBuffer.size() / 2) {
+        m_dataBuffer.remove(0, m_dataBufferPos);
+        m_dataBufferPos = 0;
+    }
+    m_dataBuffer.append((const char *)m_logData + entry.offset, entry.size);
+    return entry.size;
 }
 
 void LogFile::timerFired()
 {
-    qint64 dataSize;
+    qint64 queued = 0;
 
-    if (m_file.bytesAvailable() > 4) {
-        int time;
-        time = m_myTime.elapsed();
+    if (m_replayFastMode) {
+        // Stream as fast as the reader keeps up, one chunk per event loop iteration
+        while (m_nextPacket < m_index.size() && queued < FAST_REPLAY_CHUNK) {
+            queued += queuePacket();
+        }
+        if (m_nextPacket > 0) {
+            m_lastPlayed = m_index.at(m_nextPacket - 1).timeStamp;
+        }
+        m_timeOffset = m_myTime.elapsed();
+    } else {
+        int time = m_myTime.elapsed();
+        m_lastPlayed += (time - m_timeOffset) * m_playbackSpeed;
+        m_timeOffset  = time;
 
-        // TODO: going back in time will be a problem
-        while ((m_lastPlayed + ((time - m_timeOffset) * m_playbackSpeed) > m_lastTimeStamp)) {
-            m_lastPlayed += ((time - m_timeOffset) * m_playbackSpeed);
-            if (m_file.bytesAvailable() < (qint64)sizeof(dataSize)) {
-                stopReplay();
-                return;
-            }
+        while (m_nextPacket < m_index.size() && m_index.at(m_nextPacket).timeStamp <= m_lastPlayed) {
+            queued += queuePacket();
+        }
+    }
 
-            m_file.read((char *)&dataSize, sizeof(dataSize));
+    if (queued > 0) {
+        emit readyRead();
+        emit replayPosition((quint32)m_lastPlayed);
+    }
 
-            if (dataSize < 1 || dataSize > (1024 * 1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
+    if (m_nextPacket >= m_index.size()) {
+        stopReplay();
+    }
+}
 
-            if (m_file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
+/**
+ * Scan the log once and record time stamp and location of every packet.
+ * The scan stops at the first record that looks corrupted, the same place
+ * where a sequential replay would have given up.
+ */
+bool LogFile::buildIndex()
+{
+    qint64 size = m_file.size();
 
-            m_mutex.lock();
-            m_dataBuffer.append(m_file.read(dataSize));
-            m_mutex.unlock();
+    m_logData = m_file.map(0, size);
+    if (!m_logData) {
+        // Fall back to reading the whole file, e.g. for devices that cannot be mapped
+        m_logContents = m_file.readAll();
+        m_logData     = (const uchar *)m_logContents.constData();
+        size = m_logContents.size();
+    }
 
-            emit readyRead();
+    m_index.clear();
 
-            if (m_file.bytesAvailable() < (qint64)sizeof(m_lastTimeStamp)) {
-                stopReplay();
-                return;
-            }
+    qint64 pos = 0;
+    quint32 timeStamp;
+    qint64 dataSize;
+    while (pos + (qint64)(sizeof(timeStamp) + sizeof(dataSize)) <= size) {
+        memcpy(&timeStamp, m_logData + pos, sizeof(timeStamp));
+        memcpy(&dataSize, m_logData + pos + sizeof(timeStamp), sizeof(dataSize));
+        pos += sizeof(timeStamp) + sizeof(dataSize);
 
-            int save = m_lastTimeStamp;
-            m_file.read((char *)&m_lastTimeStamp, sizeof(m_lastTimeStamp));
-            // some validity checks
-            if (m_lastTimeStamp < save // logfile goes back in time
-                || (m_lastTimeStamp - save) > (60 * 60 * 1000)) { // gap of more than 60 minutes)
-                qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << m_lastTimeStamp << " after " << save << "\n";
-                stopReplay();
-                return;
+        if (dataSize < 1 || dataSize > (1024 * 1024)) {
+            qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
+            break;
+        }
+        if (size - pos < dataSize) {
+            break;
+        }
+        if (!m_index.isEmpty()) {
+            quint32 save = m_index.last().timeStamp;
+            if (timeStamp < save // logfile goes back in time
+                || (timeStamp - save) > (60 * 60 * 1000)) { // gap of more than 60 minutes)
+                qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << timeStamp << " after " << save << "\n";
+                break;
             }
-
-            m_timeOffset = time;
-            time = m_myTime.elapsed();
         }
-    } else {
-        stopReplay();
+
+        IndexEntry entry;
+        entry.timeStamp = timeStamp;
+        entry.offset    = pos;
+        entry.size      = dataSize;
+        m_index.append(entry);
+
+        pos += dataSize;
     }
+
+    return !m_index.isEmpty();
 }
 
 bool LogFile::startReplay()
 {
     m_dataBuffer.clear();
+    m_dataBufferPos = 0;
+    if (!buildIndex()) {
+        stopReplay();
+        return false;
+    }
+    m_nextPacket = 0;
     m_myTime.restart();
     m_timeOffset = 0;
-    m_lastPlayed = 0;
-    m_file.read((char *)&m_lastTimeStamp, sizeof(m_lastTimeStamp));
-    m_timer.setInterval(10);
+    m_lastPlayed = m_index.first().timeStamp;
+    m_timer.setInterval(m_replayFastMode ? 0 : REPLAY_INTERVAL);
     m_timer.start();
     emit replayStarted();
     return true;
@@ -172,6 +244,46 @@ bool LogFile::stopReplay()
     return true;
 }
 
+quint32 LogFile::replayStartTime() const
+{
+    return m_index.isEmpty() ? 0 : m_index.first().timeStamp;
+}
+
+quint32 LogFile::replayEndTime() const
+{
+    return m_index.isEmpty() ? 0 : m_index.last().timeStamp;
+}
+
+bool LogFile::timeStampLessThan(const IndexEntry &entry, quint32 time)
+{
+    return entry.timeStamp < time;
+}
+
+/**
+ * Continue the replay at the first packet logged at or after \a time.
+ * Data queued but not yet read is discarded.
+ */
+bool LogFile::setReplayTime(quint32 time)
+{
+    if (m_index.isEmpty()) {
+        return false;
+    }
+
+    QVector<IndexEntry>::const_iterator it = std::lower_bound(m_index.constBegin(), m_index.constEnd(), time, timeStampLessThan);
+    m_nextPacket = it - m_index.constBegin();
+    m_lastPlayed = qBound(replayStartTime(), time, replayEndTime());
+    m_timeOffset = m_myTime.elapsed();
+
+    m_mutex.lock();
+    m_dataBuffer.clear();
+    m_dataBufferPos = 0;
+    m_mutex.unlock();
+
+    emit replayRepositioned();
+    emit replayPosition((quint32)m_lastPlayed);
+    return true;
+}
+
 void LogFile::pauseReplay()
 {
     m_timer.stop();
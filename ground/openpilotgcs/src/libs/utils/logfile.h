@@ -8,6 +8,7 @@
 #include <QDebug>
 #include <QBuffer>
 #include <QFile>
+#include <QVector>
 #include "utils_global.h"
 
 class QTCREATOR_UTILS_EXPORT LogFile : public QIODevice {
@@ -30,6 +31,13 @@ public:
 
     bool startReplay();
     bool stopReplay();
+
+    /**
+     * Time stamps (in ms) of the first and last packet of the log being replayed,
+     * valid once startReplay() has indexed the file.
+     */
+    quint32 replayStartTime() const;
+    quint32 replayEndTime() const;
     void useProvidedTimeStamp(bool useProvidedTimeStamp)
     {
         m_useProvidedTimeStamp = useProvidedTimeStamp;
@@ -46,8 +54,14 @@ public slots:
         m_playbackSpeed = val;
         qDebug() << "Playback speed is now" << m_playbackSpeed;
     };
+    void setReplayFastMode(bool val)
+    {
+        m_replayFastMode = val;
+        m_timer.setInterval(m_replayFastMode ? 0 : REPLAY_INTERVAL);
+    };
     void pauseReplay();
     void resumeReplay();
+    bool setReplayTime(quint32 time);
 
 protected slots:
     void timerFired();
@@ -56,19 +70,45 @@ signals:
     void readReady();
     void replayStarted();
     void replayFinished();
+    void replayPosition(quint32 time);
+    // the replayed stream continues at another position, see setReplayTime()
+    void replayRepositioned();
 
 protected:
+    // Location of a packet in the replayed log
+    typedef struct {
+        quint32 timeStamp;
+        qint64  offset;
+        qint64  size;
+    } IndexEntry;
+
+    // Replay timer period when playing back in real time
+    static const int REPLAY_INTERVAL   = 10;
+
+    // Amount of data handed out per event loop iteration in fast mode
+    static const int FAST_REPLAY_CHUNK = 64 * 1024;
+
     QByteArray m_dataBuffer;
+    int m_dataBufferPos;
     QTimer m_timer;
     QTime m_myTime;
     QFile m_file;
-    qint32 m_lastTimeStamp;
-    qint32 m_lastPlayed;
     QMutex m_mutex;
 
+    // Log contents, either memory mapped or read in full when mapping is not possible
+    const uchar *m_logData;
+    QByteArray m_logContents;
+    QVector<IndexEntry> m_index;
+    int m_nextPacket;
 
+    double m_lastPlayed;
     int m_timeOffset;
     double m_playbackSpeed;
+    bool m_replayFastMode;
+
+    static bool timeStampLessThan(const IndexEntry &entry, quint32 time);
+    bool buildIndex();
+    qint64 queuePacket();
 
 private:
     quint32 m_nextTimeStamp;
@@ -382,8 +382,16 @@ Rectangle {
                     text = (showSettings ? qsTr("Logs...") : qsTr("Settings..."));
                 }
             }
+            ProgressBar {
+                Layout.fillWidth: true
+                visible: logManager.disableControls
+                minimumValue: 0
+                maximumValue: 100
+                value: logManager.downloadProgress
+            }
             Rectangle {
                 Layout.fillWidth: true
+                visible: !logManager.disableControls
             }
             Button {
                 id: cancelButton
@@ -44,7 +44,7 @@
 FlightLogManager::FlightLogManager(QObject *parent) :
     QObject(parent), m_disableControls(false),
     m_disableExport(true), m_cancelDownload(false),
-    m_adjustExportedTimestamps(true)
+    m_adjustExportedTimestamps(true), m_streaming(false), m_downloadProgress(0)
 {
     ExtensionSystem::PluginManager *pluginManager = ExtensionSystem::PluginManager::instance();
 
@@ -69,6 +69,28 @@ FlightLogManager::FlightLogManager(QObject *parent) :
     m_flightLogEntry    = DebugLogEntry::GetInstance(m_objectManager);
     Q_ASSERT(m_flightLogEntry);
 
+    // The flight side streams into instances 0..STREAM_WINDOW-1, make sure they all exist
+    for (int i = 0; i < STREAM_WINDOW; i++) {
+        DebugLogEntry *instance = DebugLogEntry::GetInstance(m_objectManager, i);
+        if (!instance) {
+            instance = dynamic_cast<DebugLogEntry *>(m_flightLogEntry->clone(i));
+            m_objectManager->registerObject(instance);
+        }
+        connect(instance, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(streamEntryReceived(UAVObject *)));
+    }
+
+    m_decoder = new FlightLogDecoder();
+    m_decoder->moveToThread(&m_decoderThread);
+    connect(&m_decoderThread, SIGNAL(finished()), m_decoder, SLOT(deleteLater()));
+    connect(this, SIGNAL(decodeEntry(QByteArray)), m_decoder, SLOT(decode(QByteArray)));
+    connect(this, SIGNAL(flushDecoder()), m_decoder, SLOT(flush()));
+    connect(m_decoder, SIGNAL(decoded(QByteArray)), this, SLOT(entryDecoded(QByteArray)));
+    connect(m_decoder, SIGNAL(flushed()), this, SLOT(downloadFinished()));
+    m_decoderThread.start();
+
+    m_streamTimer.setSingleShot(true);
+    connect(&m_streamTimer, SIGNAL(timeout()), this, SLOT(streamTimeout()));
+
     m_flightLogSettings = DebugLogSettings::GetInstance(m_objectManager);
     Q_ASSERT(m_flightLogSettings);
 
@@ -88,6 +110,9 @@ FlightLogManager::FlightLogManager(QObject *parent) :
 
 FlightLogManager::~FlightLogManager()
 {
+    m_decoderThread.quit();
+    m_decoderThread.wait();
+
     while (!m_logEntries.isEmpty()) {
         delete m_logEntries.takeFirst();
     }
@@ -189,80 +214,121 @@ void FlightLogManager::clearLogList()
 void FlightLogManager::retrieveLogs(int flightToRetrieve)
 {
     setDisableControls(true);
-    QApplication::setOverrideCursor(Qt::WaitCursor);
     m_cancelDownload = false;
-    UAVObjectUpdaterHelper updateHelper;
-    UAVObjectRequestHelper requestHelper;
 
     clearLogList();
 
     // Set up what to retrieve
-    int startFlight = (flightToRetrieve == -1) ? 0 : flightToRetrieve;
-    int endFlight   = (flightToRetrieve == -1) ? m_flightLogStatus->getFlight() : flightToRetrieve;
-
-    // Prepare to send request for event retrieval
-    m_flightLogControl->setOperation(DebugLogControl::OPERATION_RETRIEVE);
-    for (int flight = startFlight; flight <= endFlight; flight++) {
-        m_flightLogControl->setFlight(flight);
-        bool gotLast = false;
-        int slot     = 0;
-        while (!gotLast) {
-            // Send request for loading flight entry on flight side and wait for ack/nack
-            m_flightLogControl->setEntry(slot);
-
-            if (updateHelper.doObjectAndWait(m_flightLogControl, UAVTALK_TIMEOUT) == UAVObjectUpdaterHelper::SUCCESS &&
-                requestHelper.doObjectAndWait(m_flightLogEntry, UAVTALK_TIMEOUT) == UAVObjectUpdaterHelper::SUCCESS) {
-                if (m_flightLogEntry->getType() != DebugLogEntry::TYPE_EMPTY) {
-                    // Ok, we retrieved the entry, and it was the correct one. clone it and add it to the list
-                    ExtendedDebugLogEntry *logEntry = new ExtendedDebugLogEntry();
-
-                    logEntry->setData(m_flightLogEntry->getData(), m_objectManager);
-                    m_logEntries << logEntry;
-                    if (logEntry->getData().Type == DebugLogEntry::TYPE_MULTIPLEUAVOBJECTS) {
-                        const quint32 total_len  = sizeof(DebugLogEntry::DataFields);
-                        const quint32 data_len   = sizeof(((DebugLogEntry::DataFields *)0)->Data);
-                        const quint32 header_len = total_len - data_len;
-
-                        DebugLogEntry::DataFields fields;
-                        quint32 start = logEntry->getData().Size;
-
-                        // cycle until there is space for another object
-                        while (start + header_len + 1 < data_len) {
-                            memset(&fields, 0xFF, total_len);
-                            memcpy(&fields, &logEntry->getData().Data[start], header_len);
-                            // check wether a packed object is found
-                            // note that empty data blocks are set as 0xFF in flight side to minimize flash wearing
-                            // thus as soon as this read outside of used area, the test will fail as lenght would be 0xFFFF
-                            quint32 toread = header_len + fields.Size;
-                            if (!(toread + start > data_len)) {
-                                memcpy(&fields, &logEntry->getData().Data[start], toread);
-                                ExtendedDebugLogEntry *subEntry = new ExtendedDebugLogEntry();
-                                subEntry->setData(fields, m_objectManager);
-                                m_logEntries << subEntry;
-                            }
-                            start += toread;
-                        }
-                    }
+    m_streamFlight      = (flightToRetrieve == -1) ? 0 : flightToRetrieve;
+    m_streamEndFlight   = (flightToRetrieve == -1) ? m_flightLogStatus->getFlight() : flightToRetrieve;
+    m_streamEntry       = 0;
+    m_streamRetries     = 0;
+    m_downloadedEntries = 0;
+    m_streaming = true;
+    setDownloadProgress(0);
 
-                    // Increment to get next entry from flight side
-                    slot++;
-                } else {
-                    // We are done, not more entries on this flight
-                    gotLast = true;
-                }
-            } else {
-                // We failed for some reason
-                break;
-            }
-            if (m_cancelDownload) {
-                break;
-            }
-        }
-        if (m_cancelDownload) {
-            break;
+    requestStreamWindow();
+}
+
+/**
+ * Ask the flight side to push the next window of entries, starting at the
+ * first entry not received yet.
+ */
+void FlightLogManager::requestStreamWindow()
+{
+    m_streamWindowStart = m_streamEntry;
+
+    m_flightLogControl->setOperation(DebugLogControl::OPERATION_STREAM);
+    m_flightLogControl->setFlight(m_streamFlight);
+    m_flightLogControl->setEntry(m_streamEntry);
+    m_flightLogControl->setCount(STREAM_WINDOW);
+    m_flightLogControl->updated();
+
+    m_streamTimer.start(UAVTALK_TIMEOUT);
+}
+
+void FlightLogManager::streamEntryReceived(UAVObject *obj)
+{
+    if (!m_streaming) {
+        return;
+    }
+
+    DebugLogEntry::DataFields data = static_cast<DebugLogEntry *>(obj)->getData();
+
+    // Entries are pushed in order, anything else is a leftover from a timed out window
+    if (data.Flight != m_streamFlight || data.Entry != m_streamEntry) {
+        return;
+    }
+    m_streamRetries = 0;
+
+    if (data.Type == DebugLogEntry::TYPE_EMPTY) {
+        // We are done, not more entries on this flight
+        if (++m_streamFlight > m_streamEndFlight) {
+            finishDownload();
+        } else {
+            m_streamEntry = 0;
+            requestStreamWindow();
         }
+        return;
+    }
+
+    emit decodeEntry(QByteArray((const char *)&data, sizeof(data)));
+    m_streamEntry++;
+
+    quint16 usedSlots = m_flightLogStatus->getUsedSlots();
+    if (usedSlots > 0) {
+        setDownloadProgress(qMin(100, 100 * ++m_downloadedEntries / usedSlots));
+    }
+
+    if (m_cancelDownload) {
+        finishDownload();
+    } else if (m_streamEntry - m_streamWindowStart >= STREAM_WINDOW) {
+        requestStreamWindow();
+    } else {
+        m_streamTimer.start(UAVTALK_TIMEOUT);
+    }
+}
+
+void FlightLogManager::streamTimeout()
+{
+    if (!m_streaming) {
+        return;
+    }
+
+    if (m_cancelDownload || ++m_streamRetries > STREAM_RETRIES) {
+        // We failed for some reason
+        finishDownload();
+    } else {
+        // Entries got lost, request again from the first missing one
+        requestStreamWindow();
+    }
+}
+
+void FlightLogManager::finishDownload()
+{
+    m_streaming = false;
+    m_streamTimer.stop();
+
+    // Decoded entries are delivered in order, the flush marks the last one
+    emit flushDecoder();
+}
+
+void FlightLogManager::entryDecoded(QByteArray entry)
+{
+    if (m_cancelDownload) {
+        return;
     }
 
+    DebugLogEntry::DataFields fields;
+    memcpy(&fields, entry.constData(), sizeof(fields));
+
+    ExtendedDebugLogEntry *logEntry = new ExtendedDebugLogEntry();
+    logEntry->setData(fields, m_objectManager);
+    m_logEntries << logEntry;
+}
+
+void FlightLogManager::downloadFinished()
+{
     if (m_cancelDownload) {
         clearLogList();
         m_cancelDownload = false;
@@ -271,10 +337,55 @@ void FlightLogManager::retrieveLogs(int flightToRetrieve)
     emit logEntriesChanged();
     setDisableExport(m_logEntries.count() == 0);
 
-    QApplication::restoreOverrideCursor();
+    setDownloadProgress(0);
     setDisableControls(false);
 }
 
+void FlightLogManager::setDownloadProgress(int progress)
+{
+    if (m_downloadProgress != progress) {
+        m_downloadProgress = progress;
+        emit downloadProgressChanged(progress);
+    }
+}
+
+void FlightLogDecoder::decode(QByteArray entry)
+{
+    DebugLogEntry::DataFields data;
+
+    memcpy(&data, entry.constData(), sizeof(data));
+    emit decoded(entry);
+
+    if (data.Type == DebugLogEntry::TYPE_MULTIPLEUAVOBJECTS) {
+        const quint32 total_len  = sizeof(DebugLogEntry::DataFields);
+        const quint32 data_len   = sizeof(((DebugLogEntry::DataFields *)0)->Data);
+        const quint32 header_len = total_len - data_len;
+
+        DebugLogEntry::DataFields fields;
+        quint32 start = data.Size;
+
+        // cycle until there is space for another object
+        while (start + header_len + 1 < data_len) {
+            memset(&fields, 0xFF, total_len);
+            memcpy(&fields, &data.Data[start], header_len);
+            // check wether a packed object is found
+            // note that empty data blocks are set as 0xFF in flight side to minimize flash wearing
+            // thus as soon as this read outside of used area, the test will fail as lenght would be 0xFFFF
+            quint32 toread = header_len + fields.Size;
+            if (!(toread + start > data_len)) {
+                memcpy(&fields, &data.Data[start], toread);
+                emit decoded(QByteArray((const char *)&fields, total_len));
+            }
+            start += toread;
+        }
+    }
+}
+
+void FlightLogDecoder::flush()
+{
+    emit flushed();
+}
+
 void FlightLogManager::exportToOPL(QString fileName)
 {
     // Fix the file name
@@ -415,6 +526,9 @@ void FlightLogManager::exportLogs()
 void FlightLogManager::cancelExportLogs()
 {
     m_cancelDownload = true;
+    if (m_streaming) {
+        finishDownload();
+    }
 }
 
 void FlightLogManager::loadSettings()
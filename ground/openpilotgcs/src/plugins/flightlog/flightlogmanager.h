@@ -33,6 +33,8 @@
 #include <QHash>
 #include <QQmlListProperty>
 #include <QSemaphore>
+#include <QThread>
+#include <QTimer>
 #include <QXmlStreamWriter>
 #include <QTextStream>
 
@@ -167,6 +169,23 @@ private:
     UAVDataObject *m_object;
 };
 
+/**
+ * Runs in its own thread during downloads and splits packed entries of
+ * multiple objects, so the GUI thread only creates the resulting objects.
+ * Entries are passed as raw DebugLogEntry::DataFields.
+ */
+class FlightLogDecoder : public QObject {
+    Q_OBJECT
+
+public slots:
+    void decode(QByteArray entry);
+    void flush();
+
+signals:
+    void decoded(QByteArray entry);
+    void flushed();
+};
+
 class FlightLogManager : public QObject {
     Q_OBJECT Q_PROPERTY(DebugLogStatus *flightLogStatus READ flightLogStatus)
     Q_PROPERTY(DebugLogControl * flightLogControl READ flightLogControl)
@@ -183,6 +202,7 @@ class FlightLogManager : public QObject {
     Q_PROPERTY(QStringList logStatuses READ logStatuses NOTIFY logStatusesChanged)
     Q_PROPERTY(int loggingEnabled READ loggingEnabled WRITE setLoggingEnabled NOTIFY loggingEnabledChanged)
     Q_PROPERTY(int logEntriesCount READ logEntriesCount NOTIFY logEntriesChanged)
+    Q_PROPERTY(int downloadProgress READ downloadProgress NOTIFY downloadProgressChanged)
 
 public:
     explicit FlightLogManager(QObject *parent = 0);
@@ -248,6 +268,11 @@ public:
     {
         return m_logEntries.count();
     }
+
+    int downloadProgress() const
+    {
+        return m_downloadProgress;
+    }
 signals:
     void logEntriesChanged();
     void flightEntriesChanged();
@@ -260,6 +285,10 @@ signals:
 
     void logStatusesChanged(QStringList arg);
     void loggingEnabledChanged(int arg);
+    void downloadProgressChanged(int arg);
+
+    void decodeEntry(QByteArray entry);
+    void flushDecoder();
 
 public slots:
     void clearAllLogs();
@@ -320,6 +349,12 @@ private slots:
     void connectionStatusChanged();
     bool updateLogWrapper(QString name, int level, int period);
 
+    void requestStreamWindow();
+    void streamEntryReceived(UAVObject *obj);
+    void streamTimeout();
+    void entryDecoded(QByteArray entry);
+    void downloadFinished();
+
 private:
     UAVObjectManager *m_objectManager;
     UAVObjectUtilManager *m_objectUtilManager;
@@ -342,7 +377,13 @@ private:
     void exportToCSV(QString fileName);
     void exportToXML(QString fileName);
 
+    void finishDownload();
+    void setDownloadProgress(int progress);
+
     static const int UAVTALK_TIMEOUT = 4000;
+    // Entries pushed by the flight side per request, one DebugLogEntry instance each
+    static const int STREAM_WINDOW   = 8;
+    static const int STREAM_RETRIES  = 3;
     static const int LOG_SETTINGS_FILE_VERSION = 1;
     bool m_disableControls;
     bool m_disableExport;
@@ -350,6 +391,19 @@ private:
     bool m_adjustExportedTimestamps;
     bool m_boardConnected;
     int m_loggingEnabled;
+
+    // Streaming download state
+    QThread m_decoderThread;
+    FlightLogDecoder *m_decoder;
+    QTimer m_streamTimer;
+    bool m_streaming;
+    int m_streamFlight;
+    int m_streamEndFlight;
+    int m_streamWindowStart;
+    int m_streamEntry;
+    int m_streamRetries;
+    int m_downloadedEntries;
+    int m_downloadProgress;
 };
 
 #endif // FLIGHTLOGMANAGER_H
@@ -58,6 +58,11 @@ void LoggingGadgetWidget::setPlugin(LoggingPlugin *p)
     connect(m_logging->pauseButton, SIGNAL(clicked()), p->getLogfile(), SLOT(pauseReplay()));
     connect(m_logging->pauseButton, SIGNAL(clicked()), scpPlugin, SLOT(stopPlotting()));
     connect(m_logging->playbackSpeed, SIGNAL(valueChanged(double)), p->getLogfile(), SLOT(setReplaySpeed(double)));
+    connect(m_logging->fastReplay, SIGNAL(toggled(bool)), p->getLogfile(), SLOT(setReplayFastMode(bool)));
+    connect(m_logging->replayPosition, SIGNAL(sliderReleased()), this, SLOT(seekReplay()));
+    connect(p->getLogfile(), SIGNAL(replayStarted()), this, SLOT(replayStarted()));
+    connect(p->getLogfile(), SIGNAL(replayFinished()), this, SLOT(replayFinished()));
+    connect(p->getLogfile(), SIGNAL(replayPosition(quint32)), this, SLOT(replayPosition(quint32)));
     void pauseReplay();
     void resumeReplay();
 }
@@ -68,6 +73,34 @@ void LoggingGadgetWidget::stateChanged(QString status)
     m_logging->statusLabel->setText(status);
 }
 
+void LoggingGadgetWidget::replayStarted()
+{
+    LogFile *logFile = loggingPlugin->getLogfile();
+
+    m_logging->replayPosition->setRange(logFile->replayStartTime(), logFile->replayEndTime());
+    m_logging->replayPosition->setPageStep(10000);
+    m_logging->replayPosition->setValue(logFile->replayStartTime());
+    m_logging->replayPosition->setEnabled(true);
+}
+
+void LoggingGadgetWidget::replayFinished()
+{
+    m_logging->replayPosition->setEnabled(false);
+}
+
+void LoggingGadgetWidget::replayPosition(quint32 time)
+{
+    // Do not fight the user while the slider is being dragged
+    if (!m_logging->replayPosition->isSliderDown()) {
+        m_logging->replayPosition->setValue(time);
+    }
+}
+
+void LoggingGadgetWidget::seekReplay()
+{
+    loggingPlugin->getLogfile()->setReplayTime(m_logging->replayPosition->value());
+}
+
 /**
  * @}
  * @}
@@ -47,6 +47,10 @@ public:
 
 protected slots:
     void stateChanged(QString status);
+    void replayStarted();
+    void replayFinished();
+    void replayPosition(quint32 time);
+    void seekReplay();
 
 signals:
     void pause();
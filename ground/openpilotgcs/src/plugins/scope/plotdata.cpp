@@ -29,6 +29,57 @@
 #include "plotdata.h"
 #include <math.h>
 #include <QDebug>
+#include <QDateTime>
+
+PlotBuffer::PlotBuffer(int capacity) : m_head(0), m_size(0)
+{
+    setCapacity(capacity);
+}
+
+void PlotBuffer::setCapacity(int capacity)
+{
+    capacity = qMax(capacity, 1);
+    m_x.resize(capacity);
+    m_y.resize(capacity);
+    clear();
+}
+
+void PlotBuffer::append(double x, double y, bool grow)
+{
+    if (m_size == m_x.size()) {
+        if (grow) {
+            // Unroll into a buffer of twice the size
+            QVector<double> xData(2 * m_size);
+            QVector<double> yData(2 * m_size);
+            for (int i = 0; i < m_size; i++) {
+                xData[i] = this->x(i);
+                yData[i] = this->y(i);
+            }
+            m_x    = xData;
+            m_y    = yData;
+            m_head = 0;
+        } else {
+            removeFirst();
+        }
+    }
+    int tail = position(m_size++);
+    m_x[tail] = x;
+    m_y[tail] = y;
+}
+
+void PlotBuffer::removeFirst()
+{
+    if (m_size > 0) {
+        m_head = position(1);
+        m_size--;
+    }
+}
+
+void PlotBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+}
 
 PlotData::PlotData(UAVObject *object, UAVObjectField *field, int element,
                    int scaleOrderFactor, int meanSamples, QString mathFunction,
@@ -62,7 +113,7 @@ PlotData::PlotData(UAVObject *object, UAVObjectField *field, int element,
     }
 
     m_plotCurve->setPen(m_pen);
-    m_plotCurve->setSamples(m_xDataEntries, m_yDataEntries);
+    m_plotCurve->setSamples(m_xPlotData, m_yPlotData);
     m_isEnumPlot = m_field->getType() == UAVObjectField::ENUM;
 }
 
@@ -88,9 +139,58 @@ void PlotData::setVisible(bool visible)
     visibilityChanged(m_plotCurve);
 }
 
-void PlotData::updatePlotData()
+/**
+ * Hand the samples to the curve, decimated to a minimum and a maximum per
+ * pixel column so that drawing cost does not grow with the sample rate.
+ * \param pixelWidth Width of the plot canvas
+ */
+void PlotData::updatePlotData(int pixelWidth)
+{
+    int size    = m_data.size();
+    int buckets = qMax(pixelWidth, 1);
+    // Sequential plots show the samples by position in the buffer
+    bool indexed = (plotType() == SequentialPlot);
+
+    m_xPlotData.resize(0);
+    m_yPlotData.resize(0);
+
+    if (size <= 2 * buckets) {
+        for (int i = 0; i < size; i++) {
+            m_xPlotData.append(indexed ? i : m_data.x(i));
+            m_yPlotData.append(m_data.y(i));
+        }
+    } else {
+        for (int bucket = 0; bucket < buckets; bucket++) {
+            int start = (qint64)bucket * size / buckets;
+            int end   = (qint64)(bucket + 1) * size / buckets;
+            int minIndex = start;
+            int maxIndex = start;
+            for (int i = start + 1; i < end; i++) {
+                double y = m_data.y(i);
+                if (y < m_data.y(minIndex)) {
+                    minIndex = i;
+                } else if (y > m_data.y(maxIndex)) {
+                    maxIndex = i;
+                }
+            }
+            // Keep the extremes in time order so the curve does not zigzag backwards
+            int first  = qMin(minIndex, maxIndex);
+            int second = qMax(minIndex, maxIndex);
+            m_xPlotData.append(indexed ? first : m_data.x(first));
+            m_yPlotData.append(m_data.y(first));
+            if (second != first) {
+                m_xPlotData.append(indexed ? second : m_data.x(second));
+                m_yPlotData.append(m_data.y(second));
+            }
+        }
+    }
+
+    m_plotCurve->setSamples(m_xPlotData, m_yPlotData);
+}
+
+double PlotData::currentTime()
 {
-    m_plotCurve->setSamples(m_xDataEntries, m_yDataEntries);
+    return QDateTime::currentMSecsSinceEpoch() / 1000.0;
 }
 
 void PlotData::clear()
@@ -98,8 +198,7 @@ void PlotData::clear()
     m_meanSum = 0.0f;
     m_correctionSum   = 0.0f;
     m_correctionCount = 0;
-    m_xDataEntries.clear();
-    m_yDataEntries.clear();
+    m_data.clear();
     while (!m_enumMarkerList.isEmpty()) {
         QwtPlotMarker *marker = m_enumMarkerList.takeFirst();
         marker->detach();
@@ -113,7 +212,7 @@ void PlotData::clear()
 bool PlotData::hasData() const
 {
     if (!m_isEnumPlot) {
-        return !m_xDataEntries.isEmpty();
+        return !m_data.isEmpty();
     } else {
         return !m_enumMarkerList.isEmpty();
     }
@@ -122,7 +221,7 @@ bool PlotData::hasData() const
 QString PlotData::lastDataAsString()
 {
     if (!m_isEnumPlot) {
-        return QString().sprintf("%3.10g", m_yDataEntries.last());
+        return QString().sprintf("%3.10g", m_data.y(m_data.size() - 1));
     } else {
         return m_enumMarkerList.last()->title().text();
     }
@@ -142,7 +241,7 @@ void PlotData::visibilityChanged(QwtPlotItem *item)
     }
 }
 
-void PlotData::calcMathFunction(double currentValue)
+double PlotData::calcMathFunction(double currentValue)
 {
     // Put the new value at the back
     m_yDataHistory.append(currentValue);
@@ -169,9 +268,9 @@ void PlotData::calcMathFunction(double currentValue)
         for (int i = 0; i < m_yDataHistory.size(); i++) {
             stdSum += pow(m_yDataHistory.at(i) - boxcarAvg, 2) / (m_meanSamples - 1);
         }
-        m_yDataEntries.append(sqrt(stdSum));
+        return sqrt(stdSum);
     } else {
-        m_yDataEntries.append(boxcarAvg);
+        return boxcarAvg;
     }
 }
 
@@ -199,8 +298,10 @@ QwtPlotMarker *PlotData::createMarker(QString value)
     return marker;
 }
 
-bool SequentialPlotData::append(UAVObject *obj)
+bool SequentialPlotData::append(UAVObject *obj, double time)
 {
+    Q_UNUSED(time);
+
     if (obj == NULL) {
         obj = m_object;
     }
@@ -211,18 +312,11 @@ bool SequentialPlotData::append(UAVObject *obj)
 
             // Perform scope math, if necessary
             if (m_mathFunction == "Boxcar average" || m_mathFunction == "Standard deviation") {
-                calcMathFunction(currentValue);
-            } else {
-                m_yDataEntries.append(currentValue);
+                currentValue = calcMathFunction(currentValue);
             }
 
-            if (m_yDataEntries.size() > m_plotDataSize) {
-                // If new data overflows the window, remove old data...
-                m_yDataEntries.pop_front();
-            } else {
-                // ...otherwise, add a new y point at position xData
-                m_xDataEntries.insert(m_xDataEntries.size(), m_xDataEntries.size());
-            }
+            // If new data overflows the window the oldest sample is dropped
+            m_data.append(0, currentValue, false);
             return true;
         } else {
             // Enum markers
@@ -243,29 +337,26 @@ bool SequentialPlotData::append(UAVObject *obj)
     return false;
 }
 
-bool ChronoPlotData::append(UAVObject *obj)
+bool ChronoPlotData::append(UAVObject *obj, double time)
 {
     if (obj == NULL) {
         obj = m_object;
     }
 
     if (m_object == obj && m_field) {
-        // Get the field of interest
-        // THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
-        QDateTime NOW = QDateTime::currentDateTime();
-
-        double xValue = NOW.toTime_t() + NOW.time().msec() / 1000.0;
+        // GCS objects carry no receive time stamp, the caller samples the
+        // wall clock once per object update
+        double xValue = time;
         if (!m_isEnumPlot) {
             double currentValue = m_field->getValue(m_element).toDouble() * pow(10, m_scalePower);
 
             // Perform scope math, if necessary
             if (m_mathFunction == "Boxcar average" || m_mathFunction == "Standard deviation") {
-                calcMathFunction(currentValue);
-            } else {
-                m_yDataEntries.append(currentValue);
+                currentValue = calcMathFunction(currentValue);
             }
 
-            m_xDataEntries.append(xValue);
+            // The buffer grows until removeStaleData() keeps up with the sample rate
+            m_data.append(xValue, currentValue, true);
         } else {
             // Enum markers
             QString value = m_field->getValue(m_element).toString();
@@ -289,10 +380,9 @@ bool ChronoPlotData::append(UAVObject *obj)
 
 void ChronoPlotData::removeStaleData()
 {
-    while (!m_xDataEntries.isEmpty() &&
-           (m_xDataEntries.last() - m_xDataEntries.first()) > m_plotDataSize) {
-        m_yDataEntries.pop_front();
-        m_xDataEntries.pop_front();
+    while (!m_data.isEmpty() &&
+           (m_data.x(m_data.size() - 1) - m_data.x(0)) > m_plotDataSize) {
+        m_data.removeFirst();
     }
     while (!m_enumMarkerList.isEmpty() &&
            (m_enumMarkerList.last()->xValue() - m_enumMarkerList.first()->xValue()) > m_plotDataSize) {
@@ -47,6 +47,50 @@
  */
 enum PlotType { SequentialPlot, ChronoPlot };
 
+/*!
+   \brief Circular buffer of curve samples, the oldest samples are dropped
+   without moving the remaining ones.
+ */
+class PlotBuffer {
+public:
+    PlotBuffer(int capacity = 0);
+
+    void setCapacity(int capacity);
+    // Append a sample, overwriting the oldest one if full and not allowed to grow
+    void append(double x, double y, bool grow);
+    void removeFirst();
+    void clear();
+
+    int size() const
+    {
+        return m_size;
+    }
+    bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+    double x(int index) const
+    {
+        return m_x.at(position(index));
+    }
+    double y(int index) const
+    {
+        return m_y.at(position(index));
+    }
+
+private:
+    QVector<double> m_x;
+    QVector<double> m_y;
+    int m_head;
+    int m_size;
+
+    int position(int index) const
+    {
+        index += m_head;
+        return (index >= m_x.size()) ? index - m_x.size() : index;
+    }
+};
+
 /*!
    \brief Base class that keeps the data for each curve in the plot.
  */
@@ -88,11 +132,11 @@ public:
         return m_isEnumPlot;
     }
 
-    virtual bool append(UAVObject *obj) = 0;
-    virtual PlotType plotType() const   = 0;
+    virtual bool append(UAVObject *obj, double time = currentTime()) = 0;
+    virtual PlotType plotType() const = 0;
     virtual void removeStaleData() = 0;
 
-    void updatePlotData();
+    void updatePlotData(int pixelWidth);
     void clear();
 
     bool hasData() const;
@@ -100,6 +144,9 @@ public:
 
     void attach(QwtPlot *plot);
 
+    // Wall clock time in seconds, as used on the chrono plot x axis
+    static double currentTime();
+
 public slots:
     void visibilityChanged(QwtPlotItem *item);
 
@@ -113,10 +160,13 @@ protected:
     int m_correctionCount;
     double m_plotDataSize;
 
-    QVector<double> m_xDataEntries;
-    QVector<double> m_yDataEntries;
+    PlotBuffer m_data;
     QVector<double> m_yDataHistory;
 
+    // Decimated copy of m_data handed to the curve
+    QVector<double> m_xPlotData;
+    QVector<double> m_yPlotData;
+
     UAVObject *m_object;
     UAVObjectField *m_field;
     int m_element;
@@ -127,7 +177,7 @@ protected:
     bool m_isVisible;
     QPen m_pen;
     bool m_isEnumPlot;
-    virtual void calcMathFunction(double currentValue);
+    virtual double calcMathFunction(double currentValue);
     QwtPlotMarker *createMarker(QString value);
 };
 
@@ -142,10 +192,13 @@ public:
                        int scaleFactor, int meanSamples, QString mathFunction,
                        double plotDataSize, QPen pen, bool antialiased)
         : PlotData(object, field, element, scaleFactor, meanSamples,
-                   mathFunction, plotDataSize, pen, antialiased) {}
+                   mathFunction, plotDataSize, pen, antialiased)
+    {
+        m_data.setCapacity(plotDataSize);
+    }
     ~SequentialPlotData() {}
 
-    bool append(UAVObject *obj);
+    bool append(UAVObject *obj, double time = currentTime());
     PlotType plotType() const
     {
         return SequentialPlot;
@@ -167,7 +220,7 @@ public:
     {}
     ~ChronoPlotData() {}
 
-    bool append(UAVObject *obj);
+    bool append(UAVObject *obj, double time = currentTime());
     PlotType plotType() const
     {
         return ChronoPlot;
@@ -399,8 +399,11 @@ void ScopeGadgetWidget::addCurvePlot(QString objectName, QString fieldPlusSubFie
 
 void ScopeGadgetWidget::uavObjectReceived(UAVObject *obj)
 {
+    // Sample the clock once for all curves of this object
+    double time = PlotData::currentTime();
+
     foreach(PlotData * plotData, m_curvesData.values()) {
-        if (plotData->append(obj)) {
+        if (plotData->append(obj, time)) {
             m_csvLoggingDataUpdated = 1;
         }
     }
@@ -414,14 +417,13 @@ void ScopeGadgetWidget::replotNewData()
     }
 
     QMutexLocker locker(&m_mutex);
+    int pixelWidth = canvas()->width();
     foreach(PlotData * plotData, m_curvesData.values()) {
         plotData->removeStaleData();
-        plotData->updatePlotData();
+        plotData->updatePlotData(pixelWidth);
     }
 
-    QDateTime NOW = QDateTime::currentDateTime();
-    double toTime = NOW.toTime_t();
-    toTime += NOW.time().msec() / 1000.0;
+    double toTime = PlotData::currentTime();
     if (m_plotType == ChronoPlot) {
         setAxisScale(QwtPlot::xBottom, toTime - m_plotDataSize, toTime);
     }
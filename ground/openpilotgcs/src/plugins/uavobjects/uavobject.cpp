@@ -311,9 +311,10 @@ qint32 UAVObject::pack(quint8 *dataOut)
 
 /**
  * Unpack the object data from a byte array
+ * @param notify If false the update events are left to the caller, see emitUnpacked()
  * @returns The number of bytes copied
  */
-qint32 UAVObject::unpack(const quint8 *dataIn)
+qint32 UAVObject::unpack(const quint8 *dataIn, bool notify)
 {
     QMutexLocker locker(mutex);
     qint32 offset = 0;
@@ -322,8 +323,9 @@ qint32 UAVObject::unpack(const quint8 *dataIn)
         fields[n]->unpack(&dataIn[offset]);
         offset += fields[n]->getNumBytes();
     }
-    emit objectUnpacked(this); // trigger object updated event
-    emit objectUpdated(this);
+    if (notify) {
+        emitUnpacked();
+    }
 
     return numBytes;
 }
@@ -588,6 +590,15 @@ void UAVObject::fromJson(const QJsonObject &jsonObject)
     }
 }
 
+/**
+ * Emit the events of an unpack (used by the UAVTalk plugin to coalesce updates)
+ */
+void UAVObject::emitUnpacked()
+{
+    emit objectUnpacked(this); // trigger object updated event
+    emit objectUpdated(this);
+}
+
 /**
  * Emit the transactionCompleted event (used by the UAVTalk plugin)
  */
@@ -113,7 +113,7 @@ public:
     QString getDescription();
     quint32 getNumBytes();
     qint32 pack(quint8 *dataOut);
-    qint32 unpack(const quint8 *dataIn);
+    qint32 unpack(const quint8 *dataIn, bool notify = true);
     quint8 updateCRC(quint8 crc = 0);
     bool save();
     bool save(QFile & file);
@@ -139,6 +139,7 @@ public:
     void toJson(QJsonObject &jsonObject);
     void fromJson(const QJsonObject &jsonObject);
 
+    void emitUnpacked();
     void emitTransactionCompleted(bool success);
     void emitNewInstance(UAVObject *);
 
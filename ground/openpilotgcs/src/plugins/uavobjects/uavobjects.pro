@@ -48,6 +48,7 @@ HEADERS += \
     $$UAVOBJECT_SYNTHETICS/revocalibration.h \
     $$UAVOBJECT_SYNTHETICS/revosettings.h \
     $$UAVOBJECT_SYNTHETICS/gcstelemetrystats.h \
+    $$UAVOBJECT_SYNTHETICS/gcstelemetryfeatures.h \
     $$UAVOBJECT_SYNTHETICS/gyrostate.h \
     $$UAVOBJECT_SYNTHETICS/gyrosensor.h \
     $$UAVOBJECT_SYNTHETICS/accelsensor.h \
@@ -56,6 +57,7 @@ HEADERS += \
     $$UAVOBJECT_SYNTHETICS/magstate.h \
     $$UAVOBJECT_SYNTHETICS/camerastabsettings.h \
     $$UAVOBJECT_SYNTHETICS/flighttelemetrystats.h \
+    $$UAVOBJECT_SYNTHETICS/flighttelemetrylinkstats.h \
     $$UAVOBJECT_SYNTHETICS/systemstats.h \
     $$UAVOBJECT_SYNTHETICS/systemalarms.h \
     $$UAVOBJECT_SYNTHETICS/objectpersistence.h \
@@ -154,6 +156,7 @@ SOURCES += \
     $$UAVOBJECT_SYNTHETICS/revocalibration.cpp \
     $$UAVOBJECT_SYNTHETICS/revosettings.cpp \
     $$UAVOBJECT_SYNTHETICS/gcstelemetrystats.cpp \
+    $$UAVOBJECT_SYNTHETICS/gcstelemetryfeatures.cpp \
     $$UAVOBJECT_SYNTHETICS/accelsensor.cpp \
     $$UAVOBJECT_SYNTHETICS/accelstate.cpp \
     $$UAVOBJECT_SYNTHETICS/gyrostate.cpp \
@@ -162,6 +165,7 @@ SOURCES += \
     $$UAVOBJECT_SYNTHETICS/magstate.cpp \
     $$UAVOBJECT_SYNTHETICS/camerastabsettings.cpp \
     $$UAVOBJECT_SYNTHETICS/flighttelemetrystats.cpp \
+    $$UAVOBJECT_SYNTHETICS/flighttelemetrylinkstats.cpp \
     $$UAVOBJECT_SYNTHETICS/systemstats.cpp \
     $$UAVOBJECT_SYNTHETICS/systemalarms.cpp \
     $$UAVOBJECT_SYNTHETICS/objectpersistence.cpp \
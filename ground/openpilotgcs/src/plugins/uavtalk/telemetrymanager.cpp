@@ -31,6 +31,7 @@
 #include <extensionsystem/pluginmanager.h>
 #include <coreplugin/icore.h>
 #include <coreplugin/threadmanager.h>
+#include <utils/logfile.h>
 
 TelemetryManager::TelemetryManager() : m_connectionState(TELEMETRY_DISCONNECTED)
 {
@@ -75,26 +76,22 @@ void TelemetryManager::start(QIODevice *dev)
 void TelemetryManager::onStart()
 {
     m_uavTalk = new UAVTalk(m_telemetryDevice, m_uavobjectManager);
-    if (false) {
-        // UAVTalk must be thread safe and for that:
-        // 1- all public methods must lock a mutex
-        // 2- the reader thread must lock that mutex too
-        // The reader thread locks the mutex once a packet is read and decoded.
-        // It is assumed that the UAVObjectManager is thread safe
-
-        // Create the reader and move it to the reader thread
-        IODeviceReader *reader = new IODeviceReader(m_uavTalk);
-        reader->moveToThread(&m_telemetryReaderThread);
-        // The reader will be deleted (later) when the thread finishes
-        connect(&m_telemetryReaderThread, &QThread::finished, reader, &QObject::deleteLater);
-        // Connect IO device to reader
-        connect(m_telemetryDevice, SIGNAL(readyRead()), reader, SLOT(read()));
-        // start the reader thread
-        m_telemetryReaderThread.start();
-    } else {
-        // Connect IO device to reader
-        connect(m_telemetryDevice, SIGNAL(readyRead()), m_uavTalk, SLOT(processInputStream()));
-    }
+
+    // The io device is read in this thread and the input is decoded in the reader thread:
+    // 1- all public methods of UAVTalk lock its mutex, the reader locks it while decoding
+    // 2- the reader takes no other lock, decoded frames are unpacked and answered in this thread
+    // 3- update events are queued by UAVTalk and emitted from this thread, in order, after each frame
+    // The UAVObjectManager and the objects lock their own mutexes
+
+    // Create the reader and move it to the reader thread
+    IODeviceReader *reader = new IODeviceReader(m_uavTalk);
+    reader->moveToThread(&m_telemetryReaderThread);
+    // The reader will be deleted (later) when the thread finishes
+    connect(&m_telemetryReaderThread, &QThread::finished, reader, &QObject::deleteLater);
+    // Connect IO device to UAVTalk, it hands the input over to the reader
+    connect(m_telemetryDevice, SIGNAL(readyRead()), m_uavTalk, SLOT(processInputStream()));
+    // start the reader thread
+    m_telemetryReaderThread.start();
 
     m_telemetry = new Telemetry(m_uavTalk, m_uavobjectManager);
     m_telemetryMonitor = new TelemetryMonitor(m_uavobjectManager, m_telemetry);
@@ -102,18 +99,26 @@ void TelemetryManager::onStart()
     connect(m_telemetryMonitor, SIGNAL(connected()), this, SLOT(onConnect()));
     connect(m_telemetryMonitor, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
     connect(m_telemetryMonitor, SIGNAL(telemetryUpdated(double, double)), this, SLOT(onTelemetryUpdate(double, double)));
+
+    // Delta encoded updates refer to full images received earlier, these are stale once
+    // the link drops or a replayed log jumps to another position
+    connect(m_telemetryMonitor, SIGNAL(disconnected()), m_uavTalk, SLOT(resetDeltaBase()));
+    LogFile *logFile = qobject_cast<LogFile *>(m_telemetryDevice);
+    if (logFile) {
+        connect(logFile, SIGNAL(replayRepositioned()), m_uavTalk, SLOT(resetDeltaBase()));
+    }
 }
 
 void TelemetryManager::stop()
 {
     m_connectionState = TELEMETRY_DISCONNECTING;
     emit disconnecting();
-    emit myStop();
 
-    if (false) {
-        m_telemetryReaderThread.quit();
-        m_telemetryReaderThread.wait();
-    }
+    // stop decoding before UAVTalk gets deleted
+    m_telemetryReaderThread.quit();
+    m_telemetryReaderThread.wait();
+
+    emit myStop();
 }
 
 void TelemetryManager::onStop()
@@ -143,9 +148,12 @@ void TelemetryManager::onTelemetryUpdate(double txRate, double rxRate)
 }
 
 IODeviceReader::IODeviceReader(UAVTalk *uavTalk) : m_uavTalk(uavTalk)
-{}
+{
+    m_uavTalk->useReaderThread = true;
+    connect(m_uavTalk, SIGNAL(inputReceived(QByteArray)), this, SLOT(read(QByteArray)));
+}
 
-void IODeviceReader::read()
+void IODeviceReader::read(const QByteArray &data)
 {
-    m_uavTalk->processInputStream();
+    m_uavTalk->processInput(data);
 }
@@ -91,7 +91,7 @@ public:
     UAVTalk *m_uavTalk;
 
 public slots:
-    void read();
+    void read(const QByteArray &data);
 };
 
 #endif // TELEMETRYMANAGER_H
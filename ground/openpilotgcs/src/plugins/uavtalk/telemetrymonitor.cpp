@@ -36,6 +36,7 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager *objMngr, Telemetry *tel) :
     objMngr(objMngr),
     tel(tel),
     gcsStatsObj(GCSTelemetryStats::GetInstance(objMngr)),
+    gcsFeaturesObj(GCSTelemetryFeatures::GetInstance(objMngr)),
     flightStatsObj(FlightTelemetryStats::GetInstance(objMngr)),
     firmwareIAPObj(FirmwareIAPObj::GetInstance(objMngr)),
     statsTimer(new QTimer(this)),
@@ -253,6 +254,10 @@ void TelemetryMonitor::processStatsUpdates()
     if (gcsStats.Status == GCSTelemetryStats::STATUS_CONNECTED && gcsStats.Status != oldStatus) {
         statsTimer->setInterval(STATS_UPDATE_PERIOD_MS);
         qDebug("Connection with the autopilot established");
+        // Announce the optional protocol features this GCS can decode, a firmware
+        // without the object ignores it. It is also repeated periodically.
+        gcsFeaturesObj->setFeatures(UAVTalk::SUPPORTED_FEATURES);
+        gcsFeaturesObj->updated();
         startRetrievingObjects();
     }
     if (gcsStats.Status == GCSTelemetryStats::STATUS_DISCONNECTED && gcsStats.Status != oldStatus) {
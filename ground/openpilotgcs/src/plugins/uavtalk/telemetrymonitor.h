@@ -36,6 +36,7 @@
 #include <QMutexLocker>
 #include "uavobjectmanager.h"
 #include "gcstelemetrystats.h"
+#include "gcstelemetryfeatures.h"
 #include "flighttelemetrystats.h"
 #include "firmwareiapobj.h"
 #include "systemstats.h"
@@ -68,6 +69,7 @@ private:
     Telemetry *tel;
     QQueue<UAVObject *> queue;
     GCSTelemetryStats *gcsStatsObj;
+    GCSTelemetryFeatures *gcsFeaturesObj;
     FlightTelemetryStats *flightStatsObj;
     FirmwareIAPObj *firmwareIAPObj;
     QTimer *statsTimer;
@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ *
+ * @file       main.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2014.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Measures the UAVTalk receive rate by parsing a recorded .opl log
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include "uavtalk/uavtalk.h"
+#include "uavobjects/uavobjectmanager.h"
+#include "uavobjects/uavobjectsinit.h"
+
+/**
+ * Read only device serving the raw telemetry stream, anything the
+ * parser sends back (acks, nacks) is dropped.
+ */
+class ReplayDevice : public QIODevice {
+public:
+    ReplayDevice(const QByteArray &data) : m_data(data), m_pos(0) {}
+
+    void rewind()
+    {
+        m_pos = 0;
+    }
+
+    bool isSequential() const
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return m_data.size() - m_pos + QIODevice::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        qint64 toRead = qMin(maxSize, (qint64)(m_data.size() - m_pos));
+
+        memcpy(data, m_data.constData() + m_pos, toRead);
+        m_pos += toRead;
+        return toRead;
+    }
+
+    qint64 writeData(const char *data, qint64 dataSize)
+    {
+        Q_UNUSED(data);
+        return dataSize;
+    }
+
+private:
+    QByteArray m_data;
+    qint64 m_pos;
+};
+
+/**
+ * Strip the timestamp and size records of an .opl file and return the
+ * concatenated telemetry stream.
+ */
+static bool loadLog(const QString &fileName, QByteArray &stream)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    quint32 timeStamp;
+    qint64 dataSize;
+    while (file.read((char *)&timeStamp, sizeof(timeStamp)) == sizeof(timeStamp)) {
+        if (file.read((char *)&dataSize, sizeof(dataSize)) != sizeof(dataSize)) {
+            break;
+        }
+        if (dataSize < 1 || dataSize > (1024 * 1024) || file.bytesAvailable() < dataSize) {
+            break;
+        }
+        stream.append(file.read(dataSize));
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream sout(stdout);
+
+    if (argc < 2) {
+        sout << "Usage: uavtalkbenchmark <logfile.opl> [passes]\n";
+        return 1;
+    }
+    int passes = (argc > 2) ? QString(argv[2]).toInt() : 10;
+
+    QByteArray stream;
+    if (!loadLog(QString(argv[1]), stream)) {
+        sout << "Unable to open " << argv[1] << "\n";
+        return 1;
+    }
+
+    UAVObjectManager *objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(objMngr);
+
+    ReplayDevice device(stream);
+    device.open(QIODevice::ReadWrite);
+    UAVTalk *talk = new UAVTalk(&device, objMngr);
+
+    qint64 elapsed = 0;
+    for (int i = 0; i < passes; i++) {
+        device.rewind();
+        QElapsedTimer timer;
+        timer.start();
+        QMetaObject::invokeMethod(talk, "processInputStream", Qt::DirectConnection);
+        elapsed += timer.nsecsElapsed();
+    }
+
+    UAVTalk::ComStats stats = talk->getStats();
+    double seconds = (elapsed > 0) ? elapsed / 1e9 : 1e-9;
+    sout << "bytes:       " << stats.rxBytes << "\n";
+    sout << "frames:      " << stats.rxObjects << "\n";
+    sout << "errors:      " << stats.rxErrors << " (sync " << stats.rxSyncErrors << ", crc " << stats.rxCrcErrors << ")\n";
+    sout << "time:        " << seconds << " s\n";
+    sout << "frames/s:    " << stats.rxObjects / seconds << "\n";
+    sout << "MB/s:        " << stats.rxBytes / seconds / (1024 * 1024) << "\n";
+
+    delete talk;
+    delete objMngr;
+    return 0;
+}
+
+/**
+ * @}
+ * @}
+ */
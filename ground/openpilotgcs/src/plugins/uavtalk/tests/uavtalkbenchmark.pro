@@ -0,0 +1,20 @@
+# -------------------------------------------------
+# UAVTalk receive path benchmark, replays an .opl log
+# through the parser and reports the frame rate.
+# Usage: uavtalkbenchmark <logfile.opl> [passes]
+# -------------------------------------------------
+QT -= gui
+QT += network
+TARGET = uavtalkbenchmark
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../openpilotgcs.pri)
+
+LIBS += -L$$GCS_PLUGIN_PATH/OpenPilot
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+
+include(../uavtalk.pri)
+
+SOURCES += main.cpp
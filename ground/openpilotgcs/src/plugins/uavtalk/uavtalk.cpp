@@ -52,13 +52,15 @@ using namespace Utils;
 UAVTalk::UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr) : io(iodev), objMngr(objMngr), mutex(QMutex::Recursive)
 {
     rxState = STATE_SYNC;
-    rxPacketLength = 0;
+    rxPacketLength  = 0;
+    useReaderThread = false;
 
     memset(&stats, 0, sizeof(ComStats));
 
+    // settings are not available when running outside of the GCS (e.g. benchmarks)
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
-    Core::Internal::GeneralSettings *settings = pm->getObject<Core::Internal::GeneralSettings>();
-    useUDPMirror = settings->useUDPMirror();
+    Core::Internal::GeneralSettings *settings = pm ? pm->getObject<Core::Internal::GeneralSettings>() : NULL;
+    useUDPMirror = settings ? settings->useUDPMirror() : false;
     qDebug() << "USE UDP:::::::::::." << useUDPMirror;
     if (useUDPMirror) {
         udpSocketTx = new QUdpSocket(this);
@@ -88,6 +90,17 @@ void UAVTalk::resetStats()
     memset(&stats, 0, sizeof(ComStats));
 }
 
+/**
+ * Forget the full images received so far. Called when the link is reset or the
+ * replayed stream jumps, deltas are then NACKed until the sender resends full images.
+ */
+void UAVTalk::resetDeltaBase()
+{
+    QMutexLocker locker(&mutex);
+
+    deltaBase.clear();
+}
+
 /**
  * Get the statistics counters
  */
@@ -208,36 +221,140 @@ bool UAVTalk::objectTransaction(quint8 type, quint32 objId, quint16 instId, UAVO
  */
 void UAVTalk::processInputStream()
 {
-    quint8 tmp;
-
     if (io && io->isReadable()) {
+        // drain the device in large chunks instead of issuing one read per byte
         while (io->bytesAvailable() > 0) {
-            int ret = io->read((char *)&tmp, 1);
-            if (ret != -1) {
-                processInputByte(tmp);
+            qint64 ret = io->read((char *)rxStreamBuffer, RX_BUFFER_SIZE);
+            if (ret <= 0) {
+                break;
+            }
+            if (useReaderThread) {
+                // the io device is only accessed from its own thread, the reader thread decodes a copy
+                emit inputReceived(QByteArray((const char *)rxStreamBuffer, ret));
             } else {
-                // TODOD
+                processInputBuffer(rxStreamBuffer, ret);
             }
-            if (rxState == STATE_COMPLETE) {
-                mutex.lock();
-                if (receiveObject(rxType, rxObjId, rxInstId, rxBuffer, rxLength)) {
-                    stats.rxObjectBytes += rxLength;
-                    stats.rxObjects++;
-                } else {
-                    // TODO...
-                }
-                mutex.unlock();
+        }
+    }
+}
+
+/**
+ * Decode a chunk of input read by processInputStream(), called by the reader thread
+ */
+void UAVTalk::processInput(const QByteArray &data)
+{
+    processInputBuffer((const quint8 *)data.constData(), data.size());
+}
+
+/**
+ * Process a chunk of bytes from the telemetry stream.
+ * Inter-frame garbage and object payloads are consumed a span at a time,
+ * the frame header and checksum go through the byte wise state machine.
+ * \param[in] data Received bytes
+ * \param[in] length Number of bytes in \a data
+ */
+void UAVTalk::processInputBuffer(const quint8 *data, qint64 length)
+{
+    // the receive state and the stats are shared with the senders
+    QMutexLocker locker(&mutex);
 
-                if (useUDPMirror) {
-                    // it is safe to do this outside of the above critical section as the rxDataArray is
-                    // accessed from this thread only
-                    udpSocketTx->writeDatagram(rxDataArray, QHostAddress::LocalHost, udpSocketRx->localPort());
+    const quint8 *end = data + length;
+
+    while (data < end) {
+        qint64 count = 0;
+
+        if (rxState == STATE_SYNC || rxState == STATE_COMPLETE || rxState == STATE_ERROR) {
+            // skip everything up to the next sync byte
+            const quint8 *sync = (const quint8 *)memchr(data, SYNC_VAL, end - data);
+            count = (sync ? sync : end) - data;
+            if (count > 0) {
+                if (rxState != STATE_SYNC) {
+                    rxState = STATE_SYNC;
+                    if (useUDPMirror) {
+                        rxDataArray.clear();
+                    }
                 }
+                stats.rxSyncErrors += count;
+            }
+        } else if (rxState == STATE_DATA) {
+            // copy as much of the payload as is available
+            count = qMin((qint64)(rxLength - rxCount), (qint64)(end - data));
+            memcpy(&rxBuffer[rxCount], data, count);
+            rxCS     = Crc::updateCRC(rxCS, data, (qint32)count);
+            rxCount += count;
+            if (rxCount >= rxLength) {
+                rxCount = 0;
+                rxState = STATE_CS;
+            }
+        }
+
+        if (count > 0) {
+            stats.rxBytes  += count;
+            rxPacketLength += count;
+            if (useUDPMirror) {
+                rxDataArray.append((const char *)data, count);
             }
+            data += count;
+            continue;
         }
+
+        processInputByte(*data++);
+        if (rxState == STATE_COMPLETE) {
+            processInputFrame();
+        }
+    }
+}
+
+/**
+ * Hand a completely received frame over to the object layer.
+ * The reader thread only decodes frames, they are received in the thread of this object.
+ * Receiving takes the object, object manager and telemetry locks while this mutex is
+ * held, in the same order as the senders in this thread do.
+ */
+void UAVTalk::processInputFrame()
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, "receiveFrame", Qt::QueuedConnection,
+                                  Q_ARG(quint8, rxType), Q_ARG(quint32, rxObjId), Q_ARG(quint16, rxInstId),
+                                  Q_ARG(QByteArray, QByteArray((const char *)rxBuffer, rxLength)));
+    } else {
+        receiveFrame(rxType, rxObjId, rxInstId, QByteArray::fromRawData((const char *)rxBuffer, rxLength));
+    }
+
+    if (useUDPMirror) {
+        // the mirror sockets belong to the thread of this object
+        QMetaObject::invokeMethod(this, "mirrorInput", Qt::AutoConnection, Q_ARG(QByteArray, rxDataArray));
     }
 }
 
+/**
+ * Unpack a decoded frame and answer it
+ */
+void UAVTalk::receiveFrame(quint8 type, quint32 objId, quint16 instId, const QByteArray &data)
+{
+    {
+        QMutexLocker locker(&mutex);
+
+        if (receiveObject(type, objId, instId, (quint8 *)data.constData(), data.size())) {
+            stats.rxObjectBytes += data.size();
+            stats.rxObjects++;
+        } else {
+            // TODO...
+        }
+    }
+
+    // notify before the next frame is unpacked, so that listeners see the data of every update
+    notifyUpdates();
+}
+
+/**
+ * Mirror a received frame to the UDP port
+ */
+void UAVTalk::mirrorInput(const QByteArray &data)
+{
+    udpSocketTx->writeDatagram(data, QHostAddress::LocalHost, udpSocketRx->localPort());
+}
+
 /**
  * Process an byte from the telemetry stream.
  * \param[in] rxbyte Received byte
@@ -362,7 +479,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
         // Search for object, if not found reset state machine
         {
             UAVObject *rxObj = objMngr->getObject(rxObjId);
-            if (rxObj == NULL && rxType != TYPE_OBJ_REQ) {
+            if (rxObj == NULL && rxType != TYPE_OBJ_REQ && rxType != TYPE_OBJ_MULTI) {
                 qWarning() << "UAVTalk - error : unknown object" << rxObjId;
                 stats.rxErrors++;
                 rxState = STATE_ERROR;
@@ -373,7 +490,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
                 rxLength = 0;
             } else {
-                if (rxObj) {
+                if (rxObj && rxType != TYPE_OBJ_MULTI && rxType != TYPE_OBJ_DELTA) {
                     rxLength = rxObj->getNumBytes();
                 } else {
                     rxLength = packetSize - rxPacketLength;
@@ -474,8 +591,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
  */
 bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
 {
-    Q_UNUSED(length);
-
     UAVObject *obj    = NULL;
     bool error        = false;
     bool allInstances = (instId == ALL_INSTANCES);
@@ -491,6 +606,10 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             VERBOSE_FILTER(objId) qDebug() << "UAVTalk - received object" << objId << instId << (obj != NULL ? obj->toStringBrief() : "<null object>");
 #endif
             if (obj != NULL) {
+                // Keep the image of large objects, the sender may follow up with deltas to it
+                if (length >= DELTA_MIN_LENGTH) {
+                    deltaBase.insert(((quint64)objId << 16) | instId, QByteArray((const char *)data, length));
+                }
                 // Check if this object acks a pending OBJ_REQ message
                 // any OBJ message can ack a pending OBJ_REQ message
                 // even one that was not sent in response to the OBJ_REQ message
@@ -567,6 +686,16 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
         }
         break;
 
+    case TYPE_OBJ_MULTI:
+        // The instance ID field holds the number of packed objects
+        error = !receiveMultiObject(instId, data, length);
+        break;
+
+    case TYPE_OBJ_DELTA:
+        // All instances, not allowed for OBJ_DELTA messages
+        error = allInstances || !receiveDeltaObject(objId, instId, data, length);
+        break;
+
     case TYPE_NACK:
         // All instances, not allowed for NACK messages
         if (!allInstances) {
@@ -594,6 +723,113 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
     return !error;
 }
 
+/**
+ * Unpack the objects of a TYPE_OBJ_MULTI message.
+ * Each entry is the object ID, the instance ID and the object data. As the entries do
+ * not carry their own length, unpacking stops at the first unknown object.
+ * \param[in] count Number of packed objects
+ * \param[in] data Data buffer
+ * \param[in] length Buffer length
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveMultiObject(quint16 count, quint8 *data, qint32 length)
+{
+    qint32 pos = 0;
+
+    for (quint16 n = 0; n < count; ++n) {
+        if (pos + MULTI_ENTRY_HEADER_LENGTH > length) {
+            return false;
+        }
+        quint32 objId  = qFromLittleEndian<quint32>(&data[pos]);
+        quint16 instId = qFromLittleEndian<quint16>(&data[pos + 4]);
+        pos += MULTI_ENTRY_HEADER_LENGTH;
+
+        UAVObject *typeObj = objMngr->getObject(objId);
+        if (typeObj == NULL || instId == ALL_INSTANCES || pos + (qint32)typeObj->getNumBytes() > length) {
+            qWarning() << "UAVTalk - error : bad multi object entry" << objId << instId;
+            return false;
+        }
+        UAVObject *obj = updateObject(objId, instId, &data[pos]);
+#ifdef VERBOSE_UAVTALK
+        VERBOSE_FILTER(objId) qDebug() << "UAVTalk - received multi object entry" << objId << instId << (obj != NULL ? obj->toStringBrief() : "<null object>");
+#endif
+        if (obj != NULL) {
+            // any OBJ message can ack a pending OBJ_REQ message
+            updateAck(TYPE_OBJ, objId, instId, obj);
+        }
+        pos += typeObj->getNumBytes();
+    }
+
+    return pos == length;
+}
+
+/**
+ * Rebuild an object from a TYPE_OBJ_DELTA message and the last full image received.
+ * The delta is dropped and NACKed if that image is missing or its CRC32 differs from the
+ * one the sender based it on, the NACK makes the sender resend a full image.
+ * \param[in] objId ID of the object
+ * \param[in] instId The instance ID
+ * \param[in] data Data buffer
+ * \param[in] length Buffer length
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveDeltaObject(quint32 objId, quint16 instId, quint8 *data, qint32 length)
+{
+    QHash<quint64, QByteArray>::const_iterator base = deltaBase.constFind(((quint64)objId << 16) | instId);
+    UAVObject *typeObj = objMngr->getObject(objId);
+
+    if (typeObj == NULL) {
+        return false;
+    }
+    if (base == deltaBase.constEnd() || base->size() != (int)typeObj->getNumBytes()) {
+        qWarning() << "UAVTalk - error : no base image for delta" << objId << instId;
+        transmitObject(TYPE_NACK, objId, instId, NULL);
+        return false;
+    }
+
+    qint32 numBytes     = base->size();
+    qint32 numBlocks    = (numBytes + DELTA_BLOCK_LENGTH - 1) / DELTA_BLOCK_LENGTH;
+    qint32 bitmapLength = (numBlocks + 7) / 8;
+    if (length < DELTA_CHECK_LENGTH + bitmapLength) {
+        return false;
+    }
+    quint32 baseCrc = (quint32)data[0] | ((quint32)data[1] << 8) | ((quint32)data[2] << 16) | ((quint32)data[3] << 24);
+    if (Crc::updateCRC32(0, (const quint8 *)base->constData(), numBytes) != baseCrc) {
+        qWarning() << "UAVTalk - error : delta base mismatch" << objId << instId;
+        transmitObject(TYPE_NACK, objId, instId, NULL);
+        return false;
+    }
+
+    QByteArray image(*base);
+    const quint8 *bitmap = &data[DELTA_CHECK_LENGTH];
+    qint32 pos = DELTA_CHECK_LENGTH + bitmapLength;
+    for (qint32 n = 0; n < numBlocks; ++n) {
+        if (bitmap[n / 8] & (1 << (n % 8))) {
+            qint32 offset = n * DELTA_BLOCK_LENGTH;
+            qint32 size   = (numBytes - offset < DELTA_BLOCK_LENGTH) ? numBytes - offset : DELTA_BLOCK_LENGTH;
+            if (pos + size > length) {
+                return false;
+            }
+            memcpy(image.data() + offset, &data[pos], size);
+            pos += size;
+        }
+    }
+    if (pos != length) {
+        return false;
+    }
+
+    UAVObject *obj = updateObject(objId, instId, (quint8 *)image.data());
+#ifdef VERBOSE_UAVTALK
+    VERBOSE_FILTER(objId) qDebug() << "UAVTalk - received delta" << objId << instId << (obj != NULL ? obj->toStringBrief() : "<null object>");
+#endif
+    if (obj == NULL) {
+        return false;
+    }
+    // any OBJ message can ack a pending OBJ_REQ message
+    updateAck(TYPE_OBJ, objId, instId, obj);
+    return true;
+}
+
 /**
  * Update the data of an object from a byte array (unpack).
  * If the object instance could not be found in the list, then a
@@ -623,15 +859,63 @@ UAVObject *UAVTalk::updateObject(quint32 objId, quint16 instId, quint8 *data)
             qWarning() << "UAVTalk - failed to register object " << instObj->toStringBrief();
             return NULL;
         }
-        instObj->unpack(data);
+        instObj->unpack(data, false);
+        queueUpdate(instObj);
         return instObj;
     } else {
         // Unpack data into object instance
-        obj->unpack(data);
+        obj->unpack(data, false);
+        queueUpdate(obj);
         return obj;
     }
 }
 
+/**
+ * Queue the update events of an unpacked object
+ */
+void UAVTalk::queueUpdate(UAVObject *obj)
+{
+    QMutexLocker locker(&mutex);
+
+    PendingEvent event = { obj, false, false };
+
+    pendingEvents.append(event);
+}
+
+/**
+ * Queue a transactionCompleted event, it is emitted after the updates received before it
+ */
+void UAVTalk::queueTransactionCompleted(UAVObject *obj, bool success)
+{
+    QMutexLocker locker(&mutex);
+
+    PendingEvent event = { obj, true, success };
+
+    pendingEvents.append(event);
+}
+
+/**
+ * Emit the events queued while receiving, in the order they were queued.
+ * Every update is notified, listeners such as the logging plugin record each of them.
+ */
+void UAVTalk::notifyUpdates()
+{
+    QList<PendingEvent> events;
+    {
+        QMutexLocker locker(&mutex);
+        events.swap(pendingEvents);
+    }
+
+    // emit outside of the lock, listeners in other threads may send objects
+    foreach(const PendingEvent &event, events) {
+        if (event.transaction) {
+            emit transactionCompleted(event.obj, event.success);
+        } else {
+            event.obj->emitUnpacked();
+        }
+    }
+}
+
 /**
  * Check if a transaction is pending and if yes complete it.
  */
@@ -647,13 +931,13 @@ void UAVTalk::updateAck(quint8 type, quint32 objId, quint16 instId, UAVObject *o
             if (instId == 0) {
                 // last instance received, complete transaction
                 closeTransaction(trans);
-                emit transactionCompleted(obj, true);
+                queueTransactionCompleted(obj, true);
             } else {
                 // TODO extend timeout?
             }
         } else {
             closeTransaction(trans);
-            emit transactionCompleted(obj, true);
+            queueTransactionCompleted(obj, true);
         }
     }
 }
@@ -670,7 +954,7 @@ void UAVTalk::updateNack(quint32 objId, quint16 instId, UAVObject *obj)
     Transaction *trans = findTransaction(objId, instId);
     if (trans) {
         closeTransaction(trans);
-        emit transactionCompleted(obj, false);
+        queueTransactionCompleted(obj, false);
     }
 }
 
@@ -732,6 +1016,49 @@ bool UAVTalk::transmitObject(quint8 type, quint32 objId, quint16 instId, UAVObje
     return ret;
 }
 
+/**
+ * Write a frame to the io device. The device is only accessed from the thread of
+ * this object, frames sent from other threads are handed over to it and errors are
+ * accounted there.
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::writeFrame(const quint8 *data, qint32 length)
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, "writeOutput", Qt::QueuedConnection, Q_ARG(QByteArray, QByteArray((const char *)data, length)));
+        return true;
+    }
+
+    // Check that the transmit backlog does not grow above limit
+    if (!io.isNull() && io->isWritable()) {
+        if (io->bytesToWrite() < TX_BUFFER_SIZE) {
+            io->write((const char *)data, length);
+            if (useUDPMirror) {
+                udpSocketRx->writeDatagram((const char *)data, length, QHostAddress::LocalHost, udpSocketTx->localPort());
+            }
+        } else {
+            qWarning() << "UAVTalk - error transmitting : io device full";
+            ++stats.txErrors;
+            return false;
+        }
+    } else {
+        qWarning() << "UAVTalk - error transmitting : io device not writable";
+        ++stats.txErrors;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Write a frame handed over by the reader thread
+ */
+void UAVTalk::writeOutput(const QByteArray &data)
+{
+    QMutexLocker locker(&mutex);
+
+    writeFrame((const quint8 *)data.constData(), data.size());
+}
+
 /**
  * Send an object through the telemetry link.
  * \param[in] type Transaction type
@@ -785,21 +1112,8 @@ bool UAVTalk::transmitSingleObject(quint8 type, quint32 objId, quint16 instId, U
     // Calculate checksum
     txBuffer[HEADER_LENGTH + length] = Crc::updateCRC(0, txBuffer, HEADER_LENGTH + length);
 
-    // Send buffer, check that the transmit backlog does not grow above limit
-    if (!io.isNull() && io->isWritable()) {
-        if (io->bytesToWrite() < TX_BUFFER_SIZE) {
-            io->write((const char *)txBuffer, HEADER_LENGTH + length + CHECKSUM_LENGTH);
-            if (useUDPMirror) {
-                udpSocketRx->writeDatagram((const char *)txBuffer, HEADER_LENGTH + length + CHECKSUM_LENGTH, QHostAddress::LocalHost, udpSocketTx->localPort());
-            }
-        } else {
-            qWarning() << "UAVTalk - error transmitting : io device full";
-            ++stats.txErrors;
-            return false;
-        }
-    } else {
-        qWarning() << "UAVTalk - error transmitting : io device not writable";
-        ++stats.txErrors;
+    // Send buffer
+    if (!writeFrame(txBuffer, HEADER_LENGTH + length + CHECKSUM_LENGTH)) {
         return false;
     }
 
@@ -896,6 +1210,16 @@ const char *UAVTalk::typeToString(quint8 type)
     case TYPE_NACK:
         return "nack";
 
+        break;
+
+    case TYPE_OBJ_MULTI:
+        return "multi object";
+
+        break;
+
+    case TYPE_OBJ_DELTA:
+        return "object delta";
+
         break;
     }
     return "<error>";
@@ -35,6 +35,7 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QMap>
+#include <QHash>
 #include <QThread>
 #include <QtNetwork/QUdpSocket>
 
@@ -46,6 +47,11 @@ class UAVTALK_EXPORT UAVTalk : public QObject {
 public:
     static const quint16 ALL_INSTANCES = 0xFFFF;
 
+    // Optional protocol features, announced to the flight side through GCSTelemetryFeatures
+    static const quint8 FEATURE_MULTI_OBJECT = 0x01;
+    static const quint8 FEATURE_DELTA        = 0x02;
+    static const quint8 SUPPORTED_FEATURES   = FEATURE_MULTI_OBJECT | FEATURE_DELTA;
+
     typedef struct {
         quint32 txBytes;
         quint32 txObjectBytes;
@@ -70,12 +76,20 @@ public:
     bool sendObjectRequest(UAVObject *obj, bool allInstances);
     void cancelTransaction(UAVObject *obj);
 
+public slots:
+    void resetDeltaBase();
+
 signals:
     void transactionCompleted(UAVObject *obj, bool success);
+    // raw input to be decoded by the reader thread, see IODeviceReader
+    void inputReceived(const QByteArray &data);
 
 private slots:
     void processInputStream();
     void dummyUDPRead();
+    void writeOutput(const QByteArray &data);
+    void receiveFrame(quint8 type, quint32 objId, quint16 instId, const QByteArray &data);
+    void mirrorInput(const QByteArray &data);
 
 private:
 
@@ -85,6 +99,13 @@ private:
         quint16 respInstId;
     } Transaction;
 
+    // an object update or a completed transaction, to be emitted once the frame is received
+    typedef struct {
+        UAVObject *obj;
+        bool transaction;
+        bool success;
+    } PendingEvent;
+
     // Constants
     static const int TYPE_MASK     = 0xF8;
     static const int TYPE_VER      = 0x20;
@@ -93,10 +114,21 @@ private:
     static const int TYPE_OBJ_ACK  = (TYPE_VER | 0x02);
     static const int TYPE_ACK      = (TYPE_VER | 0x03);
     static const int TYPE_NACK     = (TYPE_VER | 0x04);
+    static const int TYPE_OBJ_MULTI = (TYPE_VER | 0x05);
+    static const int TYPE_OBJ_DELTA = (TYPE_VER | 0x06);
 
     // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
     static const int HEADER_LENGTH = 10;
 
+    // multi object entry : object ID(4), instance ID(2), followed by the object data
+    static const int MULTI_ENTRY_HEADER_LENGTH = 6;
+
+    // delta payload : base image CRC32 (little endian), changed block bitmap, changed blocks
+    static const int DELTA_CHECK_LENGTH = 4;
+    static const int DELTA_BLOCK_LENGTH = 4;
+    // the sender only delta encodes objects at least this large
+    static const int DELTA_MIN_LENGTH   = 32;
+
     static const int MAX_PAYLOAD_LENGTH = 256;
 
     static const int CHECKSUM_LENGTH    = 1;
@@ -105,6 +137,8 @@ private:
 
     static const int TX_BUFFER_SIZE     = 2 * 1024;
 
+    static const int RX_BUFFER_SIZE     = 4 * 1024;
+
     // Types
     typedef enum {
         STATE_SYNC, STATE_TYPE, STATE_SIZE, STATE_OBJID, STATE_INSTID, STATE_DATA, STATE_CS, STATE_COMPLETE, STATE_ERROR
@@ -121,10 +155,22 @@ private:
 
     QMap<quint32, QMap<quint32, Transaction *> *> transMap;
 
+    // last full image received of each large object instance, keyed by object and instance ID
+    QHash<quint64, QByteArray> deltaBase;
+
+    // set when the input is decoded by a dedicated reader thread
+    bool useReaderThread;
+
+    // objects unpacked and transactions completed since the last notification, in order
+    QList<PendingEvent> pendingEvents;
+
     quint8 rxBuffer[MAX_PACKET_LENGTH];
 
     quint8 txBuffer[MAX_PACKET_LENGTH];
 
+    // chunk of raw input read from the io device in one go
+    quint8 rxStreamBuffer[RX_BUFFER_SIZE];
+
     // Variables used by the receive state machine
     // state machine variables
     qint32 rxCount;
@@ -147,11 +193,20 @@ private:
 
     // Methods
     bool objectTransaction(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
+    void processInput(const QByteArray &data);
+    void processInputBuffer(const quint8 *data, qint64 length);
     bool processInputByte(quint8 rxbyte);
+    void processInputFrame();
     bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length);
+    bool receiveMultiObject(quint16 count, quint8 *data, qint32 length);
+    bool receiveDeltaObject(quint32 objId, quint16 instId, quint8 *data, qint32 length);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
     void updateAck(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     void updateNack(quint32 objId, quint16 instId, UAVObject *obj);
+    void queueUpdate(UAVObject *obj);
+    void queueTransactionCompleted(UAVObject *obj, bool success);
+    void notifyUpdates();
+    bool writeFrame(const quint8 *data, qint32 length);
     bool transmitObject(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     bool transmitSingleObject(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
 
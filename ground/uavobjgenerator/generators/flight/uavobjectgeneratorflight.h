@@ -30,6 +30,7 @@
 #define FLIGHT_CODE_DIR "flight/uavobjects"
 
 #include "../generator_common.h"
+#include <QMap>
 
 class UAVObjectGeneratorFlight {
 public: